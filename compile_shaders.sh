@@ -1,2 +1 @@
-glslc src/shaders/triangle.vert -o shaders/vert.spv
-glslc src/shaders/triangle.frag -o shaders/frag.spv
+make shaders
@@ -1,9 +1,23 @@
 #pragma once
 #include "VulkanDevice.hpp"
 #include "Renderable.hpp"
+#include "InstancedRenderable.hpp"
 #include "TextureManager.hpp"
+#include "MeshImportData.hpp"
+#include "MeshOptimizer.hpp"
+#include "CompactVertex.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshCache.hpp"
+#include "ModelData.hpp"
+#include "utils/SingleFlightCache.hpp"
+#include "utils/ThreadPool.hpp"
 #include <assimp/scene.h>
 #include <assimp/mesh.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
 
 
 struct aiMesh;
@@ -12,31 +26,168 @@ struct aiScene;
 namespace render
 {
 
+// Result of AssetLoader::loadObjectAsync. Thread-safe, poll it from the render loop.
+class LoadHandle
+{
+public:
+    enum class State
+    {
+        Pending,
+        Ready, // everything is resident on the GPU.
+        Failed,
+        Cancelled,
+    };
+
+    State state() const;
+    bool done() const { return state() != State::Pending; }
+
+    // nullptr unless Ready.
+    std::shared_ptr<Renderable> get() const;
+
+    // Box around the whole model that can be drawn in the meantime. Shows up once
+    // geometry is imported, before textures and uploads. nullptr until then.
+    std::shared_ptr<Renderable> proxy() const;
+
+    // takes effect at the next stage boundary, wait() to be sure the loader let go.
+    void cancel() { cancelled = true; }
+    bool isCancelled() const { return cancelled; }
+    void wait() const;
+
+private:
+    friend class AssetLoader;
+    void setProxy(std::shared_ptr<Renderable> proxy);
+    void finish(State state, std::shared_ptr<Renderable> result);
+
+    mutable std::mutex mut;
+    mutable std::condition_variable cv;
+    State current {State::Pending};
+    std::shared_ptr<Renderable> renderable;
+    std::shared_ptr<Renderable> proxy_renderable;
+    std::atomic<bool> cancelled {false};
+};
+
+// Settings below are read by loader threads, set them before starting loads.
 class AssetLoader
 {
 public:
     AssetLoader(std::shared_ptr<VulkanDevice>, std::shared_ptr<memory::TextureManager>);
-    std::shared_ptr<Renderable> loadObject(const std::string& path, std::shared_ptr<Pipeline>);
+    // with compactPipeline set, meshes that quantize within error bounds use CompactVertex.
+    // Loading a model that is already loaded (same file, same settings) only makes a new
+    // Renderable around the same ModelData, nothing gets imported or uploaded again.
+    std::shared_ptr<Renderable> loadObject(const std::string& path, std::shared_ptr<Pipeline>,
+                                           std::shared_ptr<Pipeline> compactPipeline = nullptr);
+
+    // Same on a loader thread, higher priority loads start first. Does not block.
+    std::shared_ptr<LoadHandle> loadObjectAsync(const std::string& path, std::shared_ptr<Pipeline>,
+                                                int priority = 0,
+                                                std::shared_ptr<Pipeline> compactPipeline = nullptr);
+
+    // Instanced drawing of a model, instances get set on the result. Full vertices only,
+    // so it shares its ModelData with Renderables loaded without a compact pipeline.
+    std::shared_ptr<InstancedRenderable> loadInstanced(const std::string& path, std::shared_ptr<Pipeline> instancedPipeline);
+
+    // Decode and upload happen on the load queue, TextureManager::applyReloads() swaps them in.
+    void reloadTextureAsync(const std::string& path, int priority = 0);
+
+    // blocks until every queued load and reload is done, cancelled ones included. Nothing
+    // submits to the device from the loader after this, unless more gets queued.
+    void waitIdle();
+
+    // packs small same-sized textures of a model into shared layered images on import.
+    void setSmallTexturePacking(bool enabled) { pack_small_textures = enabled; }
+
+    void setQuantizationErrorBounds(QuantizationErrorBounds bounds) { quantization_bounds = bounds; }
+
+    // part of the mesh cache key, so changing it re-imports instead of using stale LODs.
+    void setLodSettings(LodSettings settings) { lod_settings = std::move(settings); }
 
 private:
-    Mesh processMesh(
+    // meshes either straight from the mesh cache or from Assimp, views point into whichever it was.
+    struct LoadedGeometry
+    {
+        std::unique_ptr<MeshCache> cache;
+        std::optional<ModelImportData> imported;
+        std::vector<MeshView> views;
+        SceneHierarchy hierarchy;
+    };
+
+    // nullopt if import fails.
+    std::optional<LoadedGeometry> loadGeometry(const std::string& path);
+
+    // textures and uploads, blocks until it is all on the GPU.
+    std::shared_ptr<const ModelData> createModelData(
+        const std::string& path,
+        LoadedGeometry& geometry,
+        bool allow_compact);
+
+    // Through the model cache, so every Renderable of an asset shares one ModelData. On a miss
+    // on_geometry (if any) runs between import and upload, returning false abandons the load.
+    // nullptr if the load failed or was abandoned.
+    std::shared_ptr<const ModelData> loadModel(
+        const std::string& path,
+        bool allow_compact,
+        const std::function<bool(const LoadedGeometry&)>& on_geometry);
+
+    // path, size and modification time of the file, plus whatever changes the imported result.
+    std::string modelKey(const std::string& path, bool allow_compact) const;
+
+    // untextured box around the model, for drawing while the real thing loads.
+    std::shared_ptr<Renderable> createBoundsProxy(const LoadedGeometry& geometry, std::shared_ptr<Pipeline> pipeline);
+
+    // nullopt if Assimp fails.
+    std::optional<ModelImportData> importWithAssimp(const std::string& path);
+
+    // converts, runs the mesh optimizer (before/after numbers end up in stats) and builds LODs.
+    MeshImportData processMesh(
         const struct aiMesh* mesh,
         const struct aiScene* scene,
-        const std::string& path_root);
+        const std::string& path_root,
+        MeshOptimizeStats& stats);
+
+    struct MeshRef
+    {
+        const struct aiMesh* mesh;
+        uint32_t node;
+    };
 
+    // flattens node tree into hierarchy, parents first, and lists meshes to process per node.
     void processNodes(
-        std::vector<Mesh>& meshes,
-        const struct aiNode* node,
-        const struct aiScene* scene,
-        const std::string& dir_root);
+        std::vector<MeshRef>& meshes,
+        SceneHierarchy& hierarchy,
+        const struct aiNode* root,
+        const struct aiScene* scene);
+
+    // loads textures and quantizes vertices if allowed and within quantization_bounds.
+    // Full vertices and indices still point into mesh.
+    MeshSource createMeshSource(const MeshView& mesh, bool allow_compact);
+
+    std::vector<std::string> collectTexturePaths(const std::vector<MeshView>& meshes);
 
-    uint32_t loadTexture(
+    MeshMaterialPaths importMaterial(
         const struct aiMaterial* material,
-        enum aiTextureType type,
+        const std::string& path_root);
+
+    // empty if material has none of the types.
+    std::string texturePath(
+        const struct aiMaterial* material,
+        std::initializer_list<enum aiTextureType> types,
         const std::string& path_root);
 
     std::shared_ptr<VulkanDevice> device;
     std::shared_ptr<memory::TextureManager> tex_mgr;
+    bool pack_small_textures{true};
+    QuantizationErrorBounds quantization_bounds;
+    LodSettings lod_settings;
+
+    // modelKey -> model. Weak, instances keep models alive, the cache just finds them.
+    SingleFlightCache<std::weak_ptr<const ModelData>> model_cache;
+
+    // mesh conversion runs here. Assimp scene is read-only at that point, so that is fine.
+    ThreadPool workers;
+
+    // whole async loads, which wait on workers, so they cannot share a pool with them.
+    // Declared after workers so it is joined first.
+    ThreadPool load_queue{1};
 };
 
 } // namespace render
@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace render {
+
+// Watches asset directories, subdirectories included, for files that got written or moved
+// into place (inotify, so Linux only). Events are gathered on a background thread and a batch
+// is published once things have been quiet for settleTime. Editors that save in a couple of
+// steps trigger one reload that way, not three.
+class AssetWatcher
+{
+public:
+    explicit AssetWatcher(const std::vector<std::string>& roots,
+                          std::chrono::milliseconds settleTime = std::chrono::milliseconds(20));
+    ~AssetWatcher();
+
+    AssetWatcher(const AssetWatcher&) = delete;
+    AssetWatcher& operator=(const AssetWatcher&) = delete;
+
+    // Files changed since the last call, as root/relative/path with no "." or ".." in it.
+    // Just a lock and a swap, fine to call every frame.
+    std::vector<std::string> takeChanged();
+
+private:
+    void addWatchRecursive(const std::filesystem::path& dir);
+    void readEvents(std::set<std::string>& batch);
+    void run();
+
+    int inotify_fd{-1};
+    int wake_fd{-1}; // eventfd, gets the thread out of poll() on shutdown.
+    std::chrono::milliseconds settle_time;
+
+    // watch descriptor -> directory. Only the watcher thread touches it once running.
+    std::unordered_map<int, std::filesystem::path> watched;
+
+    std::mutex mut;
+    std::set<std::string> changed;
+    std::thread thread;
+};
+
+} // namespace render
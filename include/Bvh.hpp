@@ -0,0 +1,111 @@
+#pragma once
+#include "Culling.hpp"
+
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace render {
+
+struct Aabb
+{
+    glm::vec3 min { std::numeric_limits<float>::max() };
+    glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+    bool empty() const { return min.x > max.x or min.y > max.y or min.z > max.z; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    float surfaceArea() const;
+
+    void grow(glm::vec3 p) { min = glm::min(min, p); max = glm::max(max, p); }
+    void grow(const Aabb& o) { min = glm::min(min, o.min); max = glm::max(max, o.max); }
+
+    // box around this one after going through m.
+    Aabb transformed(const glm::mat4& m) const;
+};
+
+// t is in units of direction, which does not have to be normalized.
+struct Ray
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// Two per cache line. Nodes are in depth first order, so an inner node's left child is the next
+// node and children always come after their parent.
+struct BvhNode
+{
+    Aabb bounds;
+    uint32_t offset; // leaf: first entry in the item list. Inner: index of the right child.
+    uint32_t count; // items in a leaf, 0 for inner nodes.
+
+    bool isLeaf() const { return count > 0; }
+};
+
+static_assert(sizeof(BvhNode) == 32);
+
+// Past this many meshes a renderable culls through its BVH instead of testing every sphere.
+constexpr size_t BVH_CULL_THRESHOLD = 64;
+
+// Bounding volume hierarchy over items identified by index, built with binned SAH into one flat
+// node array. Moving items are handled by refitting, which keeps the tree shape and lets its quality
+// drift. Once degradation() gets bad a rebuild can run on another thread, the old tree keeps
+// answering queries until poll() swaps the new one in.
+class Bvh
+{
+public:
+    static constexpr uint32_t MAX_LEAF_ITEMS = 4;
+    static constexpr uint32_t NO_HIT = ~0u;
+    // refit trees this much worse than a fresh build are worth building again.
+    static constexpr float REBUILD_DEGRADATION = 1.5f;
+
+    Bvh() = default;
+
+    Bvh(const Bvh&) = delete;
+    Bvh& operator=(const Bvh&) = delete;
+
+    // item i is boxes[i]. Drops a background build in flight, after waiting for it.
+    void build(std::vector<Aabb> boxes);
+    // new bounds of every item, same count as the last build. Tree shape stays.
+    void refit(std::vector<Aabb> boxes);
+
+    size_t itemCount() const { return itemBounds.size(); }
+    const std::vector<BvhNode>& getNodes() const { return nodes; }
+
+    // SAH cost of the tree as it is now over the cost it had right after being built, 1 for a fresh one.
+    float degradation() const;
+    // builds again from the current boxes on another thread. Nothing if one is running already.
+    void rebuildAsync();
+    bool rebuilding() const { return pending.valid(); }
+    // swaps in a finished background build, refitted to boxes that changed meanwhile. true if it did.
+    bool poll();
+
+    // items whose box is not entirely outside one of the planes, conservative like Frustum::sphereVisible.
+    void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+    // items whose box the sphere touches.
+    void querySphere(glm::vec3 center, float radius, std::vector<uint32_t>& out) const;
+    // item with the nearest box entry along the ray within maxT, NO_HIT if none. Box level only,
+    // the caller decides whether what is inside the box was really hit. hitT gets the entry.
+    uint32_t raycast(const Ray& ray, float maxT, float* hitT = nullptr) const;
+
+private:
+    struct Tree
+    {
+        std::vector<BvhNode> nodes;
+        std::vector<uint32_t> items; // leaves point into this, item indices in leaf order.
+    };
+
+    static Tree buildTree(const std::vector<Aabb>& boxes);
+    static float sahCost(const std::vector<BvhNode>& nodes);
+    // node bounds from item bounds, children before parents.
+    void refitNodes();
+
+    std::vector<BvhNode> nodes;
+    std::vector<uint32_t> items;
+    std::vector<Aabb> itemBounds;
+    float builtCost {0.0f};
+    std::future<Tree> pending; // from std::async, so destroying it waits for the build.
+};
+
+} // namespace render
@@ -22,6 +22,7 @@ public:
     // Im too lazy to make this more abstract for now. Static it is.
     static void mouseMovementCallback(GLFWwindow*, double xpos, double ypos);
     UboData genCurrentVPMatrices();
+    glm::vec3 getPosition();
 
     // I dont have any keyboard processing class for now so... lets just throw it into camera.
     void processKeyboardMovement();
@@ -0,0 +1,76 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <array>
+#include <cstdint>
+
+namespace render {
+
+struct CommandStateStats
+{
+    uint32_t recorded {0};
+    uint32_t skipped {0};
+};
+
+// Graphics state of one command buffer as recorded so far. Binds and push constants go through
+// here and are dropped when they would not change anything, so renderables sharing a pipeline,
+// sets or buffers do not bind them again. Only sees what goes through it: after recording
+// anything that touches graphics state behind its back (secondary buffers, compute passes
+// sharing push constants), call invalidate().
+// Binding a set through another pipeline layout forgets every set bound through a different one,
+// below it too, since it cannot tell compatible layouts apart. Sets below stay bound only if the
+// layouts are compatible, otherwise they have to be bound again through the new layout.
+class CommandStateCache
+{
+public:
+    static constexpr uint32_t MAX_SETS = 4;
+    static constexpr uint32_t MAX_VERTEX_BINDINGS = 4;
+    static constexpr uint32_t MAX_PUSH_CONSTANT_BYTES = 128; // what every device has to offer.
+
+    explicit CommandStateCache(VkCommandBuffer commandBuffer);
+
+    VkCommandBuffer get() const { return commandBuffer; }
+
+    void bindPipeline(VkPipeline pipeline);
+    void bindDescriptorSet(VkPipelineLayout layout, uint32_t setIndex, VkDescriptorSet set);
+    void bindVertexBuffers(uint32_t firstBinding, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets);
+    void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType type);
+    void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+
+    // forget everything, the next of each bind gets recorded.
+    void invalidate();
+
+    const CommandStateStats& getStats() const { return stats; }
+
+private:
+    struct BoundSet
+    {
+        VkPipelineLayout layout {VK_NULL_HANDLE};
+        VkDescriptorSet set {VK_NULL_HANDLE};
+    };
+
+    struct BoundBuffer
+    {
+        VkBuffer buffer {VK_NULL_HANDLE};
+        VkDeviceSize offset {0};
+    };
+
+    // true if it has to be recorded.
+    bool record(bool changed);
+
+    VkCommandBuffer commandBuffer;
+    VkPipeline pipeline {VK_NULL_HANDLE};
+    std::array<BoundSet, MAX_SETS> sets {};
+    std::array<BoundBuffer, MAX_VERTEX_BINDINGS> vertexBuffers {};
+    BoundBuffer indexBuffer {};
+    VkIndexType indexType {VK_INDEX_TYPE_UINT32};
+
+    VkPipelineLayout pushLayout {VK_NULL_HANDLE};
+    VkShaderStageFlags pushStages {0};
+    std::array<uint8_t, MAX_PUSH_CONSTANT_BYTES> pushData {};
+    std::array<bool, MAX_PUSH_CONSTANT_BYTES> pushWritten {};
+
+    CommandStateStats stats;
+};
+
+} // namespace render
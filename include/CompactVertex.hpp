@@ -0,0 +1,56 @@
+#pragma once
+#include "MemoryStruct.hpp"
+#include "Vertex.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace render {
+
+// 20 byte version of Vertex, used with the compact pipeline (shaders/vert_compact.spv).
+// position: unorm16 xyz relative to mesh bounds, w unused. Dequantized in the shader
+//           with pos_scale/pos_bias from MeshDrawData.
+// normal, tangent: octahedral encoded, snorm16 x2.
+// tex_coords: half floats.
+struct CompactVertex {
+    RF_VULKAN_VERTEX_DESCRIPTORS_GETTERS_STATIC
+
+    uint16_t pos[4] {};
+    int16_t surf_normals[2] {};
+    int16_t tangents[2] {};
+    uint32_t tex_coords {};
+
+private:
+    RF_VULKAN_VERTEX_DESCRIPTORS_STATIC(4)
+};
+
+// unorm position * scale + bias gives back the object space position.
+struct VertexQuantization
+{
+    glm::vec3 scale {1.0f};
+    glm::vec3 bias {0.0f};
+
+    static VertexQuantization forBounds(glm::vec3 min, glm::vec3 max)
+    {
+        return { max - min, min };
+    }
+};
+
+// Worst reconstruction error allowed per attribute for a mesh to go compact.
+struct QuantizationErrorBounds
+{
+    float position = 1e-3f; // object space units
+    float direction = 1e-3f; // distance between unit vectors, normals and tangents
+    float texCoord = 1.0f / 4096.0f; // a texel of a 4k texture
+};
+
+CompactVertex encodeVertex(const Vertex& v, const VertexQuantization& q);
+Vertex decodeVertex(const CompactVertex& v, const VertexQuantization& q);
+
+// Encodes all vertices and checks every one of them against the bounds.
+// false if any is off by more than allowed, out is not usable then.
+bool quantizeVertices(const Vertex* vertices, size_t count, const VertexQuantization& q,
+                      const QuantizationErrorBounds& bounds, std::vector<CompactVertex>& out);
+
+} // namespace render
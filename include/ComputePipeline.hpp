@@ -0,0 +1,39 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cassert>
+#include <vector>
+
+#include "Shader.hpp"
+
+namespace render {
+
+// Pipeline for a single compute shader. Layouts come from the same SPIR-V reflection
+// graphics pipelines use, so the shader is the only place they are described.
+class ComputePipeline {
+public:
+    ComputePipeline(const Shader& shader, VkDevice device);
+    ComputePipeline(ComputePipeline&&);
+    ComputePipeline(const ComputePipeline&) = delete;
+    ~ComputePipeline();
+
+    VkPipeline getHandle() const { return pipeline; }
+    VkPipelineLayout getLayoutHandle() const { return pipelineLayout; }
+    VkDescriptorSetLayout getDescriptorSetLayout(size_t index) const
+    {
+        assert(index < descriptorSetLayouts.size());
+        return descriptorSetLayouts[index];
+    }
+
+    // push constants of the shader, size 0 if it has none.
+    const VkPushConstantRange& getPushConstantRange() const { return pushConstantRange; }
+
+private:
+    VkPipeline pipeline { VK_NULL_HANDLE };
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+    VkPushConstantRange pushConstantRange {};
+    VkPipelineLayout pipelineLayout { VK_NULL_HANDLE };
+    VkDevice device;
+};
+
+} // namespace render
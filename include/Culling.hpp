@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace render {
+
+// Six planes pulled out of a clip matrix (Gribb & Hartmann), normals pointing inside.
+// Built from projection * view * model it lives in model space, so bounds can be
+// tested as they are stored, no transforming them every frame.
+struct Frustum
+{
+    glm::vec4 planes[6]; // xyz normal (unit length), w distance.
+
+    // OpenGL style clip space (-w <= z <= w), as what glm::perspective produces.
+    static Frustum fromMatrix(const glm::mat4& clip);
+
+    // conservative, spheres near frustum corners can pass without being inside.
+    bool sphereVisible(glm::vec3 center, float radius) const;
+};
+
+// Camera as seen from the model space of one object.
+struct CullView
+{
+    Frustum frustum;
+    glm::vec3 cameraPos;
+    bool cones; // off under non-uniform scale, normal cones do not survive it.
+
+    static CullView forObject(const glm::mat4& viewProj, glm::vec3 cameraWorld, const glm::mat4& model);
+};
+
+// Bounding spheres of many objects, one array per component so the culling kernel
+// can load four objects at a time.
+struct SphereSoA
+{
+    std::vector<float> x, y, z, radius;
+
+    void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+    size_t size() const { return x.size(); }
+    void push(glm::vec3 center, float r)
+    {
+        x.push_back(center.x);
+        y.push_back(center.y);
+        z.push_back(center.z);
+        radius.push_back(r);
+    }
+    void resize(size_t n) { x.resize(n); y.resize(n); z.resize(n); radius.resize(n); }
+    void set(size_t i, glm::vec3 center, float r)
+    {
+        x[i] = center.x;
+        y[i] = center.y;
+        z[i] = center.z;
+        radius[i] = r;
+    }
+};
+
+// Past this many spheres cullSpheres splits the work over OpenMP threads.
+constexpr size_t PARALLEL_CULL_THRESHOLD = 4096;
+
+// visible[i] becomes 1 if sphere i is (conservatively) in the frustum, 0 if not. Same test as
+// Frustum::sphereVisible, SSE four spheres at a time. Returns how many are visible.
+uint32_t cullSpheres(const Frustum& frustum, const SphereSoA& spheres, std::vector<uint8_t>& visible);
+
+struct CullStats
+{
+    uint32_t objectsTested {0};
+    uint32_t objectsVisible {0};
+    uint32_t objectsOccluded {0}; // in the frustum, but behind software occluders. Not in objectsVisible.
+    uint32_t meshletsTested {0};
+    uint32_t meshletsDrawn {0};
+    uint32_t draws {0};
+
+    uint32_t objectsCulled() const { return objectsTested - objectsVisible; }
+};
+
+// longest of the three axes, what a sphere radius has to grow by to stay around the transformed object.
+inline float maxAxisScale(const glm::mat4& m)
+{
+    return std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+}
+
+// Normal cone of a cluster of triangles, all of them face away from any camera for which this is
+// true. cutoff of 1 or more disables the test. See Meshlet for what the fields mean.
+inline bool coneBackfacing(glm::vec3 center, float radius, glm::vec3 coneAxis, float coneCutoff, glm::vec3 cameraPos)
+{
+    const glm::vec3 toCenter = center - cameraPos;
+    return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+}
+
+} // namespace render
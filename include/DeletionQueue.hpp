@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace render::memory
+{
+
+// Resources that might still be referenced by command buffers in flight cannot be destroyed
+// right away. They are pushed here instead, tagged with the current frame number, and the
+// deleter runs once maxFramesInFlight frames have been retired after that.
+// Thread-safe, so resources can be released from loader threads.
+class DeletionQueue
+{
+public:
+    void push(std::function<void()> deleter);
+
+    // Call once per frame, right after waiting on the inFlight fence of the frame slot
+    // that is about to be reused.
+    void retireFrame();
+
+    // Runs all pending deleters. Device has to be idle.
+    void flushAll();
+
+private:
+    struct Entry
+    {
+        uint64_t frame;
+        std::function<void()> deleter;
+    };
+
+    std::mutex mut;
+    std::deque<Entry> entries;
+    uint64_t current_frame{0};
+};
+
+} // namespace render::memory
@@ -0,0 +1,54 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <memory>
+#include <vector>
+
+#include "ComputePipeline.hpp"
+#include "Shader.hpp"
+#include "VulkanDevice.hpp"
+#include "VulkanImage.hpp"
+
+namespace render {
+
+// Hi-Z: mip chain over a depth attachment, every texel holds the farthest depth of what it covers.
+// Level 0 is half the depth attachment (rounded up), every next level half of the previous, down to 1x1,
+// so a texel of level L covers 2^(L+1) depth pixels a side. Lives in GENERAL layout for good,
+// hiz.comp writes it and cull.comp reads it with texelFetch.
+class DepthPyramid
+{
+public:
+    // depth has to be sampled usage and outlive the pyramid. reduceShader is hiz.comp.
+    DepthPyramid(std::shared_ptr<VulkanDevice> device, memory::VulkanImage& depth, const Shader& reduceShader);
+    ~DepthPyramid();
+
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    // Outside of a render pass, after ESplitPass::FIRST left depth in DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+    // Leaves the whole pyramid visible to compute shaders.
+    void cmdBuild(VkCommandBuffer);
+
+    // all levels, GENERAL layout.
+    VkImageView getView() const { return pyramidView; }
+    VkSampler getSampler() const { return sampler; }
+    uint32_t levelCount() const { return levels; }
+    // of the depth attachment it is built from.
+    VkExtent2D getDepthExtent() const { return depthExtent; }
+
+private:
+    void createDescriptorSets(VkImageView depthView);
+
+    std::shared_ptr<VulkanDevice> device;
+    ComputePipeline pipeline;
+    VkExtent2D depthExtent;
+    uint32_t levels;
+    memory::VulkanImage pyramid;
+    VkImageView pyramidView { VK_NULL_HANDLE };
+    std::vector<VkImageView> levelViews;
+    VkSampler sampler { VK_NULL_HANDLE };
+    VkDescriptorPool descriptorPool { VK_NULL_HANDLE };
+    std::vector<VkDescriptorSet> levelSets; // level - 1 (or depth) in, level out.
+};
+
+} // namespace render
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+// 64 bit sort key of a draw, most significant field first, so sorting the keys groups draws by
+// the state they need and orders them front to back within it:
+//   pipeline (4) | descriptor set (10) | geometry buffers (10) | depth (24) | material (16)
+// Materials are bindless texture ids here, switching them costs nothing, so they only break
+// depth ties. Ids are whatever the caller numbers its pipelines, sets and buffers with,
+// they only have to fit.
+struct DrawKey
+{
+    static constexpr uint32_t PIPELINE_BITS = 4;
+    static constexpr uint32_t SET_BITS = 10;
+    static constexpr uint32_t GEOMETRY_BITS = 10;
+    static constexpr uint32_t DEPTH_BITS = 24;
+    static constexpr uint32_t MATERIAL_BITS = 16;
+
+    // depth is a view distance, negative ones count as 0.
+    static uint64_t make(uint32_t pipeline, uint32_t set, uint32_t geometry, float depth, uint32_t material);
+    static uint32_t pipeline(uint64_t key) { return uint32_t(key >> (64 - PIPELINE_BITS)); }
+};
+
+static_assert(DrawKey::PIPELINE_BITS + DrawKey::SET_BITS + DrawKey::GEOMETRY_BITS
+              + DrawKey::DEPTH_BITS + DrawKey::MATERIAL_BITS == 64);
+
+struct DrawItem
+{
+    uint64_t key;
+    uint32_t index; // the caller's, which draw this is.
+};
+
+// LSD radix sort on the keys, 8 bits a pass. Stable, passes over bytes every key shares are skipped.
+// scratch is only there to not allocate every time.
+void radixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
+
+// Draws of a frame, added in any order and sorted by key before recording.
+class DrawList
+{
+public:
+    void clear() { items.clear(); }
+    void add(uint64_t key, uint32_t index) { items.push_back({ key, index }); }
+    void sort() { radixSort(items, scratch); }
+
+    const std::vector<DrawItem>& getItems() const { return items; }
+    size_t size() const { return items.size(); }
+
+private:
+    std::vector<DrawItem> items;
+    std::vector<DrawItem> scratch;
+};
+
+} // namespace render
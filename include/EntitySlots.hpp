@@ -0,0 +1,97 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+// Handle to an entity of a Scene. Slots get reused after destroy, generations do not, so a handle
+// kept around past destroy stops resolving instead of pointing at whatever took the slot over.
+struct Entity
+{
+    static constexpr uint32_t NO_SLOT = ~0u;
+
+    uint32_t slot {NO_SLOT};
+    uint32_t generation {0};
+
+    bool operator==(const Entity& o) const { return slot == o.slot and generation == o.generation; }
+    bool operator!=(const Entity& o) const { return not (*this == o); }
+};
+
+// Entity handles over packed component arrays. Live entities are 0 to size() - 1, the owner keeps its
+// components at the same indices and moves them the same way: create appends, destroy moves the
+// last entity into the hole.
+class EntitySlots
+{
+public:
+    // entity for the component the owner appends, at index size() before the call.
+    Entity create()
+    {
+        uint32_t slot;
+        if(freeSlots.empty())
+        {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        }
+        else
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        slots[slot].dense = static_cast<uint32_t>(denseSlots.size());
+        denseSlots.push_back(slot);
+        return Entity{slot, slots[slot].generation};
+    }
+
+    // NO_SLOT and nothing changes for handles that do not resolve. Otherwise where the entity was:
+    // the last one is there now, and the owner has to move its components to match.
+    uint32_t destroy(Entity entity)
+    {
+        const uint32_t dense = denseIndex(entity);
+        if(dense == Entity::NO_SLOT)
+            return Entity::NO_SLOT;
+
+        slots[denseSlots.back()].dense = dense;
+        denseSlots[dense] = denseSlots.back();
+        denseSlots.pop_back();
+
+        slots[entity.slot].dense = Entity::NO_SLOT;
+        slots[entity.slot].generation++;
+        freeSlots.push_back(entity.slot);
+        return dense;
+    }
+
+    // NO_SLOT for handles that do not resolve.
+    uint32_t denseIndex(Entity entity) const
+    {
+        if(entity.slot >= slots.size() or slots[entity.slot].generation != entity.generation)
+            return Entity::NO_SLOT;
+        return slots[entity.slot].dense;
+    }
+
+    bool alive(Entity entity) const { return denseIndex(entity) != Entity::NO_SLOT; }
+    size_t size() const { return denseSlots.size(); }
+
+    // handle of the live entity at a packed index.
+    Entity entityAt(uint32_t dense) const
+    {
+        assert(dense < denseSlots.size());
+        const uint32_t slot = denseSlots[dense];
+        return Entity{slot, slots[slot].generation};
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t dense {Entity::NO_SLOT}; // where the entity is in the packed arrays, NO_SLOT while free.
+        uint32_t generation {0};
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> denseSlots; // back to slots, destroy has to fix up the one it moves.
+};
+
+} // namespace render
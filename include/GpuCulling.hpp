@@ -0,0 +1,92 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <memory>
+#include <vector>
+
+#include "ComputePipeline.hpp"
+#include "Constants.hpp"
+#include "DepthPyramid.hpp"
+#include "ModelData.hpp"
+#include "ObjectDescriptorSets.hpp"
+#include "VmaVulkanBuffer.hpp"
+#include "VulkanDevice.hpp"
+
+namespace render {
+
+// Two phase occlusion culling. EARLY draws what was visible last frame and is still in the frustum,
+// the depth pyramid gets built from that, then LATE tests everything in the frustum against it,
+// draws what EARLY missed and remembers what is visible for the next frame.
+enum class ECullPhase : uint32_t {
+    EARLY = 0,
+    LATE = 1,
+};
+
+// Push constants of cull.comp. 104 bytes, under the 128 every device has to give.
+struct GpuCullConstants
+{
+    glm::mat4 clip; // projection * view * model, culling happens in the renderable's model space.
+    glm::vec3 cameraPos; // model space as well.
+    float lodFactor; // pixels per unit at distance 1 over the LOD threshold. 0 keeps every mesh at LOD 0.
+    uint32_t meshCount;
+    uint32_t compactBase; // commands of compact meshes start here within a phase, full ones at 0.
+    uint32_t phase; // ECullPhase
+    uint32_t pyramidLevels;
+    glm::vec2 depthSize; // of the depth attachment the pyramid was built from, in pixels.
+};
+
+static_assert(sizeof(GpuCullConstants) == 104);
+
+// Whole mesh frustum and occlusion culling plus LOD selection of one Renderable in a compute pass.
+// Every mesh gets a thread, survivors append a draw command through an atomic counter per pipeline
+// and phase, so the draw side only ever sees visible meshes and never waits for the CPU to find out which.
+// Per frame in flight it owns the command and counter buffers and a set 0 of cull.comp pointing
+// at them, the model's MeshCullData, that frame's node transforms and the depth pyramid.
+// Visibility of the last frame is one buffer, frames run in order on the queue.
+class GpuCulling
+{
+public:
+    // firstInstance in indirect commands is how shaders find their draw data, so that one is a must.
+    static bool supported(const VulkanDevice& device);
+
+    GpuCulling(std::shared_ptr<VulkanDevice> device,
+               std::shared_ptr<ComputePipeline> pipeline,
+               std::shared_ptr<DepthPyramid> depthPyramid,
+               const ModelData& model,
+               const ObjectDescriptorSets& objectSets);
+
+    // the GPU has to be done with the frames that used it.
+    ~GpuCulling();
+
+    GpuCulling(const GpuCulling&) = delete;
+    GpuCulling& operator=(const GpuCulling&) = delete;
+
+    // Outside of a render pass. Resets the phase's counters, culls, and leaves the commands
+    // ready to be read by indirect draws later in the same command buffer. LATE wants the
+    // pyramid built from what EARLY drew. phase, pyramidLevels and depthSize get filled in here.
+    void cmdDispatch(VkCommandBuffer, uint32_t frameIndex, ECullPhase, GpuCullConstants) const;
+
+    // Inside the render pass with the matching pipeline, sets and buffers bound.
+    // Draws what cmdDispatch of the phase kept of the full vertex meshes, or of the compact ones.
+    void cmdDraw(VkCommandBuffer, uint32_t frameIndex, ECullPhase, bool compact) const;
+
+private:
+    void createDescriptorPool();
+    void generateDescriptorSets(const ModelData& model, const ObjectDescriptorSets& objectSets);
+
+    std::shared_ptr<VulkanDevice> device;
+    std::shared_ptr<ComputePipeline> pipeline;
+    std::shared_ptr<DepthPyramid> depthPyramid;
+    uint32_t meshCount;
+    uint32_t fullMeshCount;
+    // per frame in flight. Room for a command per mesh and phase, EARLY first, full meshes first within.
+    std::vector<memory::VmaVulkanBuffer> drawBuffers;
+    // per frame in flight, two uints per phase: commands written for full and for compact meshes.
+    std::vector<memory::VmaVulkanBuffer> countBuffers;
+    // a uint per mesh, 1 if LATE found it visible. All 0 at first, so the first frame draws everything in LATE.
+    memory::VmaVulkanBuffer visibilityBuffer;
+    VkDescriptorPool descriptorPool { VK_NULL_HANDLE };
+    std::vector<VkDescriptorSet> descriptorSets;
+};
+
+} // namespace render
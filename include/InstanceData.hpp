@@ -0,0 +1,23 @@
+#pragma once
+#include "MemoryStruct.hpp"
+
+#include <glm/glm.hpp>
+
+namespace render {
+
+// Per instance vertex input for instanced pipelines, binding 1 with instance input rate.
+// transform is the top three rows of an affine model matrix, locations 4, 5 and 6.
+// Per instance data beyond that goes after it, with its own attributes.
+struct InstanceData {
+    RF_VULKAN_VERTEX_DESCRIPTORS_GETTERS_STATIC
+
+    InstanceData() = default;
+    explicit InstanceData(const glm::mat4& model);
+
+    glm::vec4 transform[3] { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } };
+
+private:
+    RF_VULKAN_VERTEX_DESCRIPTORS_STATIC(3)
+};
+
+} // namespace render
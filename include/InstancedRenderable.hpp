@@ -0,0 +1,78 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <memory>
+#include <vector>
+
+#include "InstanceData.hpp"
+#include "ModelData.hpp"
+#include "ObjectDescriptorSets.hpp"
+#include "Pipeline.hpp"
+#include "SceneHierarchy.hpp"
+#include "VulkanDevice.hpp"
+
+namespace render {
+
+// Push block of the instanced vertex shader: which MeshDrawData the draw uses.
+// firstInstance stays 0 there, instance attributes are fetched from it.
+struct InstancedPushConstantData
+{
+    uint32_t draw_idx;
+};
+
+/* Many copies of one model for about the price of one: every mesh is a single vkCmdDrawIndexed
+ * with instanceCount = number of instances. Transforms come in as per instance vertex input
+ * (InstanceData, binding 1), so the pipeline is made with vertex_input_tag<Vertex> and
+ * vertex_input_tag<InstanceData>, around shaders/vert_instanced.spv. Set 1 is the same as
+ * for Renderable, its UBO model matrix moves the whole group.
+ *
+ * Meant for crowds and foliage, so no compact meshes and nothing per instance on the CPU:
+ * no culling and one LOD for all instances. */
+class InstancedRenderable {
+public:
+    InstancedRenderable(
+            std::shared_ptr<VulkanDevice> device,
+            std::shared_ptr<Pipeline> pipeline,
+            std::shared_ptr<const ModelData> model);
+
+    // same rules as ~Renderable, in flight ones go through the deletion queue.
+    ~InstancedRenderable();
+
+    // every frame in flight picks them up at its next updateUniforms, frames already recorded keep theirs.
+    void setInstances(std::vector<InstanceData> instances);
+    const std::vector<InstanceData>& getInstances() const { return instances; }
+
+    // clamped to what every mesh has, coarser levels of meshes with fewer just stop at their last.
+    void setLod(size_t lod) { drawLod = lod; }
+
+    void updateUniforms(RenderableUbo, size_t bufferIdx);
+
+    // shared by all instances, same as Renderable::getHierarchy otherwise.
+    SceneHierarchy& getHierarchy() { return hierarchy; }
+    const std::shared_ptr<const ModelData>& getModel() const { return modelData; }
+
+    void cmdBindSetsDrawMeshes(CommandStateCache&, uint32_t frameIndex);
+
+private:
+    std::shared_ptr<VulkanDevice> device;
+    std::shared_ptr<const ModelData> modelData;
+    SceneHierarchy hierarchy;
+    std::shared_ptr<Pipeline> pipeline;
+    std::unique_ptr<ObjectDescriptorSets> sets;
+    size_t drawLod {0};
+
+    std::vector<InstanceData> instances;
+    uint64_t instancesVersion {0}; // bumped by every setInstances.
+
+    // per frame in flight, stay mapped. Grown as needed, old ones go through the deletion queue.
+    struct FrameInstances
+    {
+        memory::VmaVulkanBuffer buffer;
+        size_t capacity {0};
+        uint32_t count {0};
+        uint64_t version {0};
+    };
+    std::vector<FrameInstances> frameInstances;
+};
+
+} // namespace render
@@ -1,46 +1,116 @@
 #pragma once
 #define GLFW_INCLUDE_VULKAN
-#include "vk_mem_alloc.h"
 #include <GLFW/glfw3.h>
 
-#include "Vertex.hpp"
-#include "VulkanDevice.hpp"
-#include "VmaVulkanBuffer.hpp"
+#include "TextureManager.hpp"
+#include "MeshImportData.hpp"
+#include "Culling.hpp"
+#include "SoftwareOcclusion.hpp"
+#include <algorithm>
 #include <vector>
 
 namespace render {
 
+// Per draw data, read by the shaders as draws[gl_InstanceIndex] (std430, so keep it to
+// 4 byte members). One per mesh, lives in the model's draw data buffer.
 // blinn-phong model for now.
-struct MeshPushConstantData
+struct MeshDrawData
 {
+    uint32_t node; // index into the renderable's node transforms
     uint32_t diffuse_texid;
     uint32_t normal_texid;
-    uint32_t specular_texid;
+    uint32_t material_texid; // R = AO, G = specular, B = metallic, A = height
+    uint32_t diffuse_samplerid;
+    uint32_t data_samplerid; // normal and material
+    float pos_scale[3]; // CompactVertex dequantization, unused for full vertices.
+    float pos_bias[3];
 };
 
+static_assert(sizeof(MeshDrawData) == 48);
+
+// Per mesh input of the GPU culling pass (cull.comp), std430. Everything it needs to test the
+// mesh, pick a LOD and write a draw command without looking at anything else.
+struct MeshCullLod
+{
+    uint32_t firstIndex; // absolute, into the model's index buffer.
+    uint32_t indexCount;
+    float error;
+    uint32_t pad;
+};
+
+struct MeshCullData
+{
+    float sphere[4]; // object space center and radius.
+    uint32_t node;
+    int32_t vertexOffset;
+    uint32_t lodCount;
+    uint32_t compact; // 1 if drawn by the compact pipeline.
+    MeshCullLod lods[MAX_MESH_LODS];
+};
+
+static_assert(sizeof(MeshCullData) == 32 + 16 * MAX_MESH_LODS);
+
+// Where a mesh sits in the model's shared buffers. Offsets are in elements, like the
+// draw commands want them. Compact meshes index the compact vertex buffer.
+struct MeshBufferRange
+{
+    int32_t vertexOffset;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+// One mesh of a ModelData: its ranges in the shared buffers, draw data, LODs and meshlets.
+// Owns no GPU memory of its own, so it can be drawn with one indirect draw alongside the rest.
 class Mesh {
 public:
-    Mesh(std::shared_ptr<VulkanDevice> dev,
-         const std::vector<Vertex>& mesh_data,
-         const std::vector<uint32_t>& indices,
-         MeshPushConstantData data);
+    Mesh(MeshDrawData data,
+         std::vector<memory::TextureHandle> textures,
+         MeshBufferRange range,
+         bool compact);
 
     Mesh() {};
-    ~Mesh();
 
-    const memory::VmaVulkanBuffer& getVkInfo() const { return vertex_buffer; }
-    const memory::VmaVulkanBuffer& getVkInfoIndexBuffer() const { return index_buffer; }
-    size_t vertexCount() const { return vertices; }
-    void cmdDraw(VkCommandBuffer, VkPipelineLayout);
+    bool isCompact() const { return compact; }
+    const MeshDrawData& getDrawData() const { return draw_data; }
+    const MeshBufferRange& getBufferRange() const { return range; }
+
+    // LOD index ranges, finest first, relative to the mesh's own indices. Without any, the whole
+    // range is the only level. Meshlets are what MeshLod::meshletOffset points into, empty if none.
+    void setLods(std::vector<MeshLod> lods, std::vector<Meshlet> meshlets, MeshBounds bounds);
+    size_t lodCount() const { return std::max<size_t>(lods.size(), 1); }
+    float lodError(size_t lod) const { return lods.empty() ? 0.0f : lods[lod].error; }
+    const MeshBounds& getBounds() const { return bounds; }
+    // index range of a level, past the coarsest one is the coarsest one.
+    MeshLod getLod(size_t lod) const;
+
+    // most commands writeDraws can produce for any one LOD.
+    size_t maxDraws() const;
+
+    // what the GPU culling pass gets to see of this mesh.
+    MeshCullData getCullData() const;
+
+    // coarsest LOD kept on the CPU for software occlusion, empty if it has too many triangles.
+    void setOccluder(OccluderMesh mesh) { occluder = std::move(mesh); }
+    const OccluderMesh& getOccluder() const { return occluder; }
+
+    // Writes draw commands for meshlets of the lod that are in the frustum and not facing away,
+    // with firstInstance = drawIndex so shaders find their MeshDrawData. Neighbouring survivors
+    // are one range of the index buffer, so they go in one command. Whole meshes are culled by the
+    // caller, ones without meshlets are just drawn. Returns how many commands were written, at most maxDraws().
+    uint32_t writeDraws(VkDrawIndexedIndirectCommand* out, uint32_t drawIndex, size_t lod,
+                        const CullView& view, CullStats& stats) const;
 
 private:
-    std::shared_ptr<VulkanDevice> device;
-    VmaAllocator allocator;
-    size_t vertices;
-    size_t indices;
-    memory::VmaVulkanBuffer vertex_buffer;
-    memory::VmaVulkanBuffer index_buffer;
-    MeshPushConstantData push_constant_data;
+    MeshDrawData draw_data {};
+    MeshBufferRange range {};
+    bool compact {false};
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    MeshBounds bounds;
+    OccluderMesh occluder;
+
+    // keeps textures referenced by draw data loaded for as long as the mesh lives.
+    std::vector<memory::TextureHandle> textures;
 };
 
 } // namespace render
@@ -0,0 +1,60 @@
+#pragma once
+#include "MeshImportData.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace render {
+
+// Binary cache of post-processed meshes, so warm loads can skip Assimp entirely.
+// File is mmap'ed and vertex/index streams are uploaded right from the mapping.
+// Entries are keyed by content hash of the source file plus import flags, anything
+// else not matching (version, vertex layout, size) also counts as a miss.
+//
+// Layout, all little endian and offsets from file start:
+//   FileHeader
+//   MeshRecord[meshCount]
+//   NodeRecord[nodeCount], parents before children
+//   strings (texture paths, not null terminated)
+//   vertex, index and meshlet streams, each 16 byte aligned
+class MeshCache
+{
+public:
+    // Bump on any change to the layout, or to what gets stored (import pipeline changes included).
+    static constexpr uint32_t VERSION = 7;
+
+    // nullptr on miss, stale or corrupt file.
+    static std::unique_ptr<MeshCache> open(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags);
+
+    // Writes to a temporary file first and renames it over, so readers never see a half written cache.
+    static bool write(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags,
+                      const ModelImportData& model);
+
+    // FNV-1a over the mapped file, 8 bytes at a time. 0 if file cannot be read.
+    static uint64_t hashFile(const std::string& path);
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+    ~MeshCache();
+
+    size_t meshCount() const { return views.size(); }
+
+    // Points into the mapping, valid as long as the cache object lives.
+    const MeshView& mesh(size_t idx) const { return views[idx]; }
+
+    // copied out of the mapping, it is small and gets modified when animating.
+    const SceneHierarchy& hierarchy() const { return nodes; }
+
+private:
+    MeshCache(void* mapping, size_t size);
+    bool parse(uint64_t sourceHash, uint32_t importFlags);
+
+    void* mapping;
+    size_t mappingSize;
+    std::vector<MeshView> views;
+    SceneHierarchy nodes;
+};
+
+} // namespace render
@@ -0,0 +1,97 @@
+#pragma once
+#include "Vertex.hpp"
+#include "SceneHierarchy.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace render {
+
+// Paths of textures used by a mesh, empty if it has none of that kind.
+struct MeshMaterialPaths
+{
+    std::string diffuse;
+    std::string normal;
+    // AO, specular, metallic, height. See TextureManager::loadPackedMaterial.
+    std::array<std::string, 4> channels;
+};
+
+// Object space AABB, plus a sphere around the same vertices for cheap culling.
+struct MeshBounds
+{
+    glm::vec3 min {};
+    glm::vec3 max {};
+    glm::vec3 center {}; // of the AABB
+    float radius {0.0f}; // farthest vertex from center, tighter than half the diagonal.
+};
+
+// Range of the index buffer making up one level of detail. All levels share the vertex buffer.
+struct MeshLod
+{
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error; // object space, 0 for the full resolution one.
+    // meshlets covering exactly this level's index range, in index order. 0 if none were built.
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+};
+
+constexpr size_t MAX_MESH_LODS = 5;
+
+// Small run of consecutive triangles, culled as a whole. See buildMeshlets.
+struct Meshlet
+{
+    glm::vec3 center; // bounding sphere, object space.
+    float radius;
+    glm::vec3 coneAxis; // average facing of the triangles, see coneBackfacing.
+    float coneCutoff; // sine of the cone half angle, 1 if the triangles face all over the place.
+    uint32_t indexOffset;
+    uint32_t indexCount;
+};
+
+// CPU side result of importing one mesh, before anything goes to the GPU.
+struct MeshImportData
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices; // all LODs, back to back.
+    std::vector<MeshLod> lods; // finest first, errors increasing.
+    std::vector<Meshlet> meshlets; // all LODs, see MeshLod::meshletOffset.
+    MeshMaterialPaths material;
+    MeshBounds bounds;
+    uint32_t node {0}; // SceneHierarchy node the mesh hangs off.
+};
+
+// Non-owning view of mesh data, either from MeshImportData or straight from a mapped mesh cache.
+struct MeshView
+{
+    const Vertex* vertices;
+    size_t vertexCount;
+    const uint32_t* indices;
+    size_t indexCount;
+    std::vector<MeshLod> lods;
+    const Meshlet* meshlets;
+    size_t meshletCount;
+    MeshMaterialPaths material;
+    MeshBounds bounds;
+    uint32_t node;
+
+    static MeshView of(const MeshImportData& data)
+    {
+        return { data.vertices.data(), data.vertices.size(),
+                 data.indices.data(), data.indices.size(),
+                 data.lods, data.meshlets.data(), data.meshlets.size(),
+                 data.material, data.bounds, data.node };
+    }
+};
+
+// Everything a model import produces. A mesh referenced by several nodes shows up once per node.
+struct ModelImportData
+{
+    std::vector<MeshImportData> meshes;
+    SceneHierarchy hierarchy;
+};
+
+} // namespace render
@@ -0,0 +1,45 @@
+#pragma once
+#include "Vertex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+// Post-transform cache modelled as FIFO of this many entries, close enough to what
+// desktop GPUs do for ordering purposes.
+constexpr size_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+    float acmr {0.0f}; // cache misses per triangle, 0.5 is the ideal, 3 is no reuse at all.
+    float atvr {0.0f}; // cache misses per referenced vertex, 1 is the ideal.
+};
+
+struct MeshOptimizeStats
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// FIFO cache simulation over a triangle list.
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                    size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander et al. 2007) triangle reordering for post-transform cache reuse.
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+                         size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Splits cache-ordered triangles into clusters where it costs no cache reuse, then draws
+// outward facing clusters first so they occlude the rest. Run after optimizeVertexCache.
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                      size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders vertices into first use order of the index buffer and drops unreferenced ones.
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// All of the above, in order. Fully deterministic, so output can go into the mesh cache.
+MeshOptimizeStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+} // namespace render
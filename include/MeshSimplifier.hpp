@@ -0,0 +1,35 @@
+#pragma once
+#include "Vertex.hpp"
+#include "MeshImportData.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+// Quadric error metric simplification (Garland & Heckbert) with half edge collapses only,
+// so every vertex of the result is one of the input vertices and LODs can share one
+// vertex buffer. Vertices on open borders, and on attribute seams (which are borders after
+// JoinIdenticalVertices), never move, so there are no cracks.
+//
+// Stops at targetIndexCount or when the next collapse would go over maxError, whichever
+// comes first. maxError and resultError are object space distances (area weighted RMS
+// distance to the original planes around the collapsed vertex).
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                   size_t targetIndexCount, float maxError, float& resultError);
+
+// Settings for LOD chain generation at import.
+struct LodSettings
+{
+    // max error of every level past the first, relative to the bounds diagonal. At most MAX_MESH_LODS - 1.
+    std::vector<float> errorTargets { 0.001f, 0.004f, 0.016f, 0.064f };
+    // every level aims for this fraction of the previous one's triangles.
+    float reduction = 0.5f;
+};
+
+// Appends coarser levels to mesh.indices and fills mesh.lods, level 0 being what was there.
+// Levels that do not get meaningfully smaller than the previous one end the chain.
+void buildLodChain(MeshImportData& mesh, const LodSettings& settings);
+
+} // namespace render
@@ -0,0 +1,19 @@
+#pragma once
+#include "MeshImportData.hpp"
+
+#include <cstddef>
+
+namespace render {
+
+// Limits that keep a meshlet within what mesh shading hardware likes, should the
+// renderer ever go there. For CPU culling they just set the granularity.
+constexpr size_t MESHLET_MAX_VERTICES = 64;
+constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+
+// Splits every LOD of mesh into meshlets and fills mesh.meshlets and the meshlet ranges
+// of mesh.lods. Triangles are taken in index buffer order, so run it after the optimizer,
+// whose output is spatially coherent. Index buffer is left as it is and a meshlet is just
+// a range of it, surviving neighbours can be drawn with a single call.
+void buildMeshlets(MeshImportData& mesh);
+
+} // namespace render
@@ -0,0 +1,86 @@
+#pragma once
+#include "CompactVertex.hpp"
+#include "Mesh.hpp"
+#include "SceneHierarchy.hpp"
+#include "VmaVulkanBuffer.hpp"
+#include "VulkanDevice.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace render {
+
+// What a mesh of a model is made from. Vertices are either full (pointer, has to stay alive
+// until the ModelData is constructed) or already quantized, in which case data has the
+// dequantization and the mesh goes through the compact pipeline.
+struct MeshSource
+{
+    const Vertex* vertices {nullptr};
+    size_t vertexCount {0};
+    std::vector<CompactVertex> compactVertices;
+    const uint32_t* indices {nullptr};
+    size_t indexCount {0};
+
+    uint32_t node {0};
+    MeshDrawData data {};
+    std::vector<memory::TextureHandle> textures;
+
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    MeshBounds bounds;
+
+    bool isCompact() const { return not compactVertices.empty(); }
+};
+
+// GPU side of an imported model. All meshes share one index buffer, one vertex buffer per
+// vertex format and one buffer of MeshDrawData, so a whole model draws with an indirect
+// draw per pipeline. Immutable once made and shared by every Renderable of the same asset,
+// which only adds its own uniforms, node transforms and a copy of the hierarchy to pose.
+// Buffers go with the last reference, so whoever drops it must make sure no frame in flight
+// still draws it.
+class ModelData
+{
+public:
+    // uploads everything, blocks until it is on the GPU.
+    ModelData(std::shared_ptr<VulkanDevice> device, std::vector<MeshSource> sources, SceneHierarchy hierarchy);
+    ~ModelData();
+
+    ModelData(const ModelData&) = delete;
+    ModelData& operator=(const ModelData&) = delete;
+
+    const std::vector<Mesh>& getMeshes() const { return meshes; }
+    // rest pose, instances start from a copy of it.
+    const SceneHierarchy& getHierarchy() const { return hierarchy; }
+    // node index of every mesh, parallel to getMeshes().
+    const std::vector<uint32_t>& getMeshNodes() const { return meshNodes; }
+    bool hasCompactMeshes() const { return compact_vertex_buffer.getVkBuffer() != VK_NULL_HANDLE; }
+
+    // most draw commands one instance of the model can need in a frame.
+    size_t maxDraws() const { return max_draws; }
+    // meshes going through the full vertex pipeline, the rest are compact.
+    uint32_t fullMeshCount() const { return full_mesh_count; }
+
+    const memory::VmaVulkanBuffer& getIndexBuffer() const { return index_buffer; }
+    const memory::VmaVulkanBuffer& getVertexBuffer() const { return vertex_buffer; }
+    const memory::VmaVulkanBuffer& getCompactVertexBuffer() const { return compact_vertex_buffer; }
+    // MeshDrawData of every mesh, in getMeshes() order. Storage buffer.
+    const memory::VmaVulkanBuffer& getDrawDataBuffer() const { return draw_data_buffer; }
+    // MeshCullData of every mesh, same order. Storage buffer, input of GPU culling.
+    const memory::VmaVulkanBuffer& getCullDataBuffer() const { return cull_data_buffer; }
+
+private:
+    std::vector<Mesh> meshes;
+    SceneHierarchy hierarchy;
+    std::vector<uint32_t> meshNodes;
+    size_t max_draws {0};
+    uint32_t full_mesh_count {0};
+
+    memory::VmaVulkanBuffer index_buffer;
+    memory::VmaVulkanBuffer vertex_buffer;
+    memory::VmaVulkanBuffer compact_vertex_buffer; // only there if some mesh is compact.
+    memory::VmaVulkanBuffer draw_data_buffer;
+    memory::VmaVulkanBuffer cull_data_buffer;
+};
+
+} // namespace render
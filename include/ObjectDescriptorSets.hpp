@@ -0,0 +1,61 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <memory>
+#include <vector>
+
+#include "CommandStateCache.hpp"
+#include "Constants.hpp"
+#include "ModelData.hpp"
+#include "Pipeline.hpp"
+#include "SceneHierarchy.hpp"
+#include "UniformData.hpp"
+#include "VulkanDevice.hpp"
+
+namespace render {
+
+// of course we will make renderable templated in the future to allow plugging in specific UBO's
+// for different pipelines. But its okay for now.
+struct RenderableUbo {
+    glm::mat4 model;
+    float times;
+};
+
+// Object frequency set (set 1) of one drawn model, maxFramesInFlight copies of it.
+// Binding 0 is the UBO, 1 the world transform of every hierarchy node, 2 the model's MeshDrawData.
+// Shared by everything that draws a ModelData, so their shaders can declare set 1 the same way.
+class ObjectDescriptorSets
+{
+public:
+    ObjectDescriptorSets(
+            std::shared_ptr<VulkanDevice> device,
+            Pipeline& pipeline,
+            const ModelData& model);
+
+    // frees buffers and pool right away, the GPU has to be done with them.
+    ~ObjectDescriptorSets();
+
+    ObjectDescriptorSets(const ObjectDescriptorSets&) = delete;
+    ObjectDescriptorSets& operator=(const ObjectDescriptorSets&) = delete;
+
+    // hierarchy world transforms have to be up to date already.
+    void update(RenderableUbo ubo, const SceneHierarchy& hierarchy, size_t frameIndex);
+
+    void bind(CommandStateCache&, VkPipelineLayout, uint32_t frameIndex) const;
+
+    // world transforms of that frame, for passes that read them outside of set 1.
+    const memory::VmaVulkanBuffer& getNodeBuffer(uint32_t frameIndex) const { return nodeBuffers[frameIndex]; }
+
+private:
+    void createDescriptorPool();
+    void generateDescriptorSets(Pipeline& pipeline, const ModelData& model);
+
+    std::shared_ptr<VulkanDevice> device;
+    std::unique_ptr<memory::UniformData<RenderableUbo, consts::maxFramesInFlight>> uniforms;
+    std::vector<memory::VmaVulkanBuffer> nodeBuffers; // per frame in flight, stay mapped.
+    std::vector<glm::mat4> nodeTransforms; // written on CPU, then copied over in one go.
+    VkDescriptorPool descriptorPool;
+    std::vector<VkDescriptorSet> descriptorSets;
+};
+
+} // namespace render
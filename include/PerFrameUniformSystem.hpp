@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <memory>
 #include "VulkanDevice.hpp"
 #include "TextureManager.hpp"
@@ -6,6 +7,7 @@
 #include "Constants.hpp"
 #include "Pipeline.hpp"
 #include "CameraSystem.hpp"
+#include "CommandStateCache.hpp"
 
 namespace render::memory
 {
@@ -26,8 +28,13 @@ public:
                           std::shared_ptr<CameraSystem> camera,
                           std::shared_ptr<Pipeline> pipeline);
 
-    void refreshData(uint32_t setIdx);
-    void bind(VkCommandBuffer buf, uint32_t setIdx);
+    // true if the set's descriptors had to be written again, command buffers that bound it are stale then.
+    bool refreshData(uint32_t setIdx);
+    void bind(CommandStateCache& state, uint32_t setIdx);
+    // bound through the layout of what gets drawn next. Pipeline layouts with other push constant
+    // ranges are not compatible, binding set 1 with one of those would disturb set 0.
+    // Its set 0 has to be declared the same as the pipeline the sets were made for.
+    void bind(CommandStateCache& state, uint32_t setIdx, const Pipeline& drawnWith);
 
 private:
     void createDescriptorPool();
@@ -43,6 +50,8 @@ private:
 
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
+    // texture manager descriptorVersion each set was last filled at.
+    std::array<uint64_t, consts::maxFramesInFlight> filledVersions {};
 };
 
 } // namespace render
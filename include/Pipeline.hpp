@@ -28,13 +28,17 @@ public:
     // All of the pipelineLayout is created based on vertex shader right now.
     // @TODO change this in the future to support descriptors that bind only to
     // a specific pipeline shader stage.
+    // InstanceTag adds a second, per instance vertex binding (see InstanceData) next to the vertex one.
     template <typename InputVertexTag = decltype(noInputTag),
-        typename InputVertexFormat = typename InputVertexTag::type>
+        typename InstanceTag = decltype(noInputTag),
+        typename InputVertexFormat = typename InputVertexTag::type,
+        typename InstanceFormat = typename InstanceTag::type>
     Pipeline(const std::vector<Shader>& shaders,
         VkExtent2D swapChainExtent,
         VkDevice device,
         VkRenderPass renderPass,
-        InputVertexTag = noInputTag)
+        InputVertexTag = noInputTag,
+        InstanceTag = noInputTag)
         : device(device)
     {
         std::vector<VkPipelineShaderStageCreateInfo> shaderStagesCi {};
@@ -47,37 +51,33 @@ public:
             dbgI << "Shader data" << elem.pName << " module: " << elem.module << NEWL;
         }
 
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
+        // every input format brings one binding description and its attributes.
+        std::vector<VkVertexInputBindingDescription> bindings;
+        std::vector<VkVertexInputAttributeDescription> attributes;
+        auto addInput = [&bindings, &attributes](auto tag) {
+            using Format = typename decltype(tag)::type;
+            if constexpr (not std::is_same_v<PipelineNoInput, Format>) {
+                bindings.push_back(Format::getBindingDescriptor());
+                const auto& desc = Format::getAttributeDescriptors();
+                attributes.insert(attributes.end(), desc.begin(), desc.end());
+            }
+        };
 
-        if constexpr (std::is_same_v<PipelineNoInput, InputVertexFormat>) {
-            vertexInputInfo = [] {
-                VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
-                vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        addInput(vertex_input_tag<InputVertexFormat> {});
+        addInput(vertex_input_tag<InstanceFormat> {});
 
-                vertexInputInfo.vertexBindingDescriptionCount = 0;
-                vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
+        const auto vertexInputInfo = [&bindings, &attributes] {
+            VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
+            vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-                vertexInputInfo.vertexAttributeDescriptionCount = 0;
-                vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
+            vertexInputInfo.vertexBindingDescriptionCount = bindings.size();
+            vertexInputInfo.pVertexBindingDescriptions = bindings.data();
 
-                return vertexInputInfo;
-            }();
-        } else {
-            vertexInputInfo = []() {
-                VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
-                vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+            vertexInputInfo.vertexAttributeDescriptionCount = attributes.size();
+            vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
 
-                // I only support one vertex binding description now, but this can
-                // be extended in the future.
-                vertexInputInfo.vertexBindingDescriptionCount = 1;
-                vertexInputInfo.pVertexBindingDescriptions = std::addressof(InputVertexFormat::getBindingDescriptor());
-
-                vertexInputInfo.vertexAttributeDescriptionCount = InputVertexFormat::getAttributeCount();
-                vertexInputInfo.pVertexAttributeDescriptions = InputVertexFormat::getAttributeDescriptors().data();
-
-                return vertexInputInfo;
-            }();
-        }
+            return vertexInputInfo;
+        }();
 
         // Right now all set layouts are defined by vertex shader. All stages can use the UBO's, but they
         // all need to be defined in vertex shader.
@@ -91,6 +91,7 @@ public:
         }
 
         descriptorSetLayouts = it->getReflectedDescriptorSetLayouts();
+        setLayoutData = it->getSetLayoutData();
         createPipelineLayout(*it);
 
         const auto inputAssembly = [] {
@@ -240,6 +241,8 @@ public:
         assert(index < descriptorSetLayouts.size());
         return descriptorSetLayouts[index];
     }
+    // whether the vertex shader the layouts were reflected from declares binding of that type in set.
+    bool hasBinding(uint32_t set, uint32_t binding, VkDescriptorType type) const;
 
     Pipeline& operator=(Pipeline&&);
 
@@ -248,6 +251,7 @@ private:
 
     VkPipeline pipeline { VK_NULL_HANDLE };
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+    std::vector<DescriptorSetLayoutData> setLayoutData;
     VkPipelineLayout pipelineLayout { VK_NULL_HANDLE };
     VkDevice device;
 };
@@ -3,43 +3,141 @@
 #include <GLFW/glfw3.h>
 #include <memory>
 
+#include "Bvh.hpp"
+#include "CameraSystem.hpp"
+#include "ComputePipeline.hpp"
 #include "Constants.hpp"
+#include "DrawList.hpp"
+#include "GpuCulling.hpp"
 #include "Mesh.hpp"
+#include "ModelData.hpp"
+#include "ObjectDescriptorSets.hpp"
 #include "Pipeline.hpp"
-#include "UniformData.hpp"
+#include "SceneHierarchy.hpp"
+#include "SoftwareOcclusion.hpp"
 #include "VulkanDevice.hpp"
 
 namespace render {
 
-// of course we will make renderable templated in the future to allow plugging in specific UBO's
-// for different pipelines. But its okay for now.
-struct RenderableUbo {
-    glm::mat4 model;
-    float times;
+// LOD switching: a mesh uses the coarsest level whose error projects to at most
+// thresholdPixels on screen. Once picked, a level is kept until its error leaves
+// threshold * (1 +- hysteresis), so meshes sitting right at the boundary do not flicker.
+struct LodSelection
+{
+    float thresholdPixels = 1.0f;
+    float hysteresis = 0.25f;
 };
 
 /* This class will represent a renderable entity,
- * which will have its own maxFramesInFlight sets of uniforms,
- * and will contain meshes that are to be drawn on screen. */
+ * which will have its own maxFramesInFlight sets of uniforms, node transforms and draw commands,
+ * and will draw meshes of a model that might be shared with other renderables. */
 class Renderable {
 public:
     Renderable(
             std::shared_ptr<VulkanDevice> device,
             std::shared_ptr<Pipeline> pipeline,
-            std::vector<Mesh> meshes);
+            std::shared_ptr<const ModelData> model,
+            std::shared_ptr<Pipeline> compactPipeline = nullptr);
+
+    // frees uniforms and buffers right away, and the model with it if this was the last user.
+    // Renderables that might still be in flight should go through the deletion queue.
+    ~Renderable();
+
+    // also brings node world transforms up to date with whatever changed in the hierarchy
+    // and hands them to the GPU.
     void updateUniforms(RenderableUbo, size_t bufferIdx);
-    void cmdBindSetsDrawMeshes(VkCommandBuffer, uint32_t frameIndex);
+
+    // local node transforms can be changed here to animate parts of the model.
+    // Per instance, starts out as the model's rest pose.
+    SceneHierarchy& getHierarchy() { return hierarchy; }
+    const std::shared_ptr<const ModelData>& getModel() const { return modelData; }
+    // Culls whole meshes, then meshlets of visible ones, on the CPU and writes the surviving draw commands into this frame's indirect buffer.
+    // Meshes go in DrawKey order, front to back within a pipeline. With occlusion, meshes in the frustum also have to pass it,
+    // it has to be rasterized for this frame already. Only without GPU culling.
+    void prepareDraws(uint32_t frameIndex, CameraSystem& camera, float viewportHeight, SoftwareOcclusion* occlusion = nullptr);
+    // Draws what prepareDraws of the frame wrote with one indirect draw per pipeline. Records nothing if no mesh survived,
+    // unless recording is stable.
+    void cmdBindSetsDrawMeshes(CommandStateCache&, uint32_t frameIndex);
+
+    // With stable recording every pipeline gets a fixed range of the indirect buffer, padded with empty draws, so what
+    // cmdBindSetsDrawMeshes records does not depend on what prepareDraws kept and can be replayed in later frames.
+    // Needs multiDrawIndirect, false if the device does not have it and recording stays per frame.
+    bool setStableRecording(bool stable);
+    bool hasStableRecording() const { return stableRecording; }
+
+    // occluders feed their meshes' low-poly occluder geometry to software occlusion, see addOccluders.
+    void setOccluder(bool occluder) { isOccluderTagged = occluder; }
+    bool isOccluder() const { return isOccluderTagged; }
+    // posed as of the last updateUniforms.
+    void addOccluders(SoftwareOcclusion& occlusion) const;
+
+    // Moves whole mesh culling and LOD selection to a compute pass with Hi-Z occlusion culling (see GpuCulling),
+    // which drops meshlet culling and LOD hysteresis. Stays on for the rest of the renderable's life.
+    // Frames then go cmdCull EARLY, draw EARLY, build the pyramid, cmdCull LATE, draw LATE.
+    void enableGpuCulling(std::shared_ptr<ComputePipeline> cullPipeline, std::shared_ptr<DepthPyramid> depthPyramid);
+    bool gpuCullingEnabled() const { return gpuCulling != nullptr; }
+    // Outside of a render pass.
+    void cmdCull(VkCommandBuffer, uint32_t frameIndex, ECullPhase, CameraSystem& camera, float viewportHeight);
+    // Draws what cmdCull of the same frame and phase kept.
+    void cmdBindSetsDrawCulled(CommandStateCache&, uint32_t frameIndex, ECullPhase);
+
+    void setLodSelection(LodSelection selection) { lodSelection = selection; }
+
+    // index of the mesh whose bounding box a world space ray enters first, Bvh::NO_HIT if none.
+    // Box level, posed as of the last updateUniforms. hitT gets the distance in units of the ray's direction.
+    uint32_t pickMesh(const Ray& worldRay, float* hitT = nullptr) const;
+
+    // what the last prepareDraws culled. GPU culling results never come back, only objectsTested is set then.
+    const CullStats& getCullStats() const { return cullStats; }
 
 private:
-    void createDescriptorPool();
-    void generateUboDescriptorSets();
+    // mesh boxes in model space, under their node transforms.
+    std::vector<Aabb> meshBoxes() const;
+    // refits meshBvh if the hierarchy moved, and keeps its quality up with background rebuilds.
+    void updateBvh();
+    // fills meshVisible, and meshSpheres of visible meshes.
+    void cullMeshes(const glm::mat4& viewProj, SoftwareOcclusion* occlusion);
+    // visible meshes only, call after cullMeshes.
+    void selectLods(CameraSystem& camera, float viewportHeight);
+    // count commands from first on, as written to the frame's indirect buffer.
+    void cmdDrawCommands(VkCommandBuffer, uint32_t frameIndex, uint32_t first, uint32_t count);
+    // visible meshes by DrawKey, call after cullMeshes.
+    void sortVisibleMeshes(glm::vec3 cameraPos);
+    // pixels per unit of size at distance 1.
+    static float pixelsPerUnit(CameraSystem& camera, float viewportHeight);
 
     std::shared_ptr<VulkanDevice> device;
-    std::vector<Mesh> meshes;
+    std::shared_ptr<const ModelData> modelData;
+    SceneHierarchy hierarchy;
+    std::vector<size_t> meshLods; // LOD drawn last frame, parallel to model meshes.
+    LodSelection lodSelection;
+    bool isOccluderTagged {false};
+    CullStats cullStats;
+    SphereSoA meshSpheres; // world space, parallel to model meshes. Rebuilt every frame.
+    std::vector<uint8_t> meshVisible;
+    // over meshBoxes, for picking and for culling past BVH_CULL_THRESHOLD meshes.
+    Bvh meshBvh;
+    uint64_t bvhVersion {0}; // of the hierarchy meshBvh was last fit to.
+    std::vector<uint32_t> bvhHits; // scratch for queries.
+    DrawList drawList; // visible meshes of the frame, sorted.
+    glm::mat4 model {1.0f}; // from the last updateUniforms, LOD selection needs it on CPU.
     std::shared_ptr<Pipeline> pipeline;
-    std::unique_ptr<memory::UniformData<RenderableUbo, consts::maxFramesInFlight>> uniforms;
-    VkDescriptorPool descriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
+    std::shared_ptr<Pipeline> compactPipeline; // for CompactVertex meshes, layout compatible with pipeline.
+    std::unique_ptr<ObjectDescriptorSets> sets;
+    // per frame in flight, stay mapped. Room for model->maxDraws() commands.
+    std::vector<memory::VmaVulkanBuffer> indirectBuffers;
+    // written on CPU, then copied over in one go. Kept around to not reallocate every frame.
+    std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+    // what prepareDraws wrote, per frame in flight.
+    struct FrameDraws
+    {
+        uint32_t fullCount {0};
+        uint32_t compactCount {0};
+    };
+    std::vector<FrameDraws> frameDraws;
+    uint32_t fullCapacity {0}; // most commands full vertex meshes can need, the rest of maxDraws is compact.
+    bool stableRecording {false};
+    std::unique_ptr<GpuCulling> gpuCulling; // only with GPU culling enabled.
 };
 
 } // namespace render
@@ -0,0 +1,82 @@
+#pragma once
+#include "VulkanDevice.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace render::memory
+{
+
+// Size of the bindless sampler array in set 0. Nobody needs more than a handful of samplers.
+constexpr size_t SAMPLERS_MAX = 16;
+
+// Sampler 0 is always the default one, and the fallback if the cache runs full.
+constexpr uint32_t DEFAULT_SAMPLER_INDEX = 0;
+
+namespace samplerPresets
+{
+    // maxAnisotropy of 0 disables anisotropic filtering.
+    VkSamplerCreateInfo linear(VkSamplerAddressMode addressMode, float maxAnisotropy = 0.0f);
+    VkSamplerCreateInfo nearest(VkSamplerAddressMode addressMode);
+} // namespace samplerPresets
+
+// Deduplicates samplers by their full create info and hands out indices into the sampler array.
+// Anisotropy gets clamped to what the device can do, or turned off if the feature is not enabled,
+// so materials can ask for whatever they want.
+class SamplerCache
+{
+public:
+    SamplerCache(std::shared_ptr<VulkanDevice> device, const VkSamplerCreateInfo& defaultSampler);
+    // samplers still in use by frames in flight have to be waited for first.
+    ~SamplerCache();
+
+    // thread-safe. Returns DEFAULT_SAMPLER_INDEX if all sampler slots are taken.
+    // created is set when this call made a new sampler, so descriptors need writing.
+    uint32_t getOrCreate(VkSamplerCreateInfo ci, bool* created = nullptr);
+
+    // unused slots return the default sampler, so the whole array can be written to descriptors.
+    VkSampler getSampler(uint32_t index) const;
+
+private:
+    // everything from VkSamplerCreateInfo apart from sType and pNext.
+    struct Key
+    {
+        VkSamplerCreateFlags flags;
+        VkFilter magFilter;
+        VkFilter minFilter;
+        VkSamplerMipmapMode mipmapMode;
+        VkSamplerAddressMode addressModeU;
+        VkSamplerAddressMode addressModeV;
+        VkSamplerAddressMode addressModeW;
+        float mipLodBias;
+        VkBool32 anisotropyEnable;
+        float maxAnisotropy;
+        VkBool32 compareEnable;
+        VkCompareOp compareOp;
+        float minLod;
+        float maxLod;
+        VkBorderColor borderColor;
+        VkBool32 unnormalizedCoordinates;
+
+        explicit Key(const VkSamplerCreateInfo& ci);
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    void clampToDevice(VkSamplerCreateInfo& ci) const;
+
+    std::shared_ptr<VulkanDevice> device;
+
+    mutable std::mutex mut;
+    std::unordered_map<Key, uint32_t, KeyHash> indices;
+    std::array<VkSampler, SAMPLERS_MAX> samplers{};
+    uint32_t count{0};
+};
+
+} // namespace render::memory
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Culling.hpp"
+#include "EntitySlots.hpp"
+#include "InstanceData.hpp"
+#include "InstancedRenderable.hpp"
+
+namespace render {
+
+enum EntityFlags : uint8_t
+{
+    ENTITY_HIDDEN = 1 << 0, // stays in the scene, never visible.
+    ENTITY_MOVED = 1 << 1, // transform changed since the last updateBounds.
+};
+
+/* Lots of plain objects kept as components in parallel arrays, addressed by Entity.
+ * Live entities are packed at the front of every array (destroy moves the last one into the hole),
+ * so the per frame systems walk straight through memory: updateBounds, cull, buildDraws, in that order.
+ *
+ * An entity only refers to its model by index. Each model gets drawn once per frame for all its
+ * visible entities through an InstancedRenderable, rather than every object being a Renderable
+ * with its own device, pipeline, sets and buffers. So no per object hierarchy, LODs or meshlets. */
+class Scene {
+public:
+    // entities of the model are drawn as instances by instancer. Returns the model index create takes.
+    uint32_t addModel(std::shared_ptr<InstancedRenderable> instancer);
+    const std::vector<std::shared_ptr<InstancedRenderable>>& getModels() const { return models; }
+
+    Entity create(uint32_t model, const glm::mat4& transform);
+    // nothing for handles that do not resolve anymore.
+    void destroy(Entity);
+    bool alive(Entity entity) const { return entities.alive(entity); }
+    size_t size() const { return transforms.size(); }
+
+    // entity has to be alive.
+    const glm::mat4& getTransform(Entity) const;
+    void setTransform(Entity, const glm::mat4& transform);
+    void setHidden(Entity, bool hidden);
+
+    // world space bounding spheres of entities that moved.
+    void updateBounds();
+    // every entity against the frustum of viewProj, after updateBounds.
+    void cull(const glm::mat4& viewProj);
+    // visible entities of the last cull become instances of their model's instancer.
+    // Frames in flight pick them up at the instancer's next updateUniforms.
+    void buildDraws();
+
+    // of the last cull and buildDraws, draws counts one per mesh of every model with instances.
+    const CullStats& getCullStats() const { return cullStats; }
+
+private:
+    // per model.
+    std::vector<std::shared_ptr<InstancedRenderable>> models;
+    std::vector<glm::vec4> modelSpheres; // rest pose of the whole model, xyz center and w radius.
+    std::vector<std::vector<InstanceData>> batches; // what buildDraws collects for each.
+
+    EntitySlots entities;
+
+    // per entity, packed like entities.
+    std::vector<glm::mat4> transforms;
+    std::vector<uint32_t> entityModels;
+    std::vector<uint8_t> flags;
+    SphereSoA bounds; // world space.
+    std::vector<uint8_t> visible;
+
+    CullStats cullStats;
+};
+
+} // namespace render
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace render {
+
+// Flattened node tree of a model. Every node is an index into parallel arrays,
+// and nodes are stored so that a parent always comes before its children.
+// That way world transforms are one linear pass over the arrays, no recursion
+// and no per-node heap objects.
+class SceneHierarchy
+{
+public:
+    static constexpr int32_t NO_PARENT = -1;
+
+    // parent has to be added already (or NO_PARENT), which is what keeps the ordering valid.
+    uint32_t addNode(int32_t parent, glm::vec3 translation, glm::quat rotation, glm::vec3 scale);
+
+    // parents first, so world[parent] is always up to date by the time a child reads it.
+    // Nothing to do unless a node was added or a local transform handed out for changing since the last one.
+    void updateWorldTransforms();
+    // goes up with every updateWorldTransforms that did something, so users can tell world() changed.
+    uint64_t version() const { return worldVersion; }
+
+    size_t size() const { return parents.size(); }
+    int32_t parent(uint32_t node) const { return parents[node]; }
+
+    // local TRS, relative to the parent. Changes show up after next updateWorldTransforms().
+    glm::vec3& translation(uint32_t node) { dirty = true; return translations[node]; }
+    glm::quat& rotation(uint32_t node) { dirty = true; return rotations[node]; }
+    glm::vec3& scale(uint32_t node) { dirty = true; return scales[node]; }
+    const glm::vec3& translation(uint32_t node) const { return translations[node]; }
+    const glm::quat& rotation(uint32_t node) const { return rotations[node]; }
+    const glm::vec3& scale(uint32_t node) const { return scales[node]; }
+
+    const glm::mat4& world(uint32_t node) const { return worlds[node]; }
+
+private:
+    std::vector<int32_t> parents;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> worlds;
+    bool dirty {false};
+    uint64_t worldVersion {0};
+};
+
+} // namespace render
@@ -10,6 +10,7 @@ namespace render {
 enum class EShaderType {
     VERTEX_SHADER,
     FRAGMENT_SHADER,
+    COMPUTE_SHADER,
 };
 
 struct DescriptorSetLayoutData {
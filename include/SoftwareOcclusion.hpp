@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace render {
+
+// Low-poly stand in for a mesh, drawn into the SoftwareOcclusion depth buffer. Has to stay
+// inside the real surface, whatever it covers is taken as hidden behind it. A simplified LOD does
+// not, it can stick out by up to its error, so those only occlude while that stays under
+// MAX_OCCLUDER_ERROR_PIXELS on screen.
+struct OccluderMesh
+{
+    std::vector<glm::vec3> positions; // object space, same as the mesh.
+    std::vector<uint32_t> indices;
+    float error {0.0f}; // object space, how far from the real surface it may be. 0 for the full mesh.
+
+    bool empty() const { return indices.empty(); }
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+
+// Occluders with more triangles than this are not worth rasterizing on the CPU.
+constexpr size_t MAX_OCCLUDER_TRIANGLES = 1024;
+// Simplified occluders off by more than this on screen get skipped for the frame.
+constexpr float MAX_OCCLUDER_ERROR_PIXELS = 0.5f;
+
+// What one frame of software occlusion did and what it cost.
+struct OcclusionStats
+{
+    uint32_t occluderTriangles {0}; // that made it into bins, off screen and near plane ones do not.
+    uint32_t occludersTooCoarse {0}; // skipped for their error, see MAX_OCCLUDER_ERROR_PIXELS.
+    uint32_t boxesTested {0};
+    uint32_t boxesOccluded {0};
+    float setupMs {0.0f}; // transforming and binning occluders.
+    float rasterMs {0.0f};
+    float testMs {0.0f};
+
+    float totalMs() const { return setupMs + rasterMs + testMs; }
+};
+
+// Occlusion culling on the CPU, for when GPU culling is off or not there (lavapipe and friends).
+// Every frame goes beginFrame, addOccluder for each tagged occluder, rasterize, then boxVisible
+// for whatever is about to be recorded. Occluders end up in a small depth buffer keeping the
+// nearest depth per pixel, a box is hidden if its nearest point is behind every pixel it covers.
+// Rows are split into bands that rasterize on OpenMP threads, the rest runs on the caller's.
+class SoftwareOcclusion
+{
+public:
+    static constexpr uint32_t WIDTH = 256;
+    static constexpr uint32_t HEIGHT = 128;
+    static constexpr uint32_t BAND_ROWS = 8;
+
+    SoftwareOcclusion();
+
+    // clears depth and stats. viewProj is what the frame draws with, OpenGL style clip space.
+    void beginFrame(const glm::mat4& viewProj);
+    // model takes the occluder's positions to world space.
+    void addOccluder(const OccluderMesh& occluder, const glm::mat4& model);
+    void rasterize();
+
+    // object space box under model, after rasterize. Anything crossing the near plane or
+    // not behind occluders all over is visible.
+    bool boxVisible(const glm::mat4& model, glm::vec3 min, glm::vec3 max);
+
+    const OcclusionStats& getStats() const { return stats; }
+    // ndc z, row major WIDTH * HEIGHT. 1 where nothing got drawn.
+    const std::vector<float>& getDepth() const { return depth; }
+
+private:
+    // screen space setup, edge functions are >= 0 inside whichever way the triangle winds.
+    struct Triangle
+    {
+        float edgeA[3], edgeB[3], edgeC[3]; // A * x + B * y + C
+        float z0, dzdx, dzdy; // depth plane, z0 at the origin.
+        int minX, maxX, minY, maxY; // pixels whose centers might be inside.
+    };
+
+    void rasterizeRows(const Triangle& tri, int rowBegin, int rowEnd);
+
+    glm::mat4 viewProj {1.0f};
+    float pixelsPerUnit {0.0f}; // most pixels a world space unit at w = 1 can span.
+    std::vector<float> depth;
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> bins; // triangle indices per band of rows.
+    std::vector<glm::vec4> clipPositions; // scratch for addOccluder.
+    OcclusionStats stats;
+};
+
+} // namespace render
@@ -2,66 +2,191 @@
 #pragma once
 #include "VulkanDevice.hpp"
 #include "VulkanImage.hpp"
+#include "SamplerCache.hpp"
+#include "utils/IndexFreeList.hpp"
+#include "utils/SingleFlightCache.hpp"
 
 #include <memory>
-#include <map>
 #include <array>
 #include <atomic>
-#include <shared_mutex>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace render::memory
 {
 
 // This class shall only provide descriptors, and not whole uniform buffer object,
 // as it is meant to be used as part of per-frame rebind frequency system.
-// Indices of textures can be passed in as push constants on per-object basis.
+// Indices of textures reach the shaders through per draw data (MeshDrawData).
 
 // Arbitrary limit, can be easily extended in the future. But it has to be there
 // as we need a hard limit on texture array in our shaders.
 constexpr size_t TEXTURES_MAX = 4096;
 
+// Last slot is never handed out and always points to the placeholder image.
+constexpr uint32_t PLACEHOLDER_TEXTURE_INDEX = TEXTURES_MAX - 1;
+
+// Textures up to this size get packed as layers of a shared image by loadTexturesPacked.
+constexpr uint32_t PACKED_TEXTURE_MAX_DIM = 256;
+// well under the 256 layers every device has to support.
+constexpr uint32_t PACKED_TEXTURE_MAX_LAYERS = 64;
+
 // will be used to write to per-frame descriptor set.
-// @TODO: Bring the descriptors and samplerDescriptor into private members as they are not necessary.
+// @TODO: Bring the descriptors and samplerDescriptors into private members as they are not necessary.
 // Make a generic BindingInformation struct along with IPerFrameSystem interface that will be enforced.
 
 struct BindingInformationTextures
 {
     std::vector<VkDescriptorPoolSize> poolSizes;
     std::array<VkDescriptorImageInfo, TEXTURES_MAX> descriptors{};
-    VkDescriptorImageInfo samplerDescriptor{};
+    std::array<VkDescriptorImageInfo, SAMPLERS_MAX> samplerDescriptors{};
+};
+
+class TextureManager;
+
+// Refcounted reference to a loaded texture. Copies share the slot, and once the last
+// one goes away the texture gets unloaded and its slot recycled.
+// Empty handle resolves to the placeholder texture.
+class TextureHandle
+{
+public:
+    TextureHandle() = default;
+
+    uint32_t index() const { return slot ? slot->index : PLACEHOLDER_TEXTURE_INDEX; }
+    bool valid() const { return static_cast<bool>(slot); }
+
+private:
+    friend class TextureManager;
+
+    struct Slot
+    {
+        Slot(uint32_t index, std::string path, std::weak_ptr<TextureManager> owner);
+        ~Slot();
+
+        uint32_t index;
+        std::string path;
+        std::weak_ptr<TextureManager> owner;
+    };
+
+    explicit TextureHandle(std::shared_ptr<Slot> slot) : slot(std::move(slot)) {}
+
+    std::shared_ptr<Slot> slot;
 };
 
-class TextureManager
+// Has to be owned by a shared_ptr, handles keep a weak reference back to it.
+class TextureManager : public std::enable_shared_from_this<TextureManager>
 {
 public:
     TextureManager(std::shared_ptr<VulkanDevice> device);
+    // has to go before the device, after frames in flight are done with its textures.
+    ~TextureManager();
 
-    // returns texture indice. Unloading shall not be supported for now.
-    // If already loaded, get indice.
-    size_t loadTexture(const std::string& path);
+    // If already loaded, returns handle to the same slot. Safe to call from many threads,
+    // concurrent requests for the same path share a single decode and upload.
+    // Invalid images and exhausted slots give out an empty (placeholder) handle.
+    // Paths are cached lexically normalized, the way AssetWatcher reports them.
+    TextureHandle loadTexture(const std::string& path);
+
+    // Packs single channel maps into one RGBA8 UNORM texture, in order:
+    // R = ambient occlusion, G = specular/roughness, B = metallic, A = height.
+    // Red channel of every source is used, empty paths get neutral defaults.
+    TextureHandle loadPackedMaterial(const std::array<std::string, 4>& channel_paths);
+
+    // Loads textures of a whole model at once. Small textures of the same size get packed
+    // as layers of one image, so they share a single allocation. Every layer still gets
+    // its own slot and 2D view, so shaders do not care. Handles match paths by position.
+    std::vector<TextureHandle> loadTexturesPacked(const std::vector<std::string>& paths);
+    // Index into the bindless sampler array, to be passed along with texture indices.
+    uint32_t getSamplerIndex(const VkSamplerCreateInfo& ci);
+
+    // Hot reload. Decodes and uploads every live texture built from path again, packed
+    // materials using it as a channel included, and queues them up for applyReloads().
+    // Blocks on the upload, meant for loader threads. false if nothing uses path.
+    bool reloadTexture(const std::string& path);
+    // by extension, whether reloadTexture could have anything to do with path.
+    static bool isTextureFile(const std::string& path);
+
+    // Swaps reloaded textures into their slots, so handles and indices stay the same.
+    // Call at a frame boundary, before descriptor sets of the frame are filled.
+    // Old images are retired through the deletion queue.
+    void applyReloads();
+
+    // pool sizes only, the descriptor arrays change from other threads.
     const BindingInformationTextures& getBindingInformation() { return binding_info; }
+    // thread-safe against loads and releases writing descriptors.
     void fillDescriptorSet(VkDescriptorSet);
+    // bumped whenever what fillDescriptorSet would write changes, sets filled at an older one are stale.
+    uint64_t descriptorVersion() const { return descriptor_version.load(std::memory_order_acquire); }
 
 
 private:
+    friend class TextureHandle;
+
     void createPlaceholderImage();
-    void createSampler();
     void initialBindingInformationCreation();
-    void generateDescriptorEntry(size_t texture_index);
+    void generateDescriptorEntry(uint32_t texture_index);
+
+    // single-flight through the texture cache, create runs only on a miss.
+    TextureHandle loadCached(const std::string& key,
+        const std::function<std::shared_ptr<TextureHandle::Slot>()>& create);
 
-    std::map<std::string, size_t>::iterator findInIndexMapSafe(const std::string& key);
-    void setInIndexMapSafe(const std::string& key, size_t value);
+    // decodes, uploads and takes a free slot. nullptr on failure.
+    std::shared_ptr<TextureHandle::Slot> createTextureSlot(const std::string& path);
+    std::shared_ptr<TextureHandle::Slot> createPackedMaterialSlot(
+        const std::string& key, const std::array<std::string, 4>& channel_paths);
+    std::shared_ptr<TextureHandle::Slot> createSlotFromPixels(const std::string& key,
+        const void* data, size_t size, uint32_t width, uint32_t height, VkFormat format);
+    std::shared_ptr<VulkanImage> createImage(const void* data, size_t size, uint32_t width, uint32_t height, VkFormat format);
+
+    // packs all the same-sized textures into one layered image. Failed ones get nullptr.
+    std::vector<std::shared_ptr<TextureHandle::Slot>> createPackedTextureSlots(
+        const std::vector<std::string>& paths, uint32_t width, uint32_t height);
+
+    // called by the last TextureHandle of a slot.
+    void releaseSlot(uint32_t texture_index, const std::string& path);
 
     std::shared_ptr<VulkanDevice> device;
     std::unique_ptr<VulkanImage> placeholder_image;
 
-    // I will make a real mt wrapper for map later and use that.
-    std::atomic<size_t> num_of_textures{0};
-    std::shared_mutex index_map_mut;
-    std::map<std::string, size_t> index_map;
-    std::array<std::unique_ptr<VulkanImage>, TEXTURES_MAX> textures;
-    VkSampler sampler;
+    // path -> slot. Holds weak references only, so it does not keep textures alive.
+    SingleFlightCache<std::weak_ptr<TextureHandle::Slot>> texture_cache;
+
+    // Slots go back here only after frames that could sample them have retired.
+    IndexFreeList<TEXTURES_MAX> free_slots{PLACEHOLDER_TEXTURE_INDEX};
+    struct TextureEntry
+    {
+        // shared by all layers of a packed image, destroyed with the last one.
+        std::shared_ptr<VulkanImage> image;
+        VkImageView view{VK_NULL_HANDLE};
+        // packed layers have their own view, others use the image's one.
+        bool owns_view{false};
+    };
+
+    // destroys entry once frames in flight are done with it, then frees free_index if given.
+    void retireEntry(TextureEntry entry, std::optional<uint32_t> free_index);
+
+    std::array<TextureEntry, TEXTURES_MAX> textures;
+
+    struct PendingReload
+    {
+        std::weak_ptr<TextureHandle::Slot> slot;
+        TextureEntry entry;
+    };
+
+    // reload_mut guards both. Packed materials are kept by key so a changed channel finds them.
+    std::mutex reload_mut;
+    std::vector<PendingReload> pending_reloads;
+    std::unordered_map<std::string, std::array<std::string, 4>> packed_materials;
+    SamplerCache samplers;
 
+    // descriptor_mut guards the descriptor arrays of binding_info after construction. Loader threads
+    // and whoever drops the last handle write them while the render thread hands them to the device.
+    std::mutex descriptor_mut;
     BindingInformationTextures binding_info;
+    std::atomic<uint64_t> descriptor_version {0};
 };
 } // namespace render::memory
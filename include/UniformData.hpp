@@ -122,6 +122,9 @@ public:
         return descriptors;
     }
 
+    // no frame in flight may still read it.
+    void destroy() { ubo_buffer.destroy(); }
+
     T* data() { return ubo_arr.data(); }
 
     T* buf_data() { return (T*)ubo_buffer.mem(); }
@@ -0,0 +1,52 @@
+#pragma once
+#include "VulkanDevice.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace render::memory {
+
+// Collects uploads to GPU-only buffers and does all of them with a single staging
+// buffer and a single blocking submit, instead of a staging buffer and a queue
+// round trip per buffer.
+class UploadBatch
+{
+public:
+    explicit UploadBatch(std::shared_ptr<VulkanDevice> device);
+
+    // data is not copied until submit(), so it has to stay alive until then.
+    // dst needs VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+    void add(const void* data, size_t size, VkBuffer dst, VkDeviceSize dstOffset = 0);
+
+    // same, but the batch keeps data alive itself. For data converted right before upload.
+    template <typename T>
+    void add(std::vector<T> data, VkBuffer dst, VkDeviceSize dstOffset = 0)
+    {
+        // moving a vector keeps its storage where it was, so the pointer stays good.
+        auto held = std::make_shared<std::vector<T>>(std::move(data));
+        add(held->data(), held->size() * sizeof(T), dst, dstOffset);
+        owned.push_back(std::move(held));
+    }
+
+    // blocks until everything is on the GPU. Batch is empty and reusable afterwards.
+    void submit();
+
+    size_t pendingBytes() const { return totalSize; }
+
+private:
+    struct Region
+    {
+        const void* data;
+        size_t size;
+        VkBuffer dst;
+        VkDeviceSize dstOffset;
+        VkDeviceSize stagingOffset;
+    };
+
+    std::shared_ptr<VulkanDevice> device;
+    std::vector<Region> regions;
+    std::vector<std::shared_ptr<const void>> owned;
+    size_t totalSize{0};
+};
+
+} // namespace render::memory
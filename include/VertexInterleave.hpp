@@ -0,0 +1,25 @@
+#pragma once
+#include "Vertex.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace render {
+
+// Separate attribute streams, the way importers (Assimp) hand them out.
+// Every stream is tightly packed xyz float triplets, texCoords use only xy of each.
+// nullptr streams end up as zeroes.
+struct VertexStreams
+{
+    const float* positions;
+    const float* normals;
+    const float* tangents;
+    const float* texCoords;
+};
+
+// SoA -> AoS into dst[0, count). Uses SSE2 when available, falls back to scalar otherwise.
+void interleaveVertices(const VertexStreams& streams, size_t count, Vertex* dst);
+
+// Reference implementation, also used to validate the SIMD path in debug builds.
+void interleaveVerticesScalar(const VertexStreams& streams, size_t count, Vertex* dst);
+
+} // namespace render
@@ -50,6 +50,13 @@ public:
     {
     }
 
+    // allocation only, contents get filled later (UploadBatch, mapping).
+    VmaVulkanBuffer(
+        std::shared_ptr<VulkanDevice> device,
+        size_t size,
+        VkBufferUsageFlags vk_flags,
+        VmaMemoryUsage vma_usage);
+
     VmaVulkanBuffer() {};
     ~VmaVulkanBuffer() {};
 
@@ -61,6 +68,9 @@ public:
     VmaAllocation getVmaAllocation() const { return buffer.allocation; }
     const VkDescriptorBufferInfo& getDescriptor() const { return buffer.descriptor; }
 
+    // no dtor cleanup as copies share the handle, owner calls this once GPU is done.
+    void destroy();
+
     void map();
     void unmap();
     void* mem();
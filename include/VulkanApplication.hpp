@@ -11,10 +11,15 @@
 #include "VulkanInstance.hpp"
 #include "VulkanSwapchain.hpp"
 #include "Renderable.hpp"
+#include "AssetWatcher.hpp"
 #include "TextureManager.hpp"
 #include "AssetLoader.hpp"
 #include "PerFrameUniformSystem.hpp"
 #include "CameraSystem.hpp"
+#include "ComputePipeline.hpp"
+#include "DepthPyramid.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "Scene.hpp"
 
 namespace render {
 
@@ -30,15 +35,33 @@ private:
     void createSurface();
     void createGraphicsPipeline();
     void createOffscreenFramebuffer();
+    // scene_grid copies of scene_path along x and z, instead of the one Renderable.
+    void createScene();
     void createCommandPool();
     void createCommandBuffers();
+    void createSecondaryCommandBuffers();
     void recordCommandBuffers(uint32_t swapchainImageIdx, uint32_t frameInFlightIdx);
+    // rasterizes this frame's occluders, nullptr if software occlusion is off.
+    SoftwareOcclusion* prepareSoftwareOcclusion();
+    // two render passes with the depth pyramid built in between, for GPU culled renderables.
+    void recordOcclusionCulledFrame(VkCommandBuffer cmd, const VkRenderPassBeginInfo& beginInfo, uint32_t frameInFlightIdx);
+    // one render pass, its contents inline or replayed from cachedPasses. phase only for GPU culled renderables.
+    void recordPass(VkCommandBuffer cmd, const VkRenderPassBeginInfo& beginInfo, uint32_t frameInFlightIdx,
+                    std::optional<ECullPhase> phase);
+    void recordPassContents(CommandStateCache& state, uint32_t frameInFlightIdx, std::optional<ECullPhase> phase);
+    bool canCacheRecording() const;
     void createSyncObjects();
 
     void drawFrame();
 
     void updateUbos(size_t frameIdx);
+    // updateBounds, cull and buildDraws of the scene, then its instancers pick up the batches.
+    void updateScene(size_t frameIdx, const RenderableUbo& ubo);
     void render();
+    // frame boundary: kicks off reloads of changed assets and swaps in the finished ones.
+    void processAssetChanges();
+    // keeps r alive until frames that might draw it have retired.
+    void retireRenderable(std::shared_ptr<Renderable> r);
     void sendBufferToQueue(uint32_t imageIndex, size_t inFlightFrameNo);
 
     // downright retarded.
@@ -59,14 +82,51 @@ private:
     std::shared_ptr<CameraSystem> cameraSystem;
     std::shared_ptr<AssetLoader> assetLoader;
     std::shared_ptr<Pipeline> pipeline;
+    std::shared_ptr<Pipeline> compactPipeline;
+    std::shared_ptr<Pipeline> instancedPipeline; // only there with scene_grid.
+    std::shared_ptr<ComputePipeline> cullPipeline; // only there with gpu_culling on a device that can.
+    std::shared_ptr<DepthPyramid> depthPyramid; // same, built from the swapchain framebuffer's depth.
     std::shared_ptr<memory::PerFrameUniformSystem> perFrameData;
 
+    std::unique_ptr<AssetWatcher> assetWatcher;
+
+    const std::string scene_path = "assets/backpack/backpack.obj";
+    // cull meshes (frustum and occlusion) and pick LODs in compute passes instead of on the CPU,
+    // see Renderable::enableGpuCulling.
+    const bool gpu_culling = false;
+    // CPU occlusion culling against the scene's own low-poly occluders, when not culling on the GPU.
+    const bool software_occlusion = false;
+    std::unique_ptr<SoftwareOcclusion> softwareOcclusion;
+    // above 0 the asset is drawn as a scene_grid * scene_grid Scene of instanced entities, culled
+    // on the CPU as a whole, in place of the Renderable. No hot reload, LODs or GPU culling then.
+    const uint32_t scene_grid = 0;
+    const float scene_spacing = 4.0f;
+    std::unique_ptr<Scene> scene;
     std::shared_ptr<Renderable> to_render_test;
+    // in flight until it is done, frames draw its proxy meanwhile.
+    std::shared_ptr<LoadHandle> pending_load;
+    // whatever this frame draws, picked once so recording and ubo updates agree.
+    std::shared_ptr<Renderable> frame_renderable;
 
     // @TODO: change amount of commandBuffers to consts::maxFramesInFlight
     VkCommandPool commandPool;
     std::vector<VkCommandBuffer> commandBuffers;
 
+    // record render pass contents once and replay them until the renderable, pipelines or framebuffers
+    // change. Per frame data keeps coming in through uniforms and indirect buffers.
+    const bool cache_recording = false;
+    VkCommandPool secondaryCommandPool;
+    struct CachedPass
+    {
+        VkCommandBuffer commandBuffer {VK_NULL_HANDLE};
+        VkRenderPass renderPass {VK_NULL_HANDLE}; // recorded for, split passes are not the same one.
+        uint64_t version {0}; // recordingVersion it was recorded at, 0 for never.
+    };
+    // per frame in flight, one per split pass. Without GPU culling only the first is used.
+    std::array<std::array<CachedPass, 2>, consts::maxFramesInFlight> cachedPasses;
+    // bumped when what passes record changes for every frame.
+    uint64_t recordingVersion {1};
+
     // move to its own class later?
     struct FrameSyncData
     {
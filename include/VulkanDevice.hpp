@@ -2,9 +2,11 @@
 #define GLFW_INCLUDE_VULKAN
 #include "vk_mem_alloc.h"
 #include <GLFW/glfw3.h>
+#include "DeletionQueue.hpp"
 #include <optional>
 #include <vector>
 #include <functional>
+#include <mutex>
 
 namespace render {
 struct QueueFamiliesIndices {
@@ -32,23 +34,46 @@ public:
     VkQueue getGraphicsQueue() const { return graphicsQueue; }
     VkQueue getPresentationQueue() const { return presentationQueue; }
     VmaAllocator getVmaAllocator() const { return allocator; }
+    const VkPhysicalDeviceProperties& getProperties() const { return deviceProperties; }
+    const VkPhysicalDeviceFeatures& getEnabledFeatures() const { return enabledFeatures; }
+    // VK_KHR_draw_indirect_count is optional, callers fall back to plain indirect draws without it.
+    bool hasDrawIndirectCount() const { return drawIndirectCount; }
+    void cmdDrawIndexedIndirectCount(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset,
+        VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCount, uint32_t stride) const
+    {
+        pfnDrawIndexedIndirectCount(cmd, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+    }
+    // Thread-safe, but uploads get serialized on a single fence and pool.
     void immediateSubmitBlocking(std::function<void(VkCommandBuffer)> func);
 
+    // resources released while frames are still in flight go here.
+    memory::DeletionQueue& getDeletionQueue() { return deletionQueue; }
+
+    // VkQueue access has to be externally synchronized, and loader threads submit uploads
+    // while the render loop submits frames. Hold this around any vkQueue* call.
+    std::unique_lock<std::mutex> lockQueues() { return std::unique_lock(queueMut); }
+
 private:
     VkPhysicalDevice vkPhysicalDevice;
     VkPhysicalDeviceProperties deviceProperties;
     VkPhysicalDeviceFeatures deviceFeatures;
     VkPhysicalDeviceMemoryProperties deviceMemProperties;
     QueueFamiliesIndices queueIndices;
+    VkPhysicalDeviceFeatures enabledFeatures;
+    bool drawIndirectCount {false};
     VkDevice vkLogicalDevice;
+    PFN_vkCmdDrawIndexedIndirectCountKHR pfnDrawIndexedIndirectCount {nullptr};
     VkQueue graphicsQueue;
     VkQueue presentationQueue;
     VmaAllocator allocator;
+    memory::DeletionQueue deletionQueue;
+    std::mutex queueMut;
 
     struct
     {
         VkFence uploadFence;
         VkCommandPool uploadCommandPool;
+        std::mutex mut;
     } uploadContext;
 };
 
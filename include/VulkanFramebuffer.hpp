@@ -5,6 +5,7 @@
 #include "VulkanDevice.hpp"
 #include "vk_mem_alloc.h"
 #include <GLFW/glfw3.h>
+#include <cassert>
 #include <optional>
 #include <memory>
 
@@ -20,6 +21,14 @@ enum class EFramebufferAttachmentType {
     ATTACHMENT_SWAPCHAIN_PRESENT_COLOR,
 };
 
+// Frames that need depth half way through (occlusion culling) draw in two render passes.
+// FIRST clears and keeps everything, depth readable by shaders afterwards. SECOND loads it all
+// back and presents. Both are compatible with getRenderPass(), so are pipelines and framebuffers.
+enum class ESplitPass {
+    FIRST,
+    SECOND,
+};
+
 struct FramebufferAttachmentInfo {
     memory::VulkanImageCreateInfo ci;
     EFramebufferAttachmentType type;
@@ -44,6 +53,20 @@ public:
 
     VkAttachmentDescription getAttachmentDescription(EFramebufferAttachmentType type);
     VkRenderPass getRenderPass() { return renderPass; }
+    // only for present framebuffers with a depth attachment.
+    VkRenderPass getSplitRenderPass(ESplitPass part)
+    {
+        assert(depthAttachment);
+        return splitRenderPasses[static_cast<size_t>(part)];
+    }
+
+    // the implicit one of present framebuffers. Sampled usage, so it can be read after ESplitPass::FIRST.
+    memory::VulkanImage& getDepthAttachment()
+    {
+        assert(depthAttachment);
+        return *depthAttachment;
+    }
+    VkExtent2D getExtent() const { return { width, height }; }
 
     size_t size() { return framebuffers.size(); }
 
@@ -53,7 +76,7 @@ public:
     }
 
 private:
-    void createRenderPass();
+    VkRenderPass createRenderPass(std::optional<ESplitPass> split = {});
     void createFramebuffer();
     memory::VulkanImage createDepthAttachment();
     size_t getAttachmentDescriptionIndex(EFramebufferAttachmentType type);
@@ -77,6 +100,7 @@ private:
     std::optional<memory::VulkanImage> depthAttachment;
 
     VkRenderPass renderPass;
+    VkRenderPass splitRenderPasses[2] { VK_NULL_HANDLE, VK_NULL_HANDLE };
     uint32_t width, height;
 };
 
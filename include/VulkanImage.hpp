@@ -22,12 +22,24 @@ struct VulkanImageCreateInfo {
 class VulkanImage {
 public:
     VulkanImage(const VulkanImageCreateInfo& ci, std::shared_ptr<VulkanDevice> device);
+    // data has to hold all layers one after another, tightly packed.
     VulkanImage(const VulkanImageCreateInfo& ci, std::shared_ptr<VulkanDevice> device,
             const void* data, size_t size);
 
     // ctor for wrapping previously allocated images (swapchain)
     VulkanImage(VkImage image, VkImageView imageView, VkFormat format, VkImageSubresourceRange range);
     //~VulkanImage(); // @TODO
+
+    // VulkanImage is copied around as a plain handle wrapper, so there is no dtor yet.
+    // Owner has to call this explicitly, once GPU is done with the image.
+    void destroy();
+
+    // 2D view of a single array layer, for images holding several textures as layers.
+    // Caller owns the view and has to destroy it before the image.
+    VkImageView createLayerView(uint32_t layer);
+    // 2D view of levelCount mip levels from baseLevel on. Same ownership as createLayerView.
+    VkImageView createMipView(uint32_t baseLevel, uint32_t levelCount);
+
     bool hasDepth();
     bool hasStencil();
     bool hasDepthOrStencil();
@@ -46,8 +58,8 @@ private:
     VmaAllocation allocation { VK_NULL_HANDLE };
     VmaAllocationInfo allocationInfo {};
 
-    VkImage vkImage;
-    VkImageView vkImageView;
+    VkImage vkImage { VK_NULL_HANDLE };
+    VkImageView vkImageView { VK_NULL_HANDLE };
     VkFormat format;
     VkImageSubresourceRange subresourceRange;
     VulkanImageCreateInfo creationData{};
@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+
+// Lock-free LIFO of free slot indices (Treiber stack), used to recycle fixed-size
+// resource tables like the bindless texture array.
+// Head is packed as {tag:32, index:32} into one 64-bit atomic, and every successful
+// CAS bumps the tag. Thanks to that a pop that raced with pop-push of the same index
+// will fail its CAS instead of corrupting the list (ABA).
+template <uint32_t N>
+class IndexFreeList
+{
+public:
+    static constexpr uint32_t invalid_index = UINT32_MAX;
+
+    // indices [0, count) start as free.
+    explicit IndexFreeList(uint32_t count = N)
+    {
+        assert(count <= N);
+        for (uint32_t i = 0; i < N; ++i)
+        {
+            next[i].store((i + 1 < count) ? i + 1 : invalid_index, std::memory_order_relaxed);
+        }
+
+        head.store(pack(count > 0 ? 0 : invalid_index, 0), std::memory_order_release);
+    }
+
+    IndexFreeList(const IndexFreeList&) = delete;
+    IndexFreeList& operator=(const IndexFreeList&) = delete;
+
+    std::optional<uint32_t> pop()
+    {
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        while (true)
+        {
+            uint32_t index = indexOf(old_head);
+            if (index == invalid_index)
+            {
+                return std::nullopt;
+            }
+
+            // next[index] might be stale if someone popped and pushed index in the meantime,
+            // but then the tag changed and CAS below fails.
+            uint32_t next_index = next[index].load(std::memory_order_relaxed);
+            uint64_t new_head = pack(next_index, tagOf(old_head) + 1);
+
+            if (head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                return index;
+            }
+        }
+    }
+
+    void push(uint32_t index)
+    {
+        assert(index < N);
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        uint64_t new_head;
+        do
+        {
+            next[index].store(indexOf(old_head), std::memory_order_relaxed);
+            new_head = pack(index, tagOf(old_head) + 1);
+        } while (not head.compare_exchange_weak(old_head, new_head,
+                     std::memory_order_release, std::memory_order_relaxed));
+    }
+
+private:
+    static uint64_t pack(uint32_t index, uint32_t tag) { return (uint64_t(tag) << 32) | index; }
+    static uint32_t indexOf(uint64_t packed) { return static_cast<uint32_t>(packed); }
+    static uint32_t tagOf(uint64_t packed) { return static_cast<uint32_t>(packed >> 32); }
+
+    std::atomic<uint64_t> head;
+    std::array<std::atomic<uint32_t>, N> next;
+};
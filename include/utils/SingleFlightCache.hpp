@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Concurrent string-keyed cache with single-flight loading.
+// Keys are spread over independently locked shards by their hash. The first caller
+// for a key runs the load function outside of the shard lock, every other caller for
+// the same key blocks on a shared_future of that one load. So no duplicate work and
+// no lock held while decoding/uploading.
+template <typename Value, size_t ShardCount = 16>
+class SingleFlightCache
+{
+public:
+    // Returns the cached value for key, or loads it. `is_valid` is checked on finished
+    // entries only, an entry failing it is treated as missing and loaded again
+    // (useful when Value is a weak reference). Exception thrown by `load` is passed
+    // to everyone waiting on it and the entry is dropped, so the next call retries.
+    template <typename Load, typename IsValid>
+    Value getOrLoad(const std::string& key, Load&& load, IsValid&& is_valid)
+    {
+        Shard& shard = shardFor(key);
+        std::promise<Value> promise;
+
+        {
+            std::unique_lock lock(shard.mut);
+            if (auto it = shard.entries.find(key); it != shard.entries.end())
+            {
+                auto future = it->second;
+                bool ready = future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+
+                if (not ready)
+                {
+                    // someone is loading it right now, wait for them without holding the shard.
+                    lock.unlock();
+                    return future.get();
+                }
+
+                // a failed load rethrows here, so it counts as invalid too.
+                bool valid = false;
+                try
+                {
+                    valid = is_valid(future.get());
+                }
+                catch (...)
+                {
+                }
+
+                if (valid)
+                {
+                    return future.get();
+                }
+            }
+
+            shard.entries[key] = promise.get_future().share();
+        }
+
+        try
+        {
+            Value value = load();
+            promise.set_value(value);
+            return value;
+        }
+        catch (...)
+        {
+            // nobody can replace the entry while it is still loading, so it is still ours to drop.
+            {
+                std::lock_guard lock(shard.mut);
+                shard.entries.erase(key);
+            }
+
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    // Peeks at a finished entry without loading anything. Entries still loading count as missing.
+    std::optional<Value> find(const std::string& key)
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard lock(shard.mut);
+
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()
+            or it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return std::nullopt;
+        }
+
+        return it->second.get();
+    }
+
+    // Drops finished entry for key if pred(value) holds. Entries still loading are left alone.
+    template <typename Pred>
+    void eraseIf(const std::string& key, Pred&& pred)
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard lock(shard.mut);
+
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()
+            or it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return;
+        }
+
+        if (pred(it->second.get()))
+        {
+            shard.entries.erase(it);
+        }
+    }
+
+private:
+    struct Shard
+    {
+        std::mutex mut;
+        std::unordered_map<std::string, std::shared_future<Value>> entries;
+    };
+
+    Shard& shardFor(const std::string& key)
+    {
+        return shards[std::hash<std::string>{}(key) % ShardCount];
+    }
+
+    std::array<Shard, ShardCount> shards;
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed size pool of worker threads pulling from one queue. Higher priority tasks go
+// first, tasks of the same priority run in submission order.
+// Tasks should not block on other tasks of the same pool, that can deadlock it.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threadCount = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    // finishes everything already queued before joining.
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mut);
+            stopping = true;
+        }
+
+        cv.notify_all();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    auto submit(F&& func, int priority = 0) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+
+        // packaged_task is move-only and std::function wants copyable, hence the shared_ptr.
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        auto future = task->get_future();
+
+        {
+            std::lock_guard lock(mut);
+            tasks.push({ priority, next_sequence++, [task] { (*task)(); } });
+        }
+
+        cv.notify_one();
+        return future;
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // blocks until the queue is empty and no task is running, tasks submitted meanwhile included.
+    void waitIdle()
+    {
+        std::unique_lock lock(mut);
+        idle_cv.wait(lock, [this] { return tasks.empty() and running == 0; });
+    }
+
+private:
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock lock(mut);
+                cv.wait(lock, [this] { return stopping or not tasks.empty(); });
+
+                if (tasks.empty())
+                {
+                    return; // stopping and drained.
+                }
+
+                // top() is const, but the entry is popped right after, so moving out is fine.
+                task = std::move(const_cast<Task&>(tasks.top()).func);
+                tasks.pop();
+                running++;
+            }
+
+            task();
+
+            {
+                std::lock_guard lock(mut);
+                running--;
+            }
+            idle_cv.notify_all();
+        }
+    }
+
+    struct Task
+    {
+        int priority;
+        uint64_t sequence;
+        std::function<void()> func;
+
+        // max heap on priority, earlier sequence wins ties.
+        bool operator<(const Task& o) const
+        {
+            return priority != o.priority ? priority < o.priority : sequence > o.sequence;
+        }
+    };
+
+    std::mutex mut;
+    std::condition_variable cv;
+    std::condition_variable idle_cv;
+    std::priority_queue<Task> tasks;
+    uint64_t next_sequence{0};
+    std::vector<std::thread> workers;
+    size_t running{0};
+    bool stopping{false};
+};
@@ -1,83 +1,232 @@
 #include "AssetLoader.hpp"
 #include "Vertex.hpp"
+#include "MeshCache.hpp"
+#include "VertexInterleave.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshletBuilder.hpp"
 
 #include <assimp/scene.h>
 #include <assimp/mesh.h>
 #include <assimp/postprocess.h>
 #include <assimp/cimport.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
 #include <future>
+#include <set>
+#include <stdexcept>
 
 namespace render
 {
-uint32_t AssetLoader::loadTexture(
+
+namespace
+{
+constexpr uint32_t IMPORT_FLAGS =
+    aiProcess_CalcTangentSpace |
+    //aiProcess_FlipUVs |
+    aiProcess_GenSmoothNormals |
+    aiProcess_JoinIdenticalVertices |
+    aiProcess_OptimizeMeshes |
+    aiProcess_OptimizeGraph;
+
+// LOD settings change what ends up in the cache, so they are part of the key too.
+uint64_t mixLodSettings(uint64_t hash, const LodSettings& settings)
+{
+    constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    auto mix = [&hash](float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * FNV_PRIME;
+    };
+
+    for(float target : settings.errorTargets)
+    {
+        mix(target);
+    }
+    mix(settings.reduction);
+
+    return hash;
+}
+} // anonymous namespace
+
+std::string AssetLoader::texturePath(
     const struct aiMaterial* material,
-    enum aiTextureType type,
+    std::initializer_list<enum aiTextureType> types,
     const std::string& path_root)
 {
-    struct aiString str;
-    aiGetMaterialTexture(material, type, 0, &str, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr); // nice call bro
+    for(auto type : types)
+    {
+        struct aiString str;
+        if(aiGetMaterialTexture(material, type, 0, &str, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr) == aiReturn_SUCCESS) // nice call bro
+        {
+            return path_root + str.data;
+        }
+    }
 
-    return tex_mgr->loadTexture(path_root + str.data);
+    return {};
 }
 
-Mesh AssetLoader::processMesh(
+MeshMaterialPaths AssetLoader::importMaterial(
+    const struct aiMaterial* material,
+    const std::string& path_root)
+{
+    MeshMaterialPaths paths;
+    paths.diffuse = texturePath(material, { aiTextureType_DIFFUSE }, path_root);
+    paths.normal = texturePath(material, { aiTextureType_HEIGHT }, path_root);
+
+    // exporters disagree a lot on where AO and roughness go, so try the usual suspects.
+    paths.channels = {
+        texturePath(material, { aiTextureType_AMBIENT_OCCLUSION, aiTextureType_LIGHTMAP, aiTextureType_AMBIENT }, path_root),
+        texturePath(material, { aiTextureType_SPECULAR, aiTextureType_DIFFUSE_ROUGHNESS }, path_root),
+        texturePath(material, { aiTextureType_METALNESS }, path_root),
+        texturePath(material, { aiTextureType_DISPLACEMENT }, path_root),
+    };
+
+    return paths;
+}
+
+std::vector<std::string> AssetLoader::collectTexturePaths(const std::vector<MeshView>& meshes)
+{
+    // single channel maps get packed together by loadPackedMaterial instead.
+    std::set<std::string> paths;
+    for(const auto& mesh : meshes)
+    {
+        for(const auto* path : { &mesh.material.diffuse, &mesh.material.normal })
+        {
+            if(not path->empty())
+            {
+                paths.insert(*path);
+            }
+        }
+    }
+
+    return { paths.begin(), paths.end() };
+}
+
+MeshImportData AssetLoader::processMesh(
         const struct aiMesh* mesh,
         const struct aiScene* scene,
-        const std::string& dir_root)
+        const std::string& dir_root,
+        MeshOptimizeStats& stats)
 {
     assert(mesh->mNumVertices);
 
-    std::vector<Vertex> vertices;
-    vertices.reserve(mesh->mNumVertices);
+    MeshImportData data;
 
-    std::vector<uint32_t> indices;
-    indices.reserve(mesh->mNumFaces * 3);
-
-    for(size_t i = 0; i < mesh->mNumVertices; ++i)
+    // aiVector3D is three tightly packed floats, so the streams can go in as they are.
+    static_assert(sizeof(aiVector3D) == 3 * sizeof(float));
+    const VertexStreams streams =
     {
-        Vertex v{};
-        v.pos[0] = mesh->mVertices[i].x;
-        v.pos[1] = mesh->mVertices[i].y;
-        v.pos[2] = mesh->mVertices[i].z;
-
-        v.surf_normals[0] = mesh->mNormals[i].x;
-        v.surf_normals[1] = mesh->mNormals[i].y;
-        v.surf_normals[2] = mesh->mNormals[i].z;
+        .positions = reinterpret_cast<const float*>(mesh->mVertices),
+        .normals = reinterpret_cast<const float*>(mesh->mNormals),
+        .tangents = reinterpret_cast<const float*>(mesh->mTangents),
+        .texCoords = reinterpret_cast<const float*>(mesh->mTextureCoords[0]),
+    };
 
-        v.tangents[0] = mesh->mTangents[i].x;
-        v.tangents[1] = mesh->mTangents[i].y;
-        v.tangents[2] = mesh->mTangents[i].z;
+    data.vertices.resize(mesh->mNumVertices);
+    interleaveVertices(streams, mesh->mNumVertices, data.vertices.data());
 
-        if(mesh->mTextureCoords[0])
+    // No aiProcess_Triangulate, so skip points and lines instead of reading past them.
+    data.indices.resize(size_t(mesh->mNumFaces) * 3);
+    uint32_t* out = data.indices.data();
+    for(size_t i = 0; i < mesh->mNumFaces; ++i)
+    {
+        const auto& face = mesh->mFaces[i];
+        if(face.mNumIndices == 3)
         {
-            v.tex_coords[0] = mesh->mTextureCoords[0][i].x;
-            v.tex_coords[1] = mesh->mTextureCoords[0][i].y;
+            std::memcpy(out, face.mIndices, 3 * sizeof(uint32_t));
+            out += 3;
         }
+    }
+    data.indices.resize(out - data.indices.data());
+
+    // also drops vertices no triangle uses, so bounds come after.
+    stats = optimizeMesh(data.vertices, data.indices);
 
-        vertices.emplace_back(std::move(v));
+    if(not data.vertices.empty())
+    {
+        data.bounds.min = data.vertices[0].pos;
+        data.bounds.max = data.vertices[0].pos;
+    }
+    for(const auto& v : data.vertices)
+    {
+        data.bounds.min = glm::min(data.bounds.min, v.pos);
+        data.bounds.max = glm::max(data.bounds.max, v.pos);
     }
 
-    for(size_t i = 0; i < mesh->mNumFaces; ++i)
+    data.bounds.center = (data.bounds.min + data.bounds.max) * 0.5f;
+    for(const auto& v : data.vertices)
     {
-        for(size_t j = 0; j < 3; ++j)
-        {
-            indices.emplace_back(mesh->mFaces[i].mIndices[j]);
-        }
+        data.bounds.radius = std::max(data.bounds.radius, glm::length(v.pos - data.bounds.center));
     }
 
-    MeshPushConstantData meshPushData{};
-    if(mesh->mMaterialIndex >= 0)
+    buildLodChain(data, lod_settings);
+    buildMeshlets(data);
+
+    if(mesh->mMaterialIndex < scene->mNumMaterials)
     {
-        struct aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        auto diffuseIdx = std::async(std::launch::async, &AssetLoader::loadTexture, this, material, aiTextureType_DIFFUSE, dir_root);
-        auto normalIdx = std::async(std::launch::async, &AssetLoader::loadTexture, this, material, aiTextureType_HEIGHT, dir_root);
-        auto specularIdx = std::async(std::launch::async, &AssetLoader::loadTexture, this, material, aiTextureType_SPECULAR, dir_root);
-        meshPushData.diffuse_texid = diffuseIdx.get();
-        meshPushData.normal_texid = normalIdx.get();
-        meshPushData.specular_texid = specularIdx.get();
+        data.material = importMaterial(scene->mMaterials[mesh->mMaterialIndex], dir_root);
     }
 
-    return Mesh{device, vertices, indices, meshPushData};
+    return data;
+}
+
+MeshSource AssetLoader::createMeshSource(const MeshView& mesh, bool allow_compact)
+{
+    auto load = [this](const std::string& path)
+    {
+        return path.empty() ? memory::TextureHandle{} : tex_mgr->loadTexture(path);
+    };
+
+    auto diffuseTex = std::async(std::launch::async, load, mesh.material.diffuse);
+    auto normalTex = std::async(std::launch::async, load, mesh.material.normal);
+    auto materialTex = std::async(std::launch::async,
+        [this, &mesh]() { return tex_mgr->loadPackedMaterial(mesh.material.channels); });
+
+    MeshSource source;
+    source.textures = { diffuseTex.get(), normalTex.get(), materialTex.get() };
+    source.node = mesh.node;
+    source.indices = mesh.indices;
+    source.indexCount = mesh.indexCount;
+    source.lods = mesh.lods;
+    source.meshlets = { mesh.meshlets, mesh.meshlets + mesh.meshletCount };
+    source.bounds = mesh.bounds;
+
+    auto& data = source.data;
+    data.diffuse_texid = source.textures[0].index();
+    data.normal_texid = source.textures[1].index();
+    data.material_texid = source.textures[2].index();
+
+    // Anisotropy only pays off on color. Data textures are fine with plain trilinear.
+    data.diffuse_samplerid = tex_mgr->getSamplerIndex(
+        memory::samplerPresets::linear(VK_SAMPLER_ADDRESS_MODE_REPEAT, 16.0f));
+    data.data_samplerid = tex_mgr->getSamplerIndex(
+        memory::samplerPresets::linear(VK_SAMPLER_ADDRESS_MODE_REPEAT));
+
+    if(allow_compact)
+    {
+        const auto quantization = VertexQuantization::forBounds(mesh.bounds.min, mesh.bounds.max);
+        if(quantizeVertices(mesh.vertices, mesh.vertexCount, quantization, quantization_bounds, source.compactVertices))
+        {
+            for(int c = 0; c < 3; ++c)
+            {
+                data.pos_scale[c] = quantization.scale[c];
+                data.pos_bias[c] = quantization.bias[c];
+            }
+
+            return source;
+        }
+
+        source.compactVertices.clear();
+    }
+
+    data.pos_scale[0] = data.pos_scale[1] = data.pos_scale[2] = 1.0f;
+    source.vertices = mesh.vertices;
+    source.vertexCount = mesh.vertexCount;
+    return source;
 }
 
 AssetLoader::AssetLoader(std::shared_ptr<VulkanDevice> dev_ptr, std::shared_ptr<memory::TextureManager> tex_ptr)
@@ -87,40 +236,52 @@ AssetLoader::AssetLoader(std::shared_ptr<VulkanDevice> dev_ptr, std::shared_ptr<
 }
 
 void AssetLoader::processNodes(
-        std::vector<Mesh>& meshes,
-        const struct aiNode* node,
-        const struct aiScene* scene,
-        const std::string& dir_root)
+        std::vector<MeshRef>& meshes,
+        SceneHierarchy& hierarchy,
+        const struct aiNode* root,
+        const struct aiScene* scene)
 {
-    for(size_t i = 0; i < node->mNumMeshes; ++i)
-    {
-        struct aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.emplace_back(processMesh(mesh, scene, dir_root));
-    }
+    // explicit stack instead of recursion, exporters can produce some really deep trees.
+    // A node is only pushed after its parent got an index, so parents always come first.
+    std::vector<std::pair<const struct aiNode*, int32_t>> pending = { { root, SceneHierarchy::NO_PARENT } };
 
-    // do the same processing for every child node there is.
-    for(size_t i = 0; i < node->mNumChildren; ++i)
+    while(not pending.empty())
     {
-        processNodes(meshes, node, scene, dir_root);
-    }
+        const auto [node, parent] = pending.back();
+        pending.pop_back();
+
+        // shear, if any, does not survive this. Nobody exports that on purpose anyway.
+        aiVector3D scaling, position;
+        aiQuaternion rotation;
+        node->mTransformation.Decompose(scaling, rotation, position);
+
+        const uint32_t idx = hierarchy.addNode(parent,
+            glm::vec3(position.x, position.y, position.z),
+            glm::quat(rotation.w, rotation.x, rotation.y, rotation.z),
+            glm::vec3(scaling.x, scaling.y, scaling.z));
 
-    // at this point we have a full vector of meshes for the scene. Return.
+        for(size_t i = 0; i < node->mNumMeshes; ++i)
+        {
+            meshes.push_back({ scene->mMeshes[node->mMeshes[i]], idx });
+        }
+
+        // reversed, so children get popped in their original order.
+        for(size_t i = node->mNumChildren; i-- > 0;)
+        {
+            pending.emplace_back(node->mChildren[i], static_cast<int32_t>(idx));
+        }
+    }
 }
 
-std::shared_ptr<Renderable> AssetLoader::loadObject(const std::string& path, std::shared_ptr<Pipeline> pipeline)
+std::optional<ModelImportData> AssetLoader::importWithAssimp(const std::string& path)
 {
-    const struct aiScene* scene = aiImportFile(path.c_str(),
-        aiProcess_CalcTangentSpace |
-        //aiProcess_FlipUVs |
-        aiProcess_GenSmoothNormals |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_OptimizeMeshes |
-        aiProcess_OptimizeGraph);
+    const struct aiScene* scene = aiImportFile(path.c_str(), IMPORT_FLAGS);
 
     if(not scene or scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE or not scene->mRootNode)
     {
         dbgE << "Failed to load model: " << path << NEWL;
-        return nullptr;
+        aiReleaseImport(scene);
+        return std::nullopt;
     }
 
     // ugh
@@ -129,10 +290,363 @@ std::shared_ptr<Renderable> AssetLoader::loadObject(const std::string& path, std
     std::string object_folder{&path[0], size};
     object_folder += '/';
 
-    std::vector<Mesh> meshes;
-    processNodes(meshes, scene->mRootNode, scene, object_folder);
+    // Walk is cheap and keeps mesh order deterministic, conversion is what gets spread over the pool.
+    ModelImportData model;
+    std::vector<MeshRef> ai_meshes;
+    processNodes(ai_meshes, model.hierarchy, scene->mRootNode, scene);
+    model.hierarchy.updateWorldTransforms();
+
+    // every job writes its own stats slot, reported afterwards so the log is in mesh order.
+    std::vector<MeshOptimizeStats> stats(ai_meshes.size());
+    std::vector<std::future<MeshImportData>> jobs;
+    jobs.reserve(ai_meshes.size());
+    for(size_t i = 0; i < ai_meshes.size(); ++i)
+    {
+        jobs.push_back(workers.submit([this, ref = ai_meshes[i], scene, &object_folder, &stats = stats[i]]() {
+            auto data = processMesh(ref.mesh, scene, object_folder, stats);
+            data.node = ref.node;
+            return data;
+        }));
+    }
+
+    model.meshes.reserve(jobs.size());
+    for(size_t i = 0; i < jobs.size(); ++i)
+    {
+        auto data = jobs[i].get();
+
+        // points and lines only, nothing the pipeline could draw.
+        if(data.indices.empty())
+        {
+            continue;
+        }
+
+        dbgI << "Mesh " << ai_meshes[i].mesh->mName.C_Str() << ": ACMR " << stats[i].before.acmr << " -> " << stats[i].after.acmr
+             << ", ATVR " << stats[i].before.atvr << " -> " << stats[i].after.atvr << NEWL;
+        model.meshes.push_back(std::move(data));
+    }
+
+    aiReleaseImport(scene);
+    return model;
+}
+
+std::optional<AssetLoader::LoadedGeometry> AssetLoader::loadGeometry(const std::string& path)
+{
+    const std::string cache_path = path + ".meshcache";
+    const uint64_t file_hash = MeshCache::hashFile(path);
+    const uint64_t source_hash = file_hash != 0 ? mixLodSettings(file_hash, lod_settings) : 0;
+
+    LoadedGeometry geometry;
+    geometry.cache = MeshCache::open(cache_path, source_hash, IMPORT_FLAGS);
+
+    if(geometry.cache)
+    {
+        dbgI << "Mesh cache hit for " << path << ", skipping import." << NEWL;
+        for(size_t i = 0; i < geometry.cache->meshCount(); ++i)
+        {
+            geometry.views.push_back(geometry.cache->mesh(i));
+        }
+        geometry.hierarchy = geometry.cache->hierarchy();
+        return geometry;
+    }
+
+    geometry.imported = importWithAssimp(path);
+    if(not geometry.imported)
+    {
+        return std::nullopt;
+    }
+
+    if(source_hash != 0)
+    {
+        MeshCache::write(cache_path, source_hash, IMPORT_FLAGS, *geometry.imported);
+    }
+
+    for(const auto& mesh : geometry.imported->meshes)
+    {
+        geometry.views.push_back(MeshView::of(mesh));
+    }
+    geometry.hierarchy = geometry.imported->hierarchy;
+
+    return geometry;
+}
+
+std::shared_ptr<const ModelData> AssetLoader::createModelData(
+        const std::string& path,
+        LoadedGeometry& geometry,
+        bool allow_compact)
+{
+    const auto& views = geometry.views;
+
+    // Packing needs to see all textures of the model at once, so they get loaded up front.
+    // Meshes then just hit the texture cache. Handles only need to live until meshes hold theirs.
+    std::vector<memory::TextureHandle> packed_textures;
+    if(pack_small_textures)
+    {
+        packed_textures = tex_mgr->loadTexturesPacked(collectTexturePaths(views));
+    }
+
+    std::vector<MeshSource> sources;
+    sources.reserve(views.size());
+    for(const auto& view : views)
+    {
+        sources.push_back(createMeshSource(view, allow_compact));
+    }
+
+    const auto compact_count = std::count_if(sources.begin(), sources.end(), [](const MeshSource& m) { return m.isCompact(); });
+    dbgI << path << ": " << compact_count << " of " << sources.size() << " meshes use compact vertices." << NEWL;
+
+    return std::make_shared<ModelData>(device, std::move(sources), std::move(geometry.hierarchy));
+}
+
+std::shared_ptr<Renderable> AssetLoader::createBoundsProxy(
+        const LoadedGeometry& geometry,
+        std::shared_ptr<Pipeline> pipeline)
+{
+    if(geometry.views.empty())
+    {
+        return nullptr;
+    }
+
+    // model space box around every mesh, as placed by its node.
+    auto hierarchy = geometry.hierarchy;
+    hierarchy.updateWorldTransforms();
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for(const auto& view : geometry.views)
+    {
+        const auto& world = hierarchy.world(view.node);
+        for(int corner = 0; corner < 8; ++corner)
+        {
+            const glm::vec3 local(corner & 1 ? view.bounds.max.x : view.bounds.min.x,
+                                  corner & 2 ? view.bounds.max.y : view.bounds.min.y,
+                                  corner & 4 ? view.bounds.max.z : view.bounds.min.z);
+            const glm::vec3 p = glm::vec3(world * glm::vec4(local, 1.0f));
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+    }
+
+    std::vector<Vertex> vertices(8);
+    for(int corner = 0; corner < 8; ++corner)
+    {
+        vertices[corner].pos = glm::vec3(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+    }
+
+    // both windings, so it shows up no matter which way the cull mode thinks is front.
+    const std::vector<uint32_t> faces = {
+        0, 1, 3, 0, 3, 2,   4, 6, 7, 4, 7, 5,
+        0, 4, 5, 0, 5, 1,   2, 3, 7, 2, 7, 6,
+        0, 2, 6, 0, 6, 4,   1, 5, 7, 1, 7, 3,
+    };
+    std::vector<uint32_t> indices = faces;
+    for(size_t i = 0; i < faces.size(); i += 3)
+    {
+        indices.insert(indices.end(), { faces[i], faces[i + 2], faces[i + 1] });
+    }
 
-    return std::make_shared<Renderable>(device, pipeline, meshes);
+    // empty handles all point at the placeholder texture.
+    MeshSource box;
+    box.vertices = vertices.data();
+    box.vertexCount = vertices.size();
+    box.indices = indices.data();
+    box.indexCount = indices.size();
+    box.data.diffuse_texid = box.data.normal_texid = box.data.material_texid = memory::TextureHandle{}.index();
+    box.data.pos_scale[0] = box.data.pos_scale[1] = box.data.pos_scale[2] = 1.0f;
+    box.bounds = { min, max, (min + max) * 0.5f, glm::length(max - min) * 0.5f };
+
+    SceneHierarchy root;
+    root.addNode(SceneHierarchy::NO_PARENT, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+
+    std::vector<MeshSource> sources;
+    sources.push_back(std::move(box));
+    auto model = std::make_shared<ModelData>(device, std::move(sources), std::move(root));
+    return std::make_shared<Renderable>(device, std::move(pipeline), std::move(model));
+}
+
+std::string AssetLoader::modelKey(const std::string& path, bool allow_compact) const
+{
+    // a file changed on disk is a different asset, old instances keep the old one.
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    const auto written = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+
+    return path + '|' + std::to_string(size) + '|' + std::to_string(written)
+        + '|' + std::to_string(mixLodSettings(0, lod_settings)) + '|' + (allow_compact ? "compact" : "full");
+}
+
+std::shared_ptr<const ModelData> AssetLoader::loadModel(
+        const std::string& path,
+        bool allow_compact,
+        const std::function<bool(const LoadedGeometry&)>& on_geometry)
+{
+    const auto key = modelKey(path, allow_compact);
+
+    // Same dance as with textures: cache holds weak references, a waiter can find the model
+    // already gone (or never made, if the load failed or got cancelled). Then go again.
+    while(true)
+    {
+        bool loaded_here = false;
+        std::shared_ptr<const ModelData> loaded;
+
+        auto cached = model_cache.getOrLoad(key,
+            [&]()
+            {
+                loaded_here = true;
+
+                // Either cache or imported data in there keeps the memory behind views alive until meshes are uploaded.
+                auto geometry = loadGeometry(path);
+                if(geometry and (not on_geometry or on_geometry(*geometry)))
+                {
+                    loaded = createModelData(path, *geometry, allow_compact);
+                }
+
+                return std::weak_ptr<const ModelData>(loaded);
+            },
+            [](const std::weak_ptr<const ModelData>& model) { return not model.expired(); });
+
+        if(loaded_here)
+        {
+            return loaded;
+        }
+
+        if(auto model = cached.lock())
+        {
+            dbgI << "Model " << path << " already loaded, sharing its buffers." << NEWL;
+            return model;
+        }
+    }
+}
+
+std::shared_ptr<Renderable> AssetLoader::loadObject(const std::string& path, std::shared_ptr<Pipeline> pipeline,
+                                                    std::shared_ptr<Pipeline> compactPipeline)
+{
+    auto model = loadModel(path, compactPipeline != nullptr, nullptr);
+    if(not model)
+    {
+        return nullptr;
+    }
+
+    return std::make_shared<Renderable>(device, std::move(pipeline), std::move(model), std::move(compactPipeline));
+}
+
+std::shared_ptr<InstancedRenderable> AssetLoader::loadInstanced(const std::string& path,
+                                                                std::shared_ptr<Pipeline> instancedPipeline)
+{
+    auto model = loadModel(path, false, nullptr);
+    if(not model)
+    {
+        return nullptr;
+    }
+
+    return std::make_shared<InstancedRenderable>(device, std::move(instancedPipeline), std::move(model));
+}
+
+std::shared_ptr<LoadHandle> AssetLoader::loadObjectAsync(const std::string& path, std::shared_ptr<Pipeline> pipeline,
+                                                         int priority, std::shared_ptr<Pipeline> compactPipeline)
+{
+    auto handle = std::make_shared<LoadHandle>();
+
+    // checked between stages, there is no point in interrupting an import or an upload halfway.
+    load_queue.submit([this, handle, path, pipeline, compactPipeline]() mutable {
+        // the pool drops the task's future, anything thrown would leave the handle pending forever.
+        try
+        {
+            if(handle->isCancelled())
+            {
+                handle->finish(LoadHandle::State::Cancelled, nullptr);
+                return;
+            }
+
+            // only runs on a model cache miss, a hit is ready right away and needs no proxy.
+            auto model = loadModel(path, compactPipeline != nullptr, [&](const LoadedGeometry& geometry) {
+                if(handle->isCancelled())
+                    return false;
+
+                handle->setProxy(createBoundsProxy(geometry, pipeline));
+                return not handle->isCancelled();
+            });
+
+            if(not model)
+            {
+                handle->finish(handle->isCancelled() ? LoadHandle::State::Cancelled : LoadHandle::State::Failed, nullptr);
+                return;
+            }
+
+            auto renderable = std::make_shared<Renderable>(device, std::move(pipeline), std::move(model), std::move(compactPipeline));
+            handle->finish(LoadHandle::State::Ready, std::move(renderable));
+        }
+        catch(const std::exception& e)
+        {
+            dbgE << "Loading " << path << " failed: " << e.what() << NEWL;
+            handle->finish(LoadHandle::State::Failed, nullptr);
+        }
+    }, priority);
+
+    return handle;
+}
+
+void AssetLoader::reloadTextureAsync(const std::string& path, int priority)
+{
+    load_queue.submit([this, path]() {
+        try
+        {
+            if(tex_mgr->reloadTexture(path))
+            {
+                dbgI << "Texture " << path << " reloaded, swapping at next frame." << NEWL;
+            }
+        }
+        catch(const std::exception& e)
+        {
+            dbgE << "Reloading texture " << path << " failed: " << e.what() << NEWL;
+        }
+    }, priority);
+}
+
+void AssetLoader::waitIdle()
+{
+    // loads wait on workers, so the load queue has to be done first.
+    load_queue.waitIdle();
+    workers.waitIdle();
+}
+
+LoadHandle::State LoadHandle::state() const
+{
+    std::lock_guard lock(mut);
+    return current;
+}
+
+std::shared_ptr<Renderable> LoadHandle::get() const
+{
+    std::lock_guard lock(mut);
+    return renderable;
+}
+
+std::shared_ptr<Renderable> LoadHandle::proxy() const
+{
+    std::lock_guard lock(mut);
+    return proxy_renderable;
+}
+
+void LoadHandle::wait() const
+{
+    std::unique_lock lock(mut);
+    cv.wait(lock, [this] { return current != State::Pending; });
+}
+
+void LoadHandle::setProxy(std::shared_ptr<Renderable> proxy)
+{
+    std::lock_guard lock(mut);
+    proxy_renderable = std::move(proxy);
+}
+
+void LoadHandle::finish(State state, std::shared_ptr<Renderable> result)
+{
+    {
+        std::lock_guard lock(mut);
+        current = state;
+        renderable = std::move(result);
+    }
+    cv.notify_all();
 }
 
 } // namespace render
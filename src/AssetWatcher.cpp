@@ -0,0 +1,183 @@
+#include "AssetWatcher.hpp"
+#include "Logger.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace render {
+
+namespace {
+
+// close-write catches in place saves, moved-to catches save-to-temp-then-rename.
+constexpr uint32_t FILE_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO;
+constexpr uint32_t DIR_EVENTS = IN_CREATE | IN_MOVED_TO;
+
+} // anonymous namespace
+
+AssetWatcher::AssetWatcher(const std::vector<std::string>& roots, std::chrono::milliseconds settleTime)
+    : settle_time(settleTime)
+{
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(inotify_fd < 0 or wake_fd < 0)
+    {
+        dbgE << "Could not set up asset watching: " << std::strerror(errno) << ". Hot reload is off." << NEWL;
+        return;
+    }
+
+    for(const auto& root : roots)
+    {
+        addWatchRecursive(std::filesystem::path(root).lexically_normal());
+    }
+
+    thread = std::thread([this] { run(); });
+}
+
+AssetWatcher::~AssetWatcher()
+{
+    if(thread.joinable())
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] auto written = write(wake_fd, &one, sizeof(one));
+        thread.join();
+    }
+
+    if(inotify_fd >= 0)
+        close(inotify_fd);
+    if(wake_fd >= 0)
+        close(wake_fd);
+}
+
+std::vector<std::string> AssetWatcher::takeChanged()
+{
+    std::set<std::string> taken;
+    {
+        std::lock_guard lock(mut);
+        taken.swap(changed);
+    }
+
+    return { taken.begin(), taken.end() };
+}
+
+void AssetWatcher::addWatchRecursive(const std::filesystem::path& dir)
+{
+    std::error_code ec;
+    if(not std::filesystem::is_directory(dir, ec))
+    {
+        dbgE << "Not watching " << dir.string() << ", it is not a directory." << NEWL;
+        return;
+    }
+
+    const int wd = inotify_add_watch(inotify_fd, dir.c_str(), FILE_EVENTS | DIR_EVENTS | IN_ONLYDIR);
+    if(wd < 0)
+    {
+        dbgE << "Could not watch " << dir.string() << ": " << std::strerror(errno) << NEWL;
+        return;
+    }
+    watched[wd] = dir;
+
+    for(const auto& entry : std::filesystem::directory_iterator(dir, ec))
+    {
+        if(entry.is_directory(ec))
+        {
+            addWatchRecursive(entry.path());
+        }
+    }
+}
+
+void AssetWatcher::readEvents(std::set<std::string>& batch)
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while(true)
+    {
+        const ssize_t len = read(inotify_fd, buffer, sizeof(buffer));
+        if(len <= 0)
+        {
+            return; // EAGAIN, drained.
+        }
+
+        for(ssize_t at = 0; at < len;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + at);
+            at += sizeof(inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW)
+            {
+                dbgE << "Asset watcher queue overflowed, some changes were missed." << NEWL;
+                continue;
+            }
+
+            if(event->mask & IN_IGNORED)
+            {
+                watched.erase(event->wd);
+                continue;
+            }
+
+            auto dir = watched.find(event->wd);
+            if(dir == watched.end() or event->len == 0)
+            {
+                continue;
+            }
+
+            const auto path = dir->second / event->name;
+            if(event->mask & IN_ISDIR)
+            {
+                addWatchRecursive(path);
+            }
+            else if(event->mask & FILE_EVENTS)
+            {
+                batch.insert(path.lexically_normal().string());
+            }
+        }
+    }
+}
+
+void AssetWatcher::run()
+{
+    pollfd fds[2] = {
+        { .fd = inotify_fd, .events = POLLIN, .revents = 0 },
+        { .fd = wake_fd, .events = POLLIN, .revents = 0 },
+    };
+
+    std::set<std::string> batch;
+    while(true)
+    {
+        // block until something happens, then keep gathering until it has been quiet for a bit.
+        const int timeout = batch.empty() ? -1 : static_cast<int>(settle_time.count());
+        const int ready = poll(fds, 2, timeout);
+
+        if(ready < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            dbgE << "Asset watcher stopped: " << std::strerror(errno) << NEWL;
+            return;
+        }
+
+        if(fds[1].revents & POLLIN)
+        {
+            return;
+        }
+
+        if(ready == 0)
+        {
+            std::lock_guard lock(mut);
+            changed.merge(batch);
+            batch.clear();
+            continue;
+        }
+
+        if(fds[0].revents & POLLIN)
+        {
+            readEvents(batch);
+        }
+    }
+}
+
+} // namespace render
@@ -0,0 +1,459 @@
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+
+namespace render {
+
+namespace {
+
+constexpr uint32_t SAH_BINS = 12;
+// cost of visiting a node relative to testing one item.
+constexpr float TRAVERSAL_COST = 1.0f;
+
+// where a box is relative to the frustum.
+enum class Overlap { OUTSIDE, CROSSING, INSIDE };
+
+Overlap classify(const Frustum& frustum, const Aabb& box)
+{
+    Overlap result = Overlap::INSIDE;
+    for(const auto& plane : frustum.planes)
+    {
+        const glm::vec3 n(plane);
+        // corners farthest along and against the normal.
+        const glm::vec3 outer(n.x >= 0.0f ? box.max.x : box.min.x, n.y >= 0.0f ? box.max.y : box.min.y, n.z >= 0.0f ? box.max.z : box.min.z);
+        const glm::vec3 inner(n.x >= 0.0f ? box.min.x : box.max.x, n.y >= 0.0f ? box.min.y : box.max.y, n.z >= 0.0f ? box.min.z : box.max.z);
+        if(glm::dot(n, outer) + plane.w < 0.0f)
+            return Overlap::OUTSIDE;
+        if(glm::dot(n, inner) + plane.w < 0.0f)
+            result = Overlap::CROSSING;
+    }
+    return result;
+}
+
+bool sphereTouches(const Aabb& box, glm::vec3 center, float radius)
+{
+    const glm::vec3 nearest = glm::max(box.min, glm::min(center, box.max));
+    const glm::vec3 d = center - nearest;
+    return glm::dot(d, d) <= radius * radius;
+}
+
+// entry distance of the ray into the box, if it gets there before maxT.
+bool rayEntry(const Aabb& box, const Ray& ray, glm::vec3 invDir, float maxT, float& entry)
+{
+    float t0 = 0.0f, t1 = maxT;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        float tNear = (box.min[axis] - ray.origin[axis]) * invDir[axis];
+        float tFar = (box.max[axis] - ray.origin[axis]) * invDir[axis];
+        if(tNear > tFar)
+            std::swap(tNear, tFar);
+        // NaN from a zero direction on a slab plane compares false and leaves the range alone.
+        t0 = tNear > t0 ? tNear : t0;
+        t1 = tFar < t1 ? tFar : t1;
+        if(t0 > t1)
+            return false;
+    }
+    entry = t0;
+    return true;
+}
+
+// items of the subtree under node are contiguous, from its leftmost leaf to its rightmost.
+void subtreeItems(const std::vector<BvhNode>& nodes, uint32_t node, uint32_t& begin, uint32_t& end)
+{
+    uint32_t left = node;
+    while(not nodes[left].isLeaf())
+        left = left + 1;
+    uint32_t right = node;
+    while(not nodes[right].isLeaf())
+        right = nodes[right].offset;
+
+    begin = nodes[left].offset;
+    end = nodes[right].offset + nodes[right].count;
+}
+
+class Builder
+{
+public:
+    Builder(const std::vector<Aabb>& boxes, std::vector<BvhNode>& nodes, std::vector<uint32_t>& items)
+        : boxes(boxes), nodes(nodes), items(items)
+    {
+        centers.reserve(boxes.size());
+        for(const auto& box : boxes)
+            centers.push_back(box.center());
+    }
+
+    // depth first, returns the index of the node made for items [begin, end).
+    uint32_t build(uint32_t begin, uint32_t end)
+    {
+        const auto index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({});
+
+        Aabb bounds, centerBounds;
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            bounds.grow(boxes[items[i]]);
+            centerBounds.grow(centers[items[i]]);
+        }
+        nodes[index].bounds = bounds;
+
+        const uint32_t count = end - begin;
+        int bestAxis = -1;
+        uint32_t bestBin = 0;
+        float bestCost = std::numeric_limits<float>::max();
+        if(count > 1)
+            findSplit(begin, end, bounds, centerBounds, bestAxis, bestBin, bestCost);
+
+        // small enough and splitting does not pay for the extra node.
+        if(count == 1 or (count <= Bvh::MAX_LEAF_ITEMS and bestCost >= float(count)))
+        {
+            nodes[index].offset = begin;
+            nodes[index].count = count;
+            return index;
+        }
+
+        uint32_t mid = begin;
+        if(bestAxis >= 0)
+        {
+            const float lo = centerBounds.min[bestAxis];
+            const float scale = SAH_BINS / (centerBounds.max[bestAxis] - lo);
+            mid = static_cast<uint32_t>(std::partition(items.begin() + begin, items.begin() + end, [&](uint32_t item) {
+                return binOf(centers[item][bestAxis], lo, scale) < bestBin;
+            }) - items.begin());
+        }
+
+        // all centers in one spot, halves by position in the list are as good as anything.
+        if(mid == begin or mid == end)
+            mid = begin + count / 2;
+
+        nodes[index].count = 0;
+        build(begin, mid);
+        const uint32_t right = build(mid, end);
+        nodes[index].offset = right;
+        return index;
+    }
+
+private:
+    static uint32_t binOf(float center, float lo, float scale)
+    {
+        return std::min(SAH_BINS - 1, static_cast<uint32_t>((center - lo) * scale));
+    }
+
+    void findSplit(uint32_t begin, uint32_t end, const Aabb& bounds, const Aabb& centerBounds,
+                   int& bestAxis, uint32_t& bestBin, float& bestCost) const
+    {
+        const float parentArea = bounds.surfaceArea();
+        if(not (parentArea > 0.0f))
+            return;
+
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            const float lo = centerBounds.min[axis];
+            const float extent = centerBounds.max[axis] - lo;
+            if(not (extent > 0.0f))
+                continue;
+
+            std::array<Aabb, SAH_BINS> binBounds;
+            std::array<uint32_t, SAH_BINS> binCounts {};
+            const float scale = SAH_BINS / extent;
+            for(uint32_t i = begin; i < end; ++i)
+            {
+                const uint32_t bin = binOf(centers[items[i]][axis], lo, scale);
+                binBounds[bin].grow(boxes[items[i]]);
+                binCounts[bin]++;
+            }
+
+            // right side areas and counts swept from the end, left side on the way up.
+            std::array<float, SAH_BINS> rightCost {};
+            Aabb right;
+            uint32_t rightCount = 0;
+            for(uint32_t bin = SAH_BINS - 1; bin > 0; --bin)
+            {
+                right.grow(binBounds[bin]);
+                rightCount += binCounts[bin];
+                rightCost[bin] = right.surfaceArea() * float(rightCount);
+            }
+
+            Aabb left;
+            uint32_t leftCount = 0;
+            for(uint32_t bin = 1; bin < SAH_BINS; ++bin)
+            {
+                left.grow(binBounds[bin - 1]);
+                leftCount += binCounts[bin - 1];
+                if(leftCount == 0 or leftCount == end - begin)
+                    continue;
+
+                const float cost = TRAVERSAL_COST + (left.surfaceArea() * float(leftCount) + rightCost[bin]) / parentArea;
+                if(cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = bin;
+                }
+            }
+        }
+    }
+
+    const std::vector<Aabb>& boxes;
+    std::vector<BvhNode>& nodes;
+    std::vector<uint32_t>& items;
+    std::vector<glm::vec3> centers;
+};
+
+} // anonymous namespace
+
+float Aabb::surfaceArea() const
+{
+    if(empty())
+        return 0.0f;
+    const glm::vec3 d = max - min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+Aabb Aabb::transformed(const glm::mat4& m) const
+{
+    if(empty())
+        return *this;
+
+    // Arvo: every output axis takes the smaller and the larger of each input axis's contribution.
+    Aabb result;
+    result.min = result.max = glm::vec3(m[3]);
+    for(int col = 0; col < 3; ++col)
+    {
+        const glm::vec3 a = glm::vec3(m[col]) * min[col];
+        const glm::vec3 b = glm::vec3(m[col]) * max[col];
+        result.min += glm::min(a, b);
+        result.max += glm::max(a, b);
+    }
+    return result;
+}
+
+Bvh::Tree Bvh::buildTree(const std::vector<Aabb>& boxes)
+{
+    Tree tree;
+    if(boxes.empty())
+        return tree;
+
+    tree.items.resize(boxes.size());
+    for(uint32_t i = 0; i < tree.items.size(); ++i)
+        tree.items[i] = i;
+    // a binary tree with at least one item per leaf never has more.
+    tree.nodes.reserve(2 * boxes.size() - 1);
+
+    Builder(boxes, tree.nodes, tree.items).build(0, static_cast<uint32_t>(boxes.size()));
+    return tree;
+}
+
+float Bvh::sahCost(const std::vector<BvhNode>& nodes)
+{
+    if(nodes.empty() or not (nodes[0].bounds.surfaceArea() > 0.0f))
+        return 0.0f;
+
+    float cost = 0.0f;
+    for(const auto& node : nodes)
+        cost += node.bounds.surfaceArea() * (node.isLeaf() ? float(node.count) : TRAVERSAL_COST);
+    return cost / nodes[0].bounds.surfaceArea();
+}
+
+void Bvh::build(std::vector<Aabb> boxes)
+{
+    // whatever it builds is for the old items.
+    pending = {};
+
+    itemBounds = std::move(boxes);
+    Tree tree = buildTree(itemBounds);
+    nodes = std::move(tree.nodes);
+    items = std::move(tree.items);
+    builtCost = sahCost(nodes);
+}
+
+void Bvh::refit(std::vector<Aabb> boxes)
+{
+    assert(boxes.size() == itemBounds.size());
+    itemBounds = std::move(boxes);
+    refitNodes();
+}
+
+void Bvh::refitNodes()
+{
+    for(size_t i = nodes.size(); i-- > 0;)
+    {
+        BvhNode& node = nodes[i];
+        node.bounds = {};
+        if(node.isLeaf())
+        {
+            for(uint32_t j = node.offset; j < node.offset + node.count; ++j)
+                node.bounds.grow(itemBounds[items[j]]);
+        }
+        else
+        {
+            node.bounds.grow(nodes[i + 1].bounds);
+            node.bounds.grow(nodes[node.offset].bounds);
+        }
+    }
+}
+
+float Bvh::degradation() const
+{
+    return builtCost > 0.0f ? sahCost(nodes) / builtCost : 1.0f;
+}
+
+void Bvh::rebuildAsync()
+{
+    if(pending.valid() or itemBounds.empty())
+        return;
+    pending = std::async(std::launch::async, [boxes = itemBounds]() { return buildTree(boxes); });
+}
+
+bool Bvh::poll()
+{
+    if(not pending.valid() or pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return false;
+
+    Tree tree = pending.get();
+    nodes = std::move(tree.nodes);
+    items = std::move(tree.items);
+    // built from a copy, anything that moved since then is only in itemBounds.
+    refitNodes();
+    builtCost = sahCost(nodes);
+    return true;
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+    if(nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while(not stack.empty())
+    {
+        const uint32_t index = stack.back();
+        stack.pop_back();
+        const BvhNode& node = nodes[index];
+
+        const Overlap overlap = classify(frustum, node.bounds);
+        if(overlap == Overlap::OUTSIDE)
+            continue;
+
+        // all of it inside, no need to look any further down.
+        if(overlap == Overlap::INSIDE or node.isLeaf())
+        {
+            uint32_t begin, end;
+            subtreeItems(nodes, index, begin, end);
+            for(uint32_t i = begin; i < end; ++i)
+            {
+                if(overlap == Overlap::INSIDE or classify(frustum, itemBounds[items[i]]) != Overlap::OUTSIDE)
+                    out.push_back(items[i]);
+            }
+            continue;
+        }
+
+        stack.push_back(node.offset);
+        stack.push_back(index + 1);
+    }
+}
+
+void Bvh::querySphere(glm::vec3 center, float radius, std::vector<uint32_t>& out) const
+{
+    if(nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while(not stack.empty())
+    {
+        const uint32_t index = stack.back();
+        stack.pop_back();
+        const BvhNode& node = nodes[index];
+        if(not sphereTouches(node.bounds, center, radius))
+            continue;
+
+        if(node.isLeaf())
+        {
+            for(uint32_t i = node.offset; i < node.offset + node.count; ++i)
+            {
+                if(sphereTouches(itemBounds[items[i]], center, radius))
+                    out.push_back(items[i]);
+            }
+            continue;
+        }
+
+        stack.push_back(node.offset);
+        stack.push_back(index + 1);
+    }
+}
+
+uint32_t Bvh::raycast(const Ray& ray, float maxT, float* hitT) const
+{
+    if(nodes.empty())
+        return NO_HIT;
+
+    const glm::vec3 invDir = glm::vec3(1.0f) / ray.direction;
+    uint32_t hit = NO_HIT;
+    float nearest = maxT;
+
+    struct Entry
+    {
+        uint32_t node;
+        float t;
+    };
+    std::vector<Entry> stack;
+    stack.reserve(64);
+
+    float t;
+    if(rayEntry(nodes[0].bounds, ray, invDir, nearest, t))
+        stack.push_back({0, t});
+
+    while(not stack.empty())
+    {
+        const Entry entry = stack.back();
+        stack.pop_back();
+        // something nearer got found since this went on the stack.
+        if(entry.t > nearest)
+            continue;
+
+        const BvhNode& node = nodes[entry.node];
+        if(node.isLeaf())
+        {
+            for(uint32_t i = node.offset; i < node.offset + node.count; ++i)
+            {
+                if(rayEntry(itemBounds[items[i]], ray, invDir, nearest, t) and (hit == NO_HIT or t < nearest))
+                {
+                    nearest = t;
+                    hit = items[i];
+                }
+            }
+            continue;
+        }
+
+        // nearer child on top, so it gets looked at first and can rule out the other one.
+        float tLeft, tRight;
+        const bool left = rayEntry(nodes[entry.node + 1].bounds, ray, invDir, nearest, tLeft);
+        const bool right = rayEntry(nodes[node.offset].bounds, ray, invDir, nearest, tRight);
+        if(left and right)
+        {
+            const bool leftFirst = tLeft <= tRight;
+            stack.push_back(leftFirst ? Entry{node.offset, tRight} : Entry{entry.node + 1, tLeft});
+            stack.push_back(leftFirst ? Entry{entry.node + 1, tLeft} : Entry{node.offset, tRight});
+        }
+        else if(left)
+        {
+            stack.push_back({entry.node + 1, tLeft});
+        }
+        else if(right)
+        {
+            stack.push_back({node.offset, tRight});
+        }
+    }
+
+    if(hit != NO_HIT and hitT)
+        *hitT = nearest;
+    return hit;
+}
+
+} // namespace render
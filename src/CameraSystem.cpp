@@ -67,6 +67,12 @@ void CameraSystem::mouseMovementCallback(GLFWwindow*, double xpos, double ypos)
 // per frame, while camera callback can happen hundreds of times per second.
 //
 // Projection matrix also needs generation only once, this will be done in ctor.
+glm::vec3 CameraSystem::getPosition()
+{
+    std::shared_lock lock(cam_mutex);
+    return cam.pos_v;
+}
+
 CameraSystem::UboData CameraSystem::genCurrentVPMatrices()
 {
     std::shared_lock lock(cam_mutex);
@@ -0,0 +1,120 @@
+#include "CommandStateCache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace render {
+
+CommandStateCache::CommandStateCache(VkCommandBuffer commandBuffer)
+    : commandBuffer(commandBuffer)
+{
+}
+
+bool CommandStateCache::record(bool changed)
+{
+    if(changed)
+        stats.recorded++;
+    else
+        stats.skipped++;
+
+    return changed;
+}
+
+void CommandStateCache::bindPipeline(VkPipeline newPipeline)
+{
+    if(not record(newPipeline != pipeline))
+        return;
+
+    pipeline = newPipeline;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+}
+
+void CommandStateCache::bindDescriptorSet(VkPipelineLayout layout, uint32_t setIndex, VkDescriptorSet set)
+{
+    assert(setIndex < MAX_SETS);
+    auto& bound = sets[setIndex];
+    if(not record(bound.layout != layout or bound.set != set))
+        return;
+
+    // binding through a layout that is not compatible disturbs sets below as well as above. Whether
+    // two layouts are (same push constant ranges, same set layouts up to the set) is not visible from
+    // their handles, so only sets bound through this very layout are known to still be there.
+    if(bound.layout != layout)
+    {
+        for(auto& other : sets)
+        {
+            if(other.layout != layout)
+                other = {};
+        }
+    }
+
+    bound = { layout, set };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setIndex, 1, &set, 0, nullptr);
+}
+
+void CommandStateCache::bindVertexBuffers(uint32_t firstBinding, uint32_t count,
+                                          const VkBuffer* buffers, const VkDeviceSize* offsets)
+{
+    assert(firstBinding + count <= MAX_VERTEX_BINDINGS);
+
+    bool changed = false;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const auto& bound = vertexBuffers[firstBinding + i];
+        changed = changed or bound.buffer != buffers[i] or bound.offset != offsets[i];
+    }
+
+    if(not record(changed))
+        return;
+
+    for(uint32_t i = 0; i < count; ++i)
+        vertexBuffers[firstBinding + i] = { buffers[i], offsets[i] };
+    vkCmdBindVertexBuffers(commandBuffer, firstBinding, count, buffers, offsets);
+}
+
+void CommandStateCache::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType type)
+{
+    if(not record(indexBuffer.buffer != buffer or indexBuffer.offset != offset or indexType != type))
+        return;
+
+    indexBuffer = { buffer, offset };
+    indexType = type;
+    vkCmdBindIndexBuffer(commandBuffer, buffer, offset, type);
+}
+
+void CommandStateCache::pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages,
+                                      uint32_t offset, uint32_t size, const void* data)
+{
+    assert(offset + size <= MAX_PUSH_CONSTANT_BYTES);
+
+    // values pushed for another layout or other stages say nothing about these.
+    if(layout != pushLayout or stages != pushStages)
+    {
+        pushLayout = layout;
+        pushStages = stages;
+        pushWritten.fill(false);
+    }
+
+    const bool written = std::all_of(pushWritten.begin() + offset, pushWritten.begin() + offset + size,
+                                     [](bool w) { return w; });
+    if(not record(not written or std::memcmp(pushData.data() + offset, data, size) != 0))
+        return;
+
+    std::memcpy(pushData.data() + offset, data, size);
+    std::fill(pushWritten.begin() + offset, pushWritten.begin() + offset + size, true);
+    vkCmdPushConstants(commandBuffer, layout, stages, offset, size, data);
+}
+
+void CommandStateCache::invalidate()
+{
+    pipeline = VK_NULL_HANDLE;
+    sets = {};
+    vertexBuffers = {};
+    indexBuffer = {};
+    pushLayout = VK_NULL_HANDLE;
+    pushStages = 0;
+    pushWritten.fill(false);
+}
+
+} // namespace render
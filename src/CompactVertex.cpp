@@ -0,0 +1,174 @@
+#include "CompactVertex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glm/gtc/packing.hpp>
+
+namespace render {
+
+static_assert(sizeof(CompactVertex) == 20);
+
+RF_VULKAN_VERTEX_DESCRIPTORS_DEFINE_BINDING(CompactVertex,
+    []() {
+        VkVertexInputBindingDescription bindingDescription {};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(CompactVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescription;
+    }());
+
+RF_VULKAN_VERTEX_DESCRIPTORS_DEFINE_ATTRIBUTES(CompactVertex,
+    []() {
+        AttributeDescriptors<4> desc;
+
+        // three component 16 bit formats are optional for vertex input, four are not.
+        desc[0].binding = 0;
+        desc[0].location = 0;
+        desc[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        desc[0].offset = offsetof(CompactVertex, pos);
+
+        desc[1].binding = 0;
+        desc[1].location = 1;
+        desc[1].format = VK_FORMAT_R16G16_SNORM;
+        desc[1].offset = offsetof(CompactVertex, surf_normals);
+
+        desc[2].binding = 0;
+        desc[2].location = 2;
+        desc[2].format = VK_FORMAT_R16G16_SNORM;
+        desc[2].offset = offsetof(CompactVertex, tangents);
+
+        desc[3].binding = 0;
+        desc[3].location = 3;
+        desc[3].format = VK_FORMAT_R16G16_SFLOAT;
+        desc[3].offset = offsetof(CompactVertex, tex_coords);
+
+        return desc;
+    }());
+
+namespace {
+
+float signNotZero(float v)
+{
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+int16_t toSnorm16(float v)
+{
+    return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+float fromSnorm16(int16_t v)
+{
+    return std::max(float(v) / 32767.0f, -1.0f);
+}
+
+// octahedral mapping, unit sphere folded onto [-1, 1]^2. Zero vectors come back as +z.
+void octEncode(glm::vec3 n, int16_t out[2])
+{
+    const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if(l1 == 0.0f)
+    {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    n /= l1;
+    glm::vec2 p(n.x, n.y);
+    if(n.z < 0.0f)
+    {
+        p = glm::vec2((1.0f - std::abs(n.y)) * signNotZero(n.x),
+                      (1.0f - std::abs(n.x)) * signNotZero(n.y));
+    }
+
+    out[0] = toSnorm16(p.x);
+    out[1] = toSnorm16(p.y);
+}
+
+// the shaders do exactly the same thing.
+glm::vec3 octDecode(const int16_t in[2])
+{
+    const glm::vec2 p(fromSnorm16(in[0]), fromSnorm16(in[1]));
+    glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+    if(n.z < 0.0f)
+    {
+        n.x = (1.0f - std::abs(p.y)) * signNotZero(p.x);
+        n.y = (1.0f - std::abs(p.x)) * signNotZero(p.y);
+    }
+
+    return glm::normalize(n);
+}
+
+uint16_t toUnorm16(float v)
+{
+    return static_cast<uint16_t>(std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f));
+}
+
+float maxComponentError(glm::vec3 a, glm::vec3 b)
+{
+    const glm::vec3 d = glm::abs(a - b);
+    return std::max(d.x, std::max(d.y, d.z));
+}
+
+// directions that were zero to begin with (no normals or tangents in the source) carry no information.
+bool directionWithin(glm::vec3 original, glm::vec3 decoded, float bound)
+{
+    const float len = glm::length(original);
+    return len == 0.0f or glm::length(original / len - decoded) <= bound;
+}
+
+} // anonymous namespace
+
+CompactVertex encodeVertex(const Vertex& v, const VertexQuantization& q)
+{
+    CompactVertex out;
+
+    for(int c = 0; c < 3; ++c)
+    {
+        out.pos[c] = q.scale[c] > 0.0f ? toUnorm16((v.pos[c] - q.bias[c]) / q.scale[c]) : 0;
+    }
+
+    octEncode(v.surf_normals, out.surf_normals);
+    octEncode(v.tangents, out.tangents);
+    out.tex_coords = glm::packHalf2x16(v.tex_coords);
+
+    return out;
+}
+
+Vertex decodeVertex(const CompactVertex& v, const VertexQuantization& q)
+{
+    glm::vec3 pos;
+    for(int c = 0; c < 3; ++c)
+    {
+        pos[c] = q.bias[c] + float(v.pos[c]) / 65535.0f * q.scale[c];
+    }
+
+    return Vertex(pos, octDecode(v.surf_normals), octDecode(v.tangents), glm::unpackHalf2x16(v.tex_coords));
+}
+
+bool quantizeVertices(const Vertex* vertices, size_t count, const VertexQuantization& q,
+                      const QuantizationErrorBounds& bounds, std::vector<CompactVertex>& out)
+{
+    out.resize(count);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        const Vertex& original = vertices[i];
+        out[i] = encodeVertex(original, q);
+        const Vertex decoded = decodeVertex(out[i], q);
+
+        const float uvError = std::max(std::abs(original.tex_coords.x - decoded.tex_coords.x),
+                                       std::abs(original.tex_coords.y - decoded.tex_coords.y));
+        if(maxComponentError(original.pos, decoded.pos) > bounds.position
+            or not directionWithin(original.surf_normals, decoded.surf_normals, bounds.direction)
+            or not directionWithin(original.tangents, decoded.tangents, bounds.direction)
+            or uvError > bounds.texCoord)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace render
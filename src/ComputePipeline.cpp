@@ -0,0 +1,60 @@
+#include "ComputePipeline.hpp"
+#include "Logger.hpp"
+#include "VulkanMacros.hpp"
+
+namespace render {
+
+ComputePipeline::ComputePipeline(const Shader& shader, VkDevice device)
+    : descriptorSetLayouts(shader.getReflectedDescriptorSetLayouts())
+    , pushConstantRange(shader.getPushConstantRange())
+    , device(device)
+{
+    if (shader.getShaderType() != VK_SHADER_STAGE_COMPUTE_BIT) {
+        throw std::runtime_error("Trying to create a ComputePipeline from a non compute shader.");
+    }
+
+    VkPipelineLayoutCreateInfo pli {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size()),
+        .pSetLayouts = descriptorSetLayouts.data(),
+    };
+
+    if(pushConstantRange.size > 0)
+    {
+        pli.pushConstantRangeCount = 1;
+        pli.pPushConstantRanges = &pushConstantRange;
+    }
+
+    VK_CHECK(vkCreatePipelineLayout(device, &pli, nullptr, &pipelineLayout));
+
+    const VkComputePipelineCreateInfo ci {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = shader.getCi(),
+        .layout = pipelineLayout,
+    };
+
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &ci, nullptr, &pipeline));
+    dbgI << "Created compute pipeline " << pipeline << NEWL;
+}
+
+ComputePipeline::ComputePipeline(ComputePipeline&& rhs)
+    : pipeline(rhs.pipeline)
+    , descriptorSetLayouts(std::move(rhs.descriptorSetLayouts))
+    , pushConstantRange(rhs.pushConstantRange)
+    , pipelineLayout(rhs.pipelineLayout)
+    , device(rhs.device)
+{
+    rhs.pipeline = VK_NULL_HANDLE;
+    rhs.pipelineLayout = VK_NULL_HANDLE;
+}
+
+ComputePipeline::~ComputePipeline()
+{
+    if (pipelineLayout != VK_NULL_HANDLE)
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+
+    if (pipeline != VK_NULL_HANDLE)
+        vkDestroyPipeline(device, pipeline, nullptr);
+}
+
+} // namespace render
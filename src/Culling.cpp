@@ -0,0 +1,117 @@
+#include "Culling.hpp"
+
+#include <algorithm>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace render {
+
+Frustum Frustum::fromMatrix(const glm::mat4& clip)
+{
+    // glm is column major, rows of the matrix are what the planes are made of.
+    const glm::mat4 m = glm::transpose(clip);
+
+    Frustum f;
+    f.planes[0] = m[3] + m[0]; // left
+    f.planes[1] = m[3] - m[0]; // right
+    f.planes[2] = m[3] + m[1]; // bottom
+    f.planes[3] = m[3] - m[1]; // top
+    f.planes[4] = m[3] + m[2]; // near
+    f.planes[5] = m[3] - m[2]; // far
+
+    // a model matrix in the mix scales the normals, sphere tests want real distances.
+    for(auto& plane : f.planes)
+    {
+        const float len = glm::length(glm::vec3(plane));
+        if(len > 0.0f)
+            plane /= len;
+    }
+
+    return f;
+}
+
+CullView CullView::forObject(const glm::mat4& viewProj, glm::vec3 cameraWorld, const glm::mat4& model)
+{
+    const float sx = glm::length(glm::vec3(model[0]));
+    const float sy = glm::length(glm::vec3(model[1]));
+    const float sz = glm::length(glm::vec3(model[2]));
+    const float maxScale = std::max(sx, std::max(sy, sz));
+    const float minScale = std::min(sx, std::min(sy, sz));
+
+    CullView view;
+    view.frustum = Frustum::fromMatrix(viewProj * model);
+    view.cameraPos = glm::vec3(glm::inverse(model) * glm::vec4(cameraWorld, 1.0f));
+    view.cones = maxScale - minScale <= 1e-3f * maxScale;
+    return view;
+}
+
+bool Frustum::sphereVisible(glm::vec3 center, float radius) const
+{
+    for(const auto& plane : planes)
+    {
+        if(glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t cullSpheres(const Frustum& frustum, const SphereSoA& spheres, std::vector<uint8_t>& visible)
+{
+    const size_t count = spheres.size();
+    visible.resize(count);
+
+    // whole groups of four go through SSE, whatever is left over through the scalar test.
+    uint32_t visibleCount = 0;
+    size_t scalarFrom = 0;
+
+#if defined(__SSE__)
+    const auto blocks = static_cast<int64_t>(count / 4);
+    scalarFrom = size_t(blocks) * 4;
+
+    __m128 planes[6][4];
+    for(int p = 0; p < 6; ++p)
+    {
+        for(int c = 0; c < 4; ++c)
+            planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+    }
+
+    #pragma omp parallel for schedule(static) reduction(+ : visibleCount) if(count >= PARALLEL_CULL_THRESHOLD)
+    for(int64_t block = 0; block < blocks; ++block)
+    {
+        const size_t i = size_t(block) * 4;
+        const __m128 x = _mm_loadu_ps(&spheres.x[i]);
+        const __m128 y = _mm_loadu_ps(&spheres.y[i]);
+        const __m128 z = _mm_loadu_ps(&spheres.z[i]);
+        const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+        // not-less-than rather than greater-or-equal, so NaNs pass just like in the scalar test.
+        __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+        for(const auto& plane : planes)
+        {
+            const __m128 dist = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(plane[0], x), _mm_mul_ps(plane[1], y)),
+                _mm_add_ps(_mm_mul_ps(plane[2], z), plane[3]));
+            inside = _mm_and_ps(inside, _mm_cmpnlt_ps(dist, negRadius));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for(int lane = 0; lane < 4; ++lane)
+        {
+            visible[i + lane] = (mask >> lane) & 1;
+        }
+        visibleCount += __builtin_popcount(mask);
+    }
+#endif
+
+    for(size_t i = scalarFrom; i < count; ++i)
+    {
+        visible[i] = frustum.sphereVisible(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+        visibleCount += visible[i];
+    }
+
+    return visibleCount;
+}
+
+} // namespace render
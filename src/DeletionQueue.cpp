@@ -0,0 +1,52 @@
+#include "DeletionQueue.hpp"
+#include "Constants.hpp"
+#include <vector>
+
+namespace render::memory
+{
+
+void DeletionQueue::push(std::function<void()> deleter)
+{
+    std::lock_guard lock(mut);
+    entries.push_back({ current_frame, std::move(deleter) });
+}
+
+void DeletionQueue::retireFrame()
+{
+    std::vector<std::function<void()>> to_run;
+
+    {
+        std::lock_guard lock(mut);
+        ++current_frame;
+
+        // entries are pushed with monotonic frame numbers, so the front is always the oldest one.
+        while (not entries.empty() and entries.front().frame + consts::maxFramesInFlight <= current_frame)
+        {
+            to_run.emplace_back(std::move(entries.front().deleter));
+            entries.pop_front();
+        }
+    }
+
+    // deleters can push new entries (slot recycling etc.), so run them without the lock.
+    for (auto& deleter : to_run)
+    {
+        deleter();
+    }
+}
+
+void DeletionQueue::flushAll()
+{
+    std::deque<Entry> to_run;
+
+    {
+        std::lock_guard lock(mut);
+        to_run.swap(entries);
+    }
+
+    for (auto& entry : to_run)
+    {
+        entry.deleter();
+    }
+}
+
+} // namespace render::memory
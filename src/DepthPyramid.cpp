@@ -0,0 +1,194 @@
+#include "DepthPyramid.hpp"
+#include "SamplerCache.hpp"
+#include "VulkanMacros.hpp"
+
+#include <algorithm>
+
+namespace render {
+
+namespace {
+
+constexpr uint32_t REDUCE_GROUP_SIZE = 8; // local_size of hiz.comp
+
+uint32_t halfUp(uint32_t v)
+{
+    return std::max((v + 1) / 2, 1u);
+}
+
+uint32_t pyramidLevels(VkExtent2D depth)
+{
+    uint32_t levels = 1;
+    for(uint32_t w = halfUp(depth.width), h = halfUp(depth.height); w > 1 or h > 1; w = halfUp(w), h = halfUp(h))
+        ++levels;
+    return levels;
+}
+
+VkImageMemoryBarrier levelBarrier(VkImage image, uint32_t level, uint32_t count, VkAccessFlags src, VkAccessFlags dst)
+{
+    return {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = src,
+        .dstAccessMask = dst,
+        .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = level,
+            .levelCount = count,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+}
+
+} // anonymous namespace
+
+DepthPyramid::DepthPyramid(std::shared_ptr<VulkanDevice> deviceptr, memory::VulkanImage& depth, const Shader& reduceShader)
+    : device(std::move(deviceptr))
+    , pipeline(reduceShader, device->getDevice())
+    , depthExtent{ depth.getCreationData().width, depth.getCreationData().height }
+    , levels(pyramidLevels(depthExtent))
+    , pyramid(memory::VulkanImageCreateInfo{
+          .width = halfUp(depthExtent.width),
+          .height = halfUp(depthExtent.height),
+          .layerCount = 1,
+          .mipLevels = levels,
+          .format = VK_FORMAT_R32_SFLOAT,
+          .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      }, device)
+{
+    pyramidView = pyramid.createMipView(0, levels);
+    for(uint32_t level = 0; level < levels; ++level)
+        levelViews.push_back(pyramid.createMipView(level, 1));
+
+    // texelFetch only, filtering does not matter.
+    const auto samplerCi = memory::samplerPresets::nearest(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+    VK_CHECK(vkCreateSampler(device->getDevice(), &samplerCi, nullptr, &sampler));
+
+    // GENERAL once and for all, contents are garbage until the first build.
+    device->immediateSubmitBlocking([this](VkCommandBuffer cmd) {
+        VkImageMemoryBarrier barrier = levelBarrier(pyramid.getImage(), 0, levels, 0, VK_ACCESS_SHADER_WRITE_BIT);
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+    });
+
+    createDescriptorSets(depth.getImageView());
+}
+
+DepthPyramid::~DepthPyramid()
+{
+    vkDestroyDescriptorPool(device->getDevice(), descriptorPool, nullptr);
+    vkDestroySampler(device->getDevice(), sampler, nullptr);
+    for(auto view : levelViews)
+        vkDestroyImageView(device->getDevice(), view, nullptr);
+    vkDestroyImageView(device->getDevice(), pyramidView, nullptr);
+    pyramid.destroy();
+}
+
+void DepthPyramid::createDescriptorSets(VkImageView depthView)
+{
+    const VkDescriptorPoolSize poolSizes[] = {
+        {
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = levels,
+        },
+        {
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = levels,
+        },
+    };
+
+    const VkDescriptorPoolCreateInfo ci = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = levels,
+        .poolSizeCount = 2,
+        .pPoolSizes = poolSizes
+    };
+
+    VK_CHECK(vkCreateDescriptorPool(device->getDevice(), &ci, nullptr, &descriptorPool));
+
+    std::vector<VkDescriptorSetLayout> setLayouts(levels, pipeline.getDescriptorSetLayout(0));
+    VkDescriptorSetAllocateInfo ai = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = descriptorPool,
+        .descriptorSetCount = levels,
+        .pSetLayouts = setLayouts.data()
+    };
+
+    levelSets.resize(levels);
+    VK_CHECK(vkAllocateDescriptorSets(device->getDevice(), &ai, levelSets.data()));
+
+    for(uint32_t level = 0; level < levels; ++level)
+    {
+        const VkDescriptorImageInfo srcInfo = {
+            .sampler = sampler,
+            .imageView = level == 0 ? depthView : levelViews[level - 1],
+            .imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL,
+        };
+
+        const VkDescriptorImageInfo dstInfo = {
+            .sampler = VK_NULL_HANDLE,
+            .imageView = levelViews[level],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        };
+
+        const VkWriteDescriptorSet wds[] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = levelSets[level],
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &srcInfo
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = levelSets[level],
+                .dstBinding = 1,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = &dstInfo
+            },
+        };
+
+        vkUpdateDescriptorSets(device->getDevice(), 2, wds, 0, nullptr);
+    }
+}
+
+void DepthPyramid::cmdBuild(VkCommandBuffer commandBuffer)
+{
+    const VkImage image = pyramid.getImage();
+
+    // last frame's culling might still be reading it.
+    const VkImageMemoryBarrier reuse = levelBarrier(image, 0, levels, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &reuse);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getHandle());
+
+    uint32_t width = depthExtent.width;
+    uint32_t height = depthExtent.height;
+    for(uint32_t level = 0; level < levels; ++level)
+    {
+        width = halfUp(width);
+        height = halfUp(height);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getLayoutHandle(),
+            0, 1, &levelSets[level], 0, nullptr);
+        vkCmdDispatch(commandBuffer, (width + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+            (height + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+
+        // next level reads this one, culling reads all of them.
+        const VkImageMemoryBarrier written = levelBarrier(image, level, 1, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &written);
+    }
+}
+
+} // namespace render
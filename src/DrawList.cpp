@@ -0,0 +1,68 @@
+#include "DrawList.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace render {
+
+uint64_t DrawKey::make(uint32_t pipeline, uint32_t set, uint32_t geometry, float depth, uint32_t material)
+{
+    // positive floats sort the same as their bits, the top ones are plenty for ordering.
+    uint32_t depthBits = 0;
+    if(depth > 0.0f)
+    {
+        std::memcpy(&depthBits, &depth, sizeof(depth));
+        depthBits >>= 32 - DEPTH_BITS;
+    }
+
+    auto field = [](uint32_t value, uint32_t bits) { return uint64_t(value & ((1u << bits) - 1)); };
+
+    uint64_t key = field(pipeline, PIPELINE_BITS);
+    key = (key << SET_BITS) | field(set, SET_BITS);
+    key = (key << GEOMETRY_BITS) | field(geometry, GEOMETRY_BITS);
+    key = (key << DEPTH_BITS) | depthBits;
+    key = (key << MATERIAL_BITS) | field(material, MATERIAL_BITS);
+    return key;
+}
+
+void radixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch)
+{
+    constexpr int PASSES = 8;
+    const size_t count = items.size();
+    if(count < 2)
+        return;
+
+    // all histograms in one go.
+    std::array<std::array<uint32_t, 256>, PASSES> histograms {};
+    for(const auto& item : items)
+    {
+        for(int pass = 0; pass < PASSES; ++pass)
+            histograms[pass][(item.key >> (pass * 8)) & 0xff]++;
+    }
+
+    scratch.resize(count);
+    for(int pass = 0; pass < PASSES; ++pass)
+    {
+        auto& histogram = histograms[pass];
+        const int shift = pass * 8;
+
+        // every key has the same byte here, nothing would move.
+        if(histogram[(items[0].key >> shift) & 0xff] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for(auto& bucket : histogram)
+        {
+            const uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+
+        for(const auto& item : items)
+            scratch[histogram[(item.key >> shift) & 0xff]++] = item;
+
+        items.swap(scratch);
+    }
+}
+
+} // namespace render
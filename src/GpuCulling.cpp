@@ -0,0 +1,263 @@
+#include "GpuCulling.hpp"
+#include "VulkanMacros.hpp"
+
+#include <cassert>
+
+namespace render {
+
+namespace {
+
+constexpr uint32_t CULL_GROUP_SIZE = 64; // local_size_x of cull.comp
+constexpr VkDeviceSize COMMAND_STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+constexpr VkDeviceSize PHASE_COUNTS_SIZE = 2 * sizeof(uint32_t);
+
+VkBufferMemoryBarrier bufferBarrier(VkBuffer buffer, VkAccessFlags src, VkAccessFlags dst,
+                                    VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE)
+{
+    return {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = src,
+        .dstAccessMask = dst,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = buffer,
+        .offset = offset,
+        .size = size,
+    };
+}
+
+} // anonymous namespace
+
+bool GpuCulling::supported(const VulkanDevice& device)
+{
+    return device.getEnabledFeatures().drawIndirectFirstInstance;
+}
+
+GpuCulling::GpuCulling(std::shared_ptr<VulkanDevice> deviceptr,
+                       std::shared_ptr<ComputePipeline> cullPipeline,
+                       std::shared_ptr<DepthPyramid> pyramid,
+                       const ModelData& model,
+                       const ObjectDescriptorSets& objectSets)
+    : device(std::move(deviceptr))
+    , pipeline(std::move(cullPipeline))
+    , depthPyramid(std::move(pyramid))
+    , meshCount(static_cast<uint32_t>(model.getMeshes().size()))
+    , fullMeshCount(model.fullMeshCount())
+{
+    if (not supported(*device))
+        throw std::runtime_error("GPU culling needs drawIndirectFirstInstance.");
+
+    // the shader indexes the model's buffers with it, a model without meshes just never dispatches.
+    const size_t meshes = std::max<uint32_t>(meshCount, 1);
+    drawBuffers.reserve(consts::maxFramesInFlight);
+    countBuffers.reserve(consts::maxFramesInFlight);
+    for(uint32_t i = 0; i < consts::maxFramesInFlight; ++i)
+    {
+        drawBuffers.emplace_back(device, 2 * meshes * COMMAND_STRIDE,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY);
+        countBuffers.emplace_back(device, 2 * PHASE_COUNTS_SIZE,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+
+    visibilityBuffer = memory::VmaVulkanBuffer(device, meshes * sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    device->immediateSubmitBlocking([this](VkCommandBuffer cmd) {
+        vkCmdFillBuffer(cmd, visibilityBuffer.getVkBuffer(), 0, VK_WHOLE_SIZE, 0);
+    });
+
+    createDescriptorPool();
+    generateDescriptorSets(model, objectSets);
+}
+
+GpuCulling::~GpuCulling()
+{
+    for(auto& buffer : drawBuffers)
+        buffer.destroy();
+    for(auto& buffer : countBuffers)
+        buffer.destroy();
+    visibilityBuffer.destroy();
+    vkDestroyDescriptorPool(device->getDevice(), descriptorPool, nullptr);
+}
+
+void GpuCulling::createDescriptorPool()
+{
+    const VkDescriptorPoolSize poolSizes[] = {
+        {
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = consts::maxFramesInFlight * 5, // meshes, nodes, commands, counts, visibility
+        },
+        {
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = consts::maxFramesInFlight, // depth pyramid
+        },
+    };
+
+    const VkDescriptorPoolCreateInfo ci = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = consts::maxFramesInFlight,
+        .poolSizeCount = 2,
+        .pPoolSizes = poolSizes
+    };
+
+    VK_CHECK(vkCreateDescriptorPool(device->getDevice(), &ci, nullptr, &descriptorPool));
+}
+
+void GpuCulling::generateDescriptorSets(const ModelData& model, const ObjectDescriptorSets& objectSets)
+{
+    std::vector<VkDescriptorSetLayout> setLayouts(consts::maxFramesInFlight, pipeline->getDescriptorSetLayout(0));
+
+    VkDescriptorSetAllocateInfo ai = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = descriptorPool,
+        .descriptorSetCount = consts::maxFramesInFlight,
+        .pSetLayouts = setLayouts.data()
+    };
+
+    descriptorSets.resize(consts::maxFramesInFlight);
+    VK_CHECK(vkAllocateDescriptorSets(device->getDevice(), &ai, descriptorSets.data()));
+
+    // nothing to point at, nothing gets dispatched either.
+    if(meshCount == 0)
+        return;
+
+    const VkDescriptorImageInfo pyramidInfo = {
+        .sampler = depthPyramid->getSampler(),
+        .imageView = depthPyramid->getView(),
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+    };
+
+    for (uint32_t i = 0; i < descriptorSets.size(); ++i) {
+        const VkDescriptorBufferInfo infos[] = {
+            { .buffer = model.getCullDataBuffer().getVkBuffer(), .offset = 0, .range = VK_WHOLE_SIZE },
+            { .buffer = objectSets.getNodeBuffer(i).getVkBuffer(), .offset = 0, .range = VK_WHOLE_SIZE },
+            { .buffer = drawBuffers[i].getVkBuffer(), .offset = 0, .range = VK_WHOLE_SIZE },
+            { .buffer = countBuffers[i].getVkBuffer(), .offset = 0, .range = VK_WHOLE_SIZE },
+        };
+
+        const VkDescriptorBufferInfo visibilityInfo = {
+            .buffer = visibilityBuffer.getVkBuffer(),
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        VkWriteDescriptorSet wds[6];
+        for (uint32_t binding = 0; binding < 4; ++binding) {
+            wds[binding] = {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSets[i],
+                .dstBinding = binding,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &infos[binding]
+            };
+        }
+
+        wds[4] = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptorSets[i],
+            .dstBinding = 4,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &pyramidInfo
+        };
+
+        wds[5] = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptorSets[i],
+            .dstBinding = 5,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &visibilityInfo
+        };
+
+        vkUpdateDescriptorSets(device->getDevice(), 6, wds, 0, nullptr);
+    }
+}
+
+void GpuCulling::cmdDispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex, ECullPhase phase,
+                             GpuCullConstants constants) const
+{
+    assert(frameIndex < descriptorSets.size());
+    if(meshCount == 0)
+        return;
+
+    const uint32_t phaseIdx = static_cast<uint32_t>(phase);
+    const VkBuffer draws = drawBuffers[frameIndex].getVkBuffer();
+    const VkBuffer counts = countBuffers[frameIndex].getVkBuffer();
+    const VkDeviceSize drawsOffset = phaseIdx * meshCount * COMMAND_STRIDE;
+    const VkDeviceSize drawsSize = meshCount * COMMAND_STRIDE;
+    const VkDeviceSize countsOffset = phaseIdx * PHASE_COUNTS_SIZE;
+
+    // without a count to draw with, the whole range gets drawn, so what nobody wrote has to be an empty draw.
+    const bool clearDraws = not device->hasDrawIndirectCount();
+    vkCmdFillBuffer(commandBuffer, counts, countsOffset, PHASE_COUNTS_SIZE, 0);
+    if(clearDraws)
+        vkCmdFillBuffer(commandBuffer, draws, drawsOffset, drawsSize, 0);
+
+    // visibility goes LATE -> next EARLY and EARLY -> LATE, both compute to compute.
+    const VkBufferMemoryBarrier ready[] = {
+        bufferBarrier(counts, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                      countsOffset, PHASE_COUNTS_SIZE),
+        bufferBarrier(visibilityBuffer.getVkBuffer(), VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT),
+        bufferBarrier(draws, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT, drawsOffset, drawsSize),
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, clearDraws ? 3 : 2, ready, 0, nullptr);
+
+    const VkExtent2D depthExtent = depthPyramid->getDepthExtent();
+    constants.phase = phaseIdx;
+    constants.pyramidLevels = depthPyramid->levelCount();
+    constants.depthSize = glm::vec2(float(depthExtent.width), float(depthExtent.height));
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getHandle());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getLayoutHandle(),
+        0, 1, &descriptorSets[frameIndex], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipeline->getLayoutHandle(), VK_SHADER_STAGE_COMPUTE_BIT,
+        0, sizeof(GpuCullConstants), &constants);
+    vkCmdDispatch(commandBuffer, (meshCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    const VkBufferMemoryBarrier written[] = {
+        bufferBarrier(draws, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, drawsOffset, drawsSize),
+        bufferBarrier(counts, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, countsOffset, PHASE_COUNTS_SIZE),
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+        0, nullptr, 2, written, 0, nullptr);
+}
+
+void GpuCulling::cmdDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex, ECullPhase phase, bool compact) const
+{
+    assert(frameIndex < drawBuffers.size());
+
+    const uint32_t phaseIdx = static_cast<uint32_t>(phase);
+    const uint32_t first = phaseIdx * meshCount + (compact ? fullMeshCount : 0);
+    const uint32_t capacity = compact ? meshCount - fullMeshCount : fullMeshCount;
+    if(capacity == 0)
+        return;
+
+    const VkBuffer draws = drawBuffers[frameIndex].getVkBuffer();
+    if(device->hasDrawIndirectCount())
+    {
+        device->cmdDrawIndexedIndirectCount(commandBuffer, draws, first * COMMAND_STRIDE,
+            countBuffers[frameIndex].getVkBuffer(), (phaseIdx * 2 + (compact ? 1 : 0)) * sizeof(uint32_t),
+            capacity, COMMAND_STRIDE);
+        return;
+    }
+
+    // zeroed commands past the survivors draw nothing, they only cost the command processor a look.
+    if(device->getEnabledFeatures().multiDrawIndirect)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, draws, first * COMMAND_STRIDE, capacity, COMMAND_STRIDE);
+        return;
+    }
+
+    for(uint32_t i = first; i < first + capacity; ++i)
+        vkCmdDrawIndexedIndirect(commandBuffer, draws, i * COMMAND_STRIDE, 1, COMMAND_STRIDE);
+}
+
+} // namespace render
@@ -0,0 +1,42 @@
+#include "InstanceData.hpp"
+#include <cstddef>
+
+namespace render {
+
+static_assert(sizeof(InstanceData) == 48);
+
+RF_VULKAN_VERTEX_DESCRIPTORS_DEFINE_BINDING(InstanceData,
+    []() {
+        VkVertexInputBindingDescription bindingDescription {};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        return bindingDescription;
+    }());
+
+RF_VULKAN_VERTEX_DESCRIPTORS_DEFINE_ATTRIBUTES(InstanceData,
+    []() {
+        AttributeDescriptors<3> desc;
+
+        // locations 0-3 are the mesh vertex.
+        for(uint32_t row = 0; row < 3; ++row)
+        {
+            desc[row].binding = 1;
+            desc[row].location = 4 + row;
+            desc[row].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            desc[row].offset = offsetof(InstanceData, transform) + row * sizeof(glm::vec4);
+        }
+
+        return desc;
+    }());
+
+InstanceData::InstanceData(const glm::mat4& model)
+{
+    // glm is column major, rows get picked out across columns.
+    for(int row = 0; row < 3; ++row)
+    {
+        transform[row] = glm::vec4(model[0][row], model[1][row], model[2][row], model[3][row]);
+    }
+}
+
+} // namespace render
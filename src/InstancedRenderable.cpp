@@ -0,0 +1,91 @@
+#include "InstancedRenderable.hpp"
+#include <algorithm>
+
+namespace render {
+
+InstancedRenderable::InstancedRenderable(
+        std::shared_ptr<VulkanDevice> deviceptr,
+        std::shared_ptr<Pipeline> pipeline,
+        std::shared_ptr<const ModelData> model)
+    : device(std::move(deviceptr))
+    , modelData(std::move(model))
+    , hierarchy(modelData->getHierarchy())
+    , pipeline(std::move(pipeline))
+    , sets(std::make_unique<ObjectDescriptorSets>(device, *this->pipeline, *modelData))
+    , frameInstances(consts::maxFramesInFlight)
+{
+    // there is one instanced shader and it takes full vertices.
+    assert(not modelData->hasCompactMeshes());
+}
+
+InstancedRenderable::~InstancedRenderable()
+{
+    for(auto& frame : frameInstances)
+        frame.buffer.destroy();
+}
+
+void InstancedRenderable::setInstances(std::vector<InstanceData> newInstances)
+{
+    instances = std::move(newInstances);
+    ++instancesVersion;
+}
+
+void InstancedRenderable::updateUniforms(RenderableUbo ubo, size_t bufferIdx)
+{
+    hierarchy.updateWorldTransforms();
+    sets->update(std::move(ubo), hierarchy, bufferIdx);
+
+    auto& frame = frameInstances[bufferIdx];
+    if(frame.version == instancesVersion)
+        return;
+
+    if(instances.size() > frame.capacity)
+    {
+        // last frame that used this slot might still be on the GPU.
+        if(frame.buffer.getVkBuffer() != VK_NULL_HANDLE)
+        {
+            device->getDeletionQueue().push([old = frame.buffer]() mutable { old.destroy(); });
+        }
+
+        frame.capacity = std::max(instances.size(), frame.capacity * 2);
+        frame.buffer = memory::VmaVulkanBuffer(device, frame.capacity * sizeof(InstanceData),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        frame.buffer.map();
+    }
+
+    frame.buffer.copyToBuffer(instances.data(), instances.size() * sizeof(InstanceData));
+    frame.count = static_cast<uint32_t>(instances.size());
+    frame.version = instancesVersion;
+}
+
+void InstancedRenderable::cmdBindSetsDrawMeshes(CommandStateCache& state, uint32_t frameIndex)
+{
+    assert(frameIndex < frameInstances.size());
+    const auto& frame = frameInstances[frameIndex];
+    const auto& meshes = modelData->getMeshes();
+    if(frame.count == 0 or meshes.empty())
+        return;
+
+    const VkPipelineLayout layout = pipeline->getLayoutHandle();
+    state.bindPipeline(pipeline->getHandle());
+    sets->bind(state, layout, frameIndex);
+
+    const VkBuffer vertexBuffers[] = { modelData->getVertexBuffer().getVkBuffer(), frame.buffer.getVkBuffer() };
+    const VkDeviceSize offsets[] = { 0, 0 };
+    state.bindVertexBuffers(0, 2, vertexBuffers, offsets);
+    state.bindIndexBuffer(modelData->getIndexBuffer().getVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+    for(uint32_t i = 0; i < meshes.size(); ++i)
+    {
+        const auto& mesh = meshes[i];
+        const auto& range = mesh.getBufferRange();
+        const MeshLod level = mesh.getLod(drawLod);
+
+        const InstancedPushConstantData push = { .draw_idx = i };
+        state.pushConstants(layout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(push), &push);
+        vkCmdDrawIndexed(state.get(), level.indexCount, frame.count, range.firstIndex + level.indexOffset,
+                         range.vertexOffset, 0);
+    }
+}
+
+} // namespace render
@@ -1,45 +1,124 @@
 #include "Mesh.hpp"
-#include "VulkanMacros.hpp"
-#include <cstring>
 
 namespace render {
 
-Mesh::Mesh(std::shared_ptr<VulkanDevice> deviceptr,
-        const std::vector<Vertex>& mesh_data,
-        const std::vector<uint32_t>& indices,
-        MeshPushConstantData data)
-    : device(std::move(deviceptr))
-    , allocator(device->getVmaAllocator())
-    , vertices(mesh_data.size())
-    , indices(indices.size())
-    , vertex_buffer(device, mesh_data,
-          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY)
-    , index_buffer(device, indices,
-          VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY)
-    , push_constant_data(std::move(data))
+Mesh::Mesh(MeshDrawData data,
+        std::vector<memory::TextureHandle> textures,
+        MeshBufferRange range,
+        bool compact)
+    : draw_data(std::move(data))
+    , range(range)
+    , compact(compact)
+    , textures(std::move(textures))
 {
 }
 
-Mesh::~Mesh()
+void Mesh::setLods(std::vector<MeshLod> lod_ranges, std::vector<Meshlet> clusters, MeshBounds mesh_bounds)
 {
-    // later as i will also need move assignment and move ctor, too lazy to write now
-    //if(allocator)
-    //    vmaDestroyBuffer(allocator, vertex_buffer.memory_buffer, vertex_buffer.allocation);
+    lods = std::move(lod_ranges);
+    meshlets = std::move(clusters);
+    bounds = mesh_bounds;
 }
 
-void Mesh::cmdDraw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)
+MeshLod Mesh::getLod(size_t lod) const
 {
-    // we do not use getpOffset as this gives offset in underlying VkDeviceMemory.
-    // And we want to go from start of the buffer, so just 0.
-    VkDeviceSize size{0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, getVkInfo().getpVkBuffer(), &size);
-    vkCmdBindIndexBuffer(commandBuffer, index_buffer.getVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    if(lods.empty())
+        return { 0, range.indexCount, 0.0f, 0, 0 };
 
-    if(pipelineLayout != VK_NULL_HANDLE)
+    return lods[std::min(lod, lods.size() - 1)];
+}
+
+size_t Mesh::maxDraws() const
+{
+    // every run is at least one meshlet.
+    size_t most = 1;
+    for(const auto& lod : lods)
+    {
+        most = std::max<size_t>(most, lod.meshletCount);
+    }
+
+    return most;
+}
+
+MeshCullData Mesh::getCullData() const
+{
+    MeshCullData data {
+        .sphere = { bounds.center.x, bounds.center.y, bounds.center.z, bounds.radius },
+        .node = draw_data.node,
+        .vertexOffset = range.vertexOffset,
+        .lodCount = static_cast<uint32_t>(std::min(lodCount(), MAX_MESH_LODS)),
+        .compact = compact ? 1u : 0u,
+        .lods = {},
+    };
+
+    for(uint32_t i = 0; i < data.lodCount; ++i)
+    {
+        const MeshLod lod = getLod(i);
+        data.lods[i] = { range.firstIndex + lod.indexOffset, lod.indexCount, lod.error, 0 };
+    }
+
+    return data;
+}
+
+uint32_t Mesh::writeDraws(VkDrawIndexedIndirectCommand* out, uint32_t drawIndex, size_t lod,
+                          const CullView& view, CullStats& stats) const
+{
+    uint32_t written = 0;
+    auto emit = [&](uint32_t indexOffset, uint32_t indexCount)
     {
-        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(MeshPushConstantData), &push_constant_data);
+        out[written++] = {
+            .indexCount = indexCount,
+            .instanceCount = 1,
+            .firstIndex = range.firstIndex + indexOffset,
+            .vertexOffset = range.vertexOffset,
+            .firstInstance = drawIndex,
+        };
+        stats.draws++;
+    };
+
+    const MeshLod* level = lods.empty() ? nullptr : &lods[std::min(lod, lods.size() - 1)];
+    if(not level or level->meshletCount == 0)
+    {
+        if(level)
+            emit(level->indexOffset, level->indexCount);
+        else
+            emit(0, range.indexCount);
+        return written;
     }
 
-    vkCmdDrawIndexed(commandBuffer, indices, 1, 0, 0, 0);
+    uint32_t runOffset = 0;
+    uint32_t runCount = 0;
+    auto flush = [&]()
+    {
+        if(runCount == 0)
+            return;
+
+        emit(runOffset, runCount);
+        runCount = 0;
+    };
+
+    stats.meshletsTested += level->meshletCount;
+    for(uint32_t m = level->meshletOffset; m < level->meshletOffset + level->meshletCount; ++m)
+    {
+        const Meshlet& meshlet = meshlets[m];
+        const bool visible = view.frustum.sphereVisible(meshlet.center, meshlet.radius)
+            and not (view.cones and coneBackfacing(meshlet.center, meshlet.radius, meshlet.coneAxis,
+                                                   meshlet.coneCutoff, view.cameraPos));
+        if(not visible)
+        {
+            flush();
+            continue;
+        }
+
+        // meshlets of a level follow each other in the index buffer.
+        if(runCount == 0)
+            runOffset = meshlet.indexOffset;
+        runCount += meshlet.indexCount;
+        stats.meshletsDrawn++;
+    }
+
+    flush();
+    return written;
 }
+
 } // namespace render
@@ -0,0 +1,455 @@
+#include "MeshCache.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace render {
+
+namespace {
+
+// vertices go to the GPU byte for byte, so no padding surprises and no pointers.
+static_assert(std::is_trivially_copyable_v<Vertex>);
+static_assert(std::is_trivially_copyable_v<MeshLod>);
+static_assert(std::is_trivially_copyable_v<Meshlet>);
+
+constexpr char MAGIC[4] = { 'R', 'F', 'M', 'C' };
+constexpr size_t STREAM_ALIGNMENT = 16;
+constexpr size_t PATHS_PER_MESH = 6; // diffuse, normal, 4 material channels
+
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t importFlags;
+    uint32_t vertexSize;
+    uint64_t meshCount;
+    uint64_t nodeCount;
+    uint64_t fileSize;
+};
+
+struct MeshRecord
+{
+    uint64_t vertexOffset;
+    uint64_t vertexCount;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+    uint64_t meshletOffset;
+    uint64_t meshletCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    float sphereCenter[3];
+    float sphereRadius;
+    uint64_t pathOffsets[PATHS_PER_MESH];
+    uint32_t pathLengths[PATHS_PER_MESH];
+    uint32_t node;
+    uint32_t lodCount;
+    MeshLod lods[MAX_MESH_LODS];
+};
+
+struct NodeRecord
+{
+    int32_t parent;
+    float translation[3];
+    float rotation[4]; // w, x, y, z
+    float scale[3];
+};
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+std::array<const std::string*, PATHS_PER_MESH> pathsOf(const MeshMaterialPaths& material)
+{
+    return { &material.diffuse, &material.normal,
+             &material.channels[0], &material.channels[1], &material.channels[2], &material.channels[3] };
+}
+
+std::array<std::string*, PATHS_PER_MESH> pathsOf(MeshMaterialPaths& material)
+{
+    return { &material.diffuse, &material.normal,
+             &material.channels[0], &material.channels[1], &material.channels[2], &material.channels[3] };
+}
+
+// read-only mapping of a whole file. nullptr on failure, or for empty files.
+void* mapFile(const std::string& path, size_t& size)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 or st.st_size == 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // mapping keeps its own reference.
+
+    if(mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    // whole file gets read anyway, start pulling it in.
+    madvise(mapping, size, MADV_WILLNEED);
+    return mapping;
+}
+
+} // anonymous namespace
+
+uint64_t MeshCache::hashFile(const std::string& path)
+{
+    size_t size = 0;
+    void* mapping = mapFile(path, size);
+    if(not mapping)
+    {
+        return 0;
+    }
+
+    constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    const auto* bytes = static_cast<const uint8_t*>(mapping);
+    uint64_t hash = FNV_OFFSET;
+    size_t i = 0;
+
+    // byte at a time is too slow for big models, words are plenty good for a cache key.
+    for(; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+
+    for(; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+
+    munmap(mapping, size);
+
+    // mix in the size so a truncated file does not collide that easily.
+    return (hash ^ size) * FNV_PRIME;
+}
+
+std::unique_ptr<MeshCache> MeshCache::open(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags)
+{
+    size_t size = 0;
+    void* mapping = mapFile(cachePath, size);
+    if(not mapping)
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<MeshCache> cache{new MeshCache(mapping, size)};
+    if(not cache->parse(sourceHash, importFlags))
+    {
+        dbgI << "Mesh cache " << cachePath << " is stale or corrupt, ignoring." << NEWL;
+        return nullptr;
+    }
+
+    return cache;
+}
+
+MeshCache::MeshCache(void* mapping, size_t size)
+    : mapping(mapping)
+    , mappingSize(size)
+{
+}
+
+MeshCache::~MeshCache()
+{
+    munmap(mapping, mappingSize);
+}
+
+bool MeshCache::parse(uint64_t sourceHash, uint32_t importFlags)
+{
+    const auto* base = static_cast<const uint8_t*>(mapping);
+
+    if(mappingSize < sizeof(FileHeader))
+    {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+        or header.version != VERSION
+        or header.sourceHash != sourceHash
+        or header.importFlags != importFlags
+        or header.vertexSize != sizeof(Vertex)
+        or header.fileSize != mappingSize
+        or header.meshCount > (mappingSize - sizeof(FileHeader)) / sizeof(MeshRecord))
+    {
+        return false;
+    }
+
+    const size_t nodesOffset = sizeof(FileHeader) + header.meshCount * sizeof(MeshRecord);
+    if(header.nodeCount > (mappingSize - nodesOffset) / sizeof(NodeRecord))
+    {
+        return false;
+    }
+
+    for(uint64_t i = 0; i < header.nodeCount; ++i)
+    {
+        NodeRecord record;
+        std::memcpy(&record, base + nodesOffset + i * sizeof(NodeRecord), sizeof(record));
+
+        // parents first is what the hierarchy relies on, anything else is garbage.
+        if(record.parent != SceneHierarchy::NO_PARENT and (record.parent < 0 or uint64_t(record.parent) >= i))
+        {
+            return false;
+        }
+
+        nodes.addNode(record.parent,
+            glm::vec3(record.translation[0], record.translation[1], record.translation[2]),
+            glm::quat(record.rotation[0], record.rotation[1], record.rotation[2], record.rotation[3]),
+            glm::vec3(record.scale[0], record.scale[1], record.scale[2]));
+    }
+
+    // everything below is bounds checked, a damaged file is a miss and not a crash.
+    auto inRange = [this](uint64_t offset, uint64_t count, uint64_t elementSize)
+    {
+        return offset <= mappingSize and count <= (mappingSize - offset) / elementSize;
+    };
+
+    views.reserve(header.meshCount);
+    for(uint64_t i = 0; i < header.meshCount; ++i)
+    {
+        MeshRecord record;
+        std::memcpy(&record, base + sizeof(FileHeader) + i * sizeof(MeshRecord), sizeof(record));
+
+        if(not inRange(record.vertexOffset, record.vertexCount, sizeof(Vertex))
+            or not inRange(record.indexOffset, record.indexCount, sizeof(uint32_t))
+            or not inRange(record.meshletOffset, record.meshletCount, sizeof(Meshlet))
+            or record.vertexOffset % alignof(Vertex) != 0
+            or record.indexOffset % alignof(uint32_t) != 0
+            or record.meshletOffset % alignof(Meshlet) != 0
+            or record.node >= header.nodeCount
+            or record.lodCount == 0 or record.lodCount > MAX_MESH_LODS)
+        {
+            return false;
+        }
+
+        for(uint32_t l = 0; l < record.lodCount; ++l)
+        {
+            const auto& lod = record.lods[l];
+            if(lod.indexOffset > record.indexCount or lod.indexCount > record.indexCount - lod.indexOffset
+                or lod.meshletOffset > record.meshletCount or lod.meshletCount > record.meshletCount - lod.meshletOffset)
+            {
+                return false;
+            }
+        }
+
+        // a truncated or stale file can still be in range everywhere above, with indices pointing
+        // past the vertices. Those would go straight to the GPU and into CPU culling.
+        const auto* indices = reinterpret_cast<const uint32_t*>(base + record.indexOffset);
+        if(std::any_of(indices, indices + record.indexCount, [&](uint32_t index) { return index >= record.vertexCount; }))
+        {
+            return false;
+        }
+
+        const auto* meshlets = reinterpret_cast<const Meshlet*>(base + record.meshletOffset);
+        for(uint64_t m = 0; m < record.meshletCount; ++m)
+        {
+            if(meshlets[m].indexOffset > record.indexCount or meshlets[m].indexCount > record.indexCount - meshlets[m].indexOffset)
+            {
+                return false;
+            }
+        }
+
+        MeshView view{};
+        view.vertices = reinterpret_cast<const Vertex*>(base + record.vertexOffset);
+        view.vertexCount = record.vertexCount;
+        view.indices = indices;
+        view.indexCount = record.indexCount;
+        view.bounds.min = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+        view.bounds.max = glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+        view.bounds.center = glm::vec3(record.sphereCenter[0], record.sphereCenter[1], record.sphereCenter[2]);
+        view.bounds.radius = record.sphereRadius;
+        view.node = record.node;
+        view.lods.assign(record.lods, record.lods + record.lodCount);
+        view.meshlets = meshlets;
+        view.meshletCount = record.meshletCount;
+
+        auto paths = pathsOf(view.material);
+        for(size_t p = 0; p < PATHS_PER_MESH; ++p)
+        {
+            if(not inRange(record.pathOffsets[p], record.pathLengths[p], 1))
+            {
+                return false;
+            }
+
+            paths[p]->assign(reinterpret_cast<const char*>(base + record.pathOffsets[p]), record.pathLengths[p]);
+        }
+
+        views.push_back(std::move(view));
+    }
+
+    return true;
+}
+
+bool MeshCache::write(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags,
+                      const ModelImportData& model)
+{
+    const auto& meshes = model.meshes;
+    const auto& hierarchy = model.hierarchy;
+
+    // lay everything out first, then stream it in one go.
+    std::vector<MeshRecord> records(meshes.size());
+    std::vector<NodeRecord> nodeRecords(hierarchy.size());
+    std::string strings;
+
+    for(uint32_t i = 0; i < nodeRecords.size(); ++i)
+    {
+        auto& record = nodeRecords[i];
+        const auto& t = hierarchy.translation(i);
+        const auto& r = hierarchy.rotation(i);
+        const auto& s = hierarchy.scale(i);
+
+        record.parent = hierarchy.parent(i);
+        record.translation[0] = t.x; record.translation[1] = t.y; record.translation[2] = t.z;
+        record.rotation[0] = r.w; record.rotation[1] = r.x; record.rotation[2] = r.y; record.rotation[3] = r.z;
+        record.scale[0] = s.x; record.scale[1] = s.y; record.scale[2] = s.z;
+    }
+
+    size_t offset = sizeof(FileHeader) + records.size() * sizeof(MeshRecord) + nodeRecords.size() * sizeof(NodeRecord);
+    const size_t stringsOffset = offset;
+
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        auto paths = pathsOf(meshes[i].material);
+        for(size_t p = 0; p < PATHS_PER_MESH; ++p)
+        {
+            records[i].pathOffsets[p] = stringsOffset + strings.size();
+            records[i].pathLengths[p] = static_cast<uint32_t>(paths[p]->size());
+            strings += *paths[p];
+        }
+    }
+
+    offset += strings.size();
+
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        auto& record = records[i];
+        const auto& mesh = meshes[i];
+
+        offset = alignUp(offset, STREAM_ALIGNMENT);
+        record.vertexOffset = offset;
+        record.vertexCount = mesh.vertices.size();
+        offset += mesh.vertices.size() * sizeof(Vertex);
+
+        offset = alignUp(offset, STREAM_ALIGNMENT);
+        record.indexOffset = offset;
+        record.indexCount = mesh.indices.size();
+        offset += mesh.indices.size() * sizeof(uint32_t);
+
+        offset = alignUp(offset, STREAM_ALIGNMENT);
+        record.meshletOffset = offset;
+        record.meshletCount = mesh.meshlets.size();
+        offset += mesh.meshlets.size() * sizeof(Meshlet);
+
+        for(int c = 0; c < 3; ++c)
+        {
+            record.boundsMin[c] = mesh.bounds.min[c];
+            record.boundsMax[c] = mesh.bounds.max[c];
+            record.sphereCenter[c] = mesh.bounds.center[c];
+        }
+        record.sphereRadius = mesh.bounds.radius;
+
+        record.node = mesh.node;
+
+        // meshes that skipped LOD generation still get their one full level.
+        if(mesh.lods.empty())
+        {
+            record.lodCount = 1;
+            record.lods[0] = { 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f, 0, 0 };
+        }
+        else
+        {
+            record.lodCount = static_cast<uint32_t>(std::min(mesh.lods.size(), MAX_MESH_LODS));
+            std::copy_n(mesh.lods.begin(), record.lodCount, record.lods);
+        }
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceHash = sourceHash;
+    header.importFlags = importFlags;
+    header.vertexSize = sizeof(Vertex);
+    header.meshCount = meshes.size();
+    header.nodeCount = nodeRecords.size();
+    header.fileSize = offset;
+
+    // unique per writer, two loaders importing the same model at once would write into one file otherwise.
+    const std::string tmpPath = cachePath + "." + std::to_string(getpid()) + "."
+        + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if(not file)
+        {
+            dbgE << "Cannot write mesh cache: " << tmpPath << NEWL;
+            return false;
+        }
+
+        auto padTo = [&file](size_t target)
+        {
+            static const char zeros[STREAM_ALIGNMENT] = {};
+            file.write(zeros, target - static_cast<size_t>(file.tellp()));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MeshRecord));
+        file.write(reinterpret_cast<const char*>(nodeRecords.data()), nodeRecords.size() * sizeof(NodeRecord));
+        file.write(strings.data(), strings.size());
+
+        for(size_t i = 0; i < meshes.size(); ++i)
+        {
+            padTo(records[i].vertexOffset);
+            file.write(reinterpret_cast<const char*>(meshes[i].vertices.data()), meshes[i].vertices.size() * sizeof(Vertex));
+            padTo(records[i].indexOffset);
+            file.write(reinterpret_cast<const char*>(meshes[i].indices.data()), meshes[i].indices.size() * sizeof(uint32_t));
+            padTo(records[i].meshletOffset);
+            file.write(reinterpret_cast<const char*>(meshes[i].meshlets.data()), meshes[i].meshlets.size() * sizeof(Meshlet));
+        }
+
+        if(not file)
+        {
+            dbgE << "Writing mesh cache failed: " << tmpPath << NEWL;
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    if(std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    dbgI << "Mesh cache written: " << cachePath << " (" << offset << " bytes)" << NEWL;
+    return true;
+}
+
+} // namespace render
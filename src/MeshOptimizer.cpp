@@ -0,0 +1,333 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace render {
+
+namespace {
+
+constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+// vertex -> triangles using it, CSR style so it is two allocations and not one per vertex.
+struct TriangleAdjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> liveCount; // not yet emitted triangles per vertex.
+};
+
+TriangleAdjacency buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    TriangleAdjacency adj;
+    adj.offsets.assign(vertexCount + 1, 0);
+    adj.liveCount.assign(vertexCount, 0);
+
+    for(uint32_t v : indices)
+    {
+        adj.liveCount[v]++;
+    }
+
+    for(size_t v = 0; v < vertexCount; ++v)
+    {
+        adj.offsets[v + 1] = adj.offsets[v] + adj.liveCount[v];
+    }
+
+    adj.triangles.resize(indices.size());
+    std::vector<uint32_t> fill(adj.offsets.begin(), adj.offsets.end() - 1);
+    for(size_t i = 0; i < indices.size(); ++i)
+    {
+        adj.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    return adj;
+}
+
+// Tipsify dead end handling: most recently touched vertex that still has triangles,
+// or failing that, next one in index order.
+uint32_t skipDeadEnd(const std::vector<uint32_t>& liveCount, std::vector<uint32_t>& deadEnd, size_t& cursor)
+{
+    while(not deadEnd.empty())
+    {
+        const uint32_t v = deadEnd.back();
+        deadEnd.pop_back();
+        if(liveCount[v] > 0)
+        {
+            return v;
+        }
+    }
+
+    for(; cursor < liveCount.size(); ++cursor)
+    {
+        if(liveCount[cursor] > 0)
+        {
+            return static_cast<uint32_t>(cursor++);
+        }
+    }
+
+    return NO_VERTEX;
+}
+
+glm::vec3 triangleCross(const std::vector<Vertex>& vertices, const uint32_t* tri)
+{
+    const glm::vec3& a = vertices[tri[0]].pos;
+    return glm::cross(vertices[tri[1]].pos - a, vertices[tri[2]].pos - a);
+}
+
+glm::vec3 triangleCentroid(const std::vector<Vertex>& vertices, const uint32_t* tri)
+{
+    return (vertices[tri[0]].pos + vertices[tri[1]].pos + vertices[tri[2]].pos) / 3.0f;
+}
+
+} // anonymous namespace
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+{
+    if(indexCount == 0)
+    {
+        return {};
+    }
+
+    // FIFO: a vertex falls out after cacheSize further misses.
+    std::vector<size_t> insertedAt(vertexCount, std::numeric_limits<size_t>::max());
+    size_t misses = 0;
+    size_t referenced = 0;
+
+    for(size_t i = 0; i < indexCount; ++i)
+    {
+        const uint32_t v = indices[i];
+        if(insertedAt[v] == std::numeric_limits<size_t>::max())
+        {
+            referenced++;
+        }
+        else if(misses - insertedAt[v] < cacheSize)
+        {
+            continue;
+        }
+
+        insertedAt[v] = misses++;
+    }
+
+    return { float(misses) / float(indexCount / 3), float(misses) / float(referenced) };
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize)
+{
+    assert(indices.size() % 3 == 0);
+    if(indices.empty())
+    {
+        return;
+    }
+
+    auto adj = buildAdjacency(indices, vertexCount);
+    auto& liveCount = adj.liveCount;
+
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    std::vector<bool> emitted(indices.size() / 3, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+
+    // timestamps as in the paper, starting past cacheSize so everything counts as not cached.
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    uint32_t fanning = skipDeadEnd(liveCount, deadEnd, cursor);
+    while(fanning != NO_VERTEX)
+    {
+        candidates.clear();
+
+        for(uint32_t k = adj.offsets[fanning]; k < adj.offsets[fanning + 1]; ++k)
+        {
+            const uint32_t tri = adj.triangles[k];
+            if(emitted[tri])
+            {
+                continue;
+            }
+            emitted[tri] = true;
+
+            for(size_t c = 0; c < 3; ++c)
+            {
+                const uint32_t v = indices[tri * 3 + c];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+
+                if(time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // next fanning vertex: one that will still be in cache after its remaining triangles
+        // are emitted, oldest first. Dead end otherwise.
+        uint32_t next = NO_VERTEX;
+        int64_t best = -1;
+        for(uint32_t v : candidates)
+        {
+            if(liveCount[v] == 0)
+            {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if(time - cacheTime[v] + 2 * liveCount[v] <= cacheSize)
+            {
+                priority = int64_t(time - cacheTime[v]);
+            }
+
+            if(priority > best)
+            {
+                best = priority;
+                next = v;
+            }
+        }
+
+        fanning = next != NO_VERTEX ? next : skipDeadEnd(liveCount, deadEnd, cursor);
+    }
+
+    assert(out.size() == indices.size());
+    indices.swap(out);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, size_t cacheSize)
+{
+    const size_t triCount = indices.size() / 3;
+    if(triCount < 2)
+    {
+        return;
+    }
+
+    // Cluster boundaries go where a triangle misses on all three vertices, moving clusters
+    // around cannot make those any worse, so cache efficiency stays what Tipsify got.
+    std::vector<size_t> clusterStarts;
+    {
+        std::vector<size_t> insertedAt(vertices.size(), std::numeric_limits<size_t>::max());
+        size_t misses = 0;
+
+        for(size_t t = 0; t < triCount; ++t)
+        {
+            size_t triMisses = 0;
+            for(size_t c = 0; c < 3; ++c)
+            {
+                const uint32_t v = indices[t * 3 + c];
+                if(insertedAt[v] == std::numeric_limits<size_t>::max() or misses - insertedAt[v] >= cacheSize)
+                {
+                    insertedAt[v] = misses++;
+                    triMisses++;
+                }
+            }
+
+            if(t == 0 or triMisses == 3)
+            {
+                clusterStarts.push_back(t);
+            }
+        }
+    }
+
+    if(clusterStarts.size() < 2)
+    {
+        return;
+    }
+    clusterStarts.push_back(triCount);
+
+    // area weighted centroid of the whole mesh and of each cluster.
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    for(size_t t = 0; t < triCount; ++t)
+    {
+        const float area = glm::length(triangleCross(vertices, &indices[t * 3]));
+        meshCenter += triangleCentroid(vertices, &indices[t * 3]) * area;
+        meshArea += area;
+    }
+
+    if(meshArea <= 0.0f)
+    {
+        return;
+    }
+    meshCenter /= meshArea;
+
+    // clusters facing away from the center get drawn first, they tend to occlude the rest.
+    const size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<float> sortKey(clusterCount, 0.0f);
+    for(size_t c = 0; c < clusterCount; ++c)
+    {
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+
+        for(size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            const glm::vec3 cross = triangleCross(vertices, &indices[t * 3]);
+            const float triArea = glm::length(cross);
+            center += triangleCentroid(vertices, &indices[t * 3]) * triArea;
+            normal += cross;
+            area += triArea;
+        }
+
+        const float normalLength = glm::length(normal);
+        if(area > 0.0f and normalLength > 0.0f)
+        {
+            sortKey[c] = glm::dot(center / area - meshCenter, normal / normalLength);
+        }
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for(uint32_t c = 0; c < clusterCount; ++c)
+    {
+        order[c] = c;
+    }
+
+    // stable, so equal keys keep their Tipsify order and the result stays deterministic.
+    std::stable_sort(order.begin(), order.end(), [&sortKey](uint32_t a, uint32_t b) {
+        return sortKey[a] > sortKey[b];
+    });
+
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    for(uint32_t c : order)
+    {
+        out.insert(out.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+
+    indices.swap(out);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+    std::vector<Vertex> out;
+    out.reserve(vertices.size());
+
+    for(auto& idx : indices)
+    {
+        if(remap[idx] == NO_VERTEX)
+        {
+            remap[idx] = static_cast<uint32_t>(out.size());
+            out.push_back(vertices[idx]);
+        }
+
+        idx = remap[idx];
+    }
+
+    vertices.swap(out);
+}
+
+MeshOptimizeStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    MeshOptimizeStats stats;
+    stats.before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, vertices);
+    optimizeVertexFetch(vertices, indices);
+
+    stats.after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    return stats;
+}
+
+} // namespace render
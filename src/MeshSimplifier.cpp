@@ -0,0 +1,293 @@
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace render {
+
+namespace {
+
+// symmetric 4x4, plus the weight it was built with so error can be normalized back to a distance.
+struct Quadric
+{
+    double a00 {}, a01 {}, a02 {}, a11 {}, a12 {}, a22 {};
+    double b0 {}, b1 {}, b2 {};
+    double c {};
+    double w {};
+
+    static Quadric fromPlane(glm::dvec3 n, double d, double weight)
+    {
+        Quadric q;
+        q.a00 = n.x * n.x * weight; q.a01 = n.x * n.y * weight; q.a02 = n.x * n.z * weight;
+        q.a11 = n.y * n.y * weight; q.a12 = n.y * n.z * weight; q.a22 = n.z * n.z * weight;
+        q.b0 = n.x * d * weight; q.b1 = n.y * d * weight; q.b2 = n.z * d * weight;
+        q.c = d * d * weight;
+        q.w = weight;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o)
+    {
+        a00 += o.a00; a01 += o.a01; a02 += o.a02;
+        a11 += o.a11; a12 += o.a12; a22 += o.a22;
+        b0 += o.b0; b1 += o.b1; b2 += o.b2;
+        c += o.c;
+        w += o.w;
+        return *this;
+    }
+
+    // RMS distance of p to the accumulated planes.
+    double error(glm::dvec3 p) const
+    {
+        const double sq = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+            + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+            + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z)
+            + c;
+
+        return w > 0.0 ? std::sqrt(std::max(sq, 0.0) / w) : 0.0;
+    }
+};
+
+struct Collapse
+{
+    double error;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    // min heap, ties broken by indices so the result does not depend on heap internals.
+    bool operator>(const Collapse& o) const
+    {
+        if(error != o.error)
+            return error > o.error;
+        if(from != o.from)
+            return from > o.from;
+        return to > o.to;
+    }
+};
+
+glm::dvec3 position(const std::vector<Vertex>& vertices, uint32_t v)
+{
+    return glm::dvec3(vertices[v].pos);
+}
+
+glm::dvec3 triangleCross(const std::vector<Vertex>& vertices, uint32_t a, uint32_t b, uint32_t c)
+{
+    const glm::dvec3 pa = position(vertices, a);
+    return glm::cross(position(vertices, b) - pa, position(vertices, c) - pa);
+}
+
+uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+} // anonymous namespace
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                   size_t targetIndexCount, float maxError, float& resultError)
+{
+    resultError = 0.0f;
+
+    const size_t triCount = indices.size() / 3;
+    std::vector<uint32_t> tris(indices.begin(), indices.begin() + triCount * 3);
+    std::vector<bool> dead(triCount, false);
+
+    std::vector<Quadric> quadrics(vertices.size());
+    std::vector<std::vector<uint32_t>> vertexTris(vertices.size());
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    edgeUse.reserve(indices.size());
+
+    for(uint32_t t = 0; t < triCount; ++t)
+    {
+        const uint32_t* tri = &tris[t * 3];
+        const glm::dvec3 cross = triangleCross(vertices, tri[0], tri[1], tri[2]);
+        const double len = glm::length(cross);
+
+        if(len > 0.0)
+        {
+            const glm::dvec3 n = cross / len;
+            const Quadric q = Quadric::fromPlane(n, -glm::dot(n, position(vertices, tri[0])), len * 0.5);
+            for(int c = 0; c < 3; ++c)
+                quadrics[tri[c]] += q;
+        }
+
+        for(int c = 0; c < 3; ++c)
+        {
+            vertexTris[tri[c]].push_back(t);
+            edgeUse[edgeKey(tri[c], tri[(c + 1) % 3])]++;
+        }
+    }
+
+    // anything not shared by exactly two triangles is a border, seam or non-manifold mess. Leave it be.
+    std::vector<bool> locked(vertices.size(), false);
+    for(uint32_t t = 0; t < triCount; ++t)
+    {
+        for(int c = 0; c < 3; ++c)
+        {
+            const uint32_t a = tris[t * 3 + c];
+            const uint32_t b = tris[t * 3 + (c + 1) % 3];
+            if(edgeUse[edgeKey(a, b)] != 2)
+            {
+                locked[a] = locked[b] = true;
+            }
+        }
+    }
+
+    std::vector<uint32_t> remap(vertices.size());
+    for(uint32_t v = 0; v < remap.size(); ++v)
+        remap[v] = v;
+    std::vector<uint32_t> version(vertices.size(), 0);
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    auto pushCollapse = [&](uint32_t from, uint32_t to)
+    {
+        if(locked[from] or from == to)
+            return;
+
+        Quadric q = quadrics[from];
+        q += quadrics[to];
+        heap.push({ q.error(position(vertices, to)), from, to, version[from], version[to] });
+    };
+
+    for(uint32_t t = 0; t < triCount; ++t)
+    {
+        for(int c = 0; c < 3; ++c)
+        {
+            pushCollapse(tris[t * 3 + c], tris[t * 3 + (c + 1) % 3]);
+            pushCollapse(tris[t * 3 + (c + 1) % 3], tris[t * 3 + c]);
+        }
+    }
+
+    // a collapse must not flip or squash any triangle that survives it.
+    auto collapseValid = [&](uint32_t from, uint32_t to)
+    {
+        for(uint32_t t : vertexTris[from])
+        {
+            if(dead[t])
+                continue;
+
+            uint32_t* tri = &tris[t * 3];
+            if(tri[0] == to or tri[1] == to or tri[2] == to)
+                continue;
+
+            uint32_t moved[3] = { tri[0], tri[1], tri[2] };
+            std::replace(moved, moved + 3, from, to);
+
+            const glm::dvec3 before = triangleCross(vertices, tri[0], tri[1], tri[2]);
+            const glm::dvec3 after = triangleCross(vertices, moved[0], moved[1], moved[2]);
+            if(glm::dot(before, after) <= 0.0)
+                return false;
+        }
+
+        return true;
+    };
+
+    size_t liveIndexCount = triCount * 3;
+    while(liveIndexCount > targetIndexCount and not heap.empty())
+    {
+        const Collapse collapse = heap.top();
+        heap.pop();
+
+        const uint32_t from = collapse.from;
+        const uint32_t to = collapse.to;
+
+        // stale entries are just skipped, fresh ones got pushed when things changed.
+        if(remap[from] != from or remap[to] != to
+            or version[from] != collapse.fromVersion or version[to] != collapse.toVersion)
+            continue;
+
+        if(collapse.error > maxError)
+            break;
+
+        if(not collapseValid(from, to))
+            continue;
+
+        for(uint32_t t : vertexTris[from])
+        {
+            if(dead[t])
+                continue;
+
+            uint32_t* tri = &tris[t * 3];
+            if(tri[0] == to or tri[1] == to or tri[2] == to)
+            {
+                dead[t] = true;
+                liveIndexCount -= 3;
+                continue;
+            }
+
+            std::replace(tri, tri + 3, from, to);
+            vertexTris[to].push_back(t);
+        }
+
+        quadrics[to] += quadrics[from];
+        remap[from] = to;
+        version[to]++;
+        resultError = std::max(resultError, float(collapse.error));
+
+        for(uint32_t t : vertexTris[to])
+        {
+            if(dead[t])
+                continue;
+
+            for(int c = 0; c < 3; ++c)
+            {
+                const uint32_t n = tris[t * 3 + c];
+                if(n != to)
+                {
+                    pushCollapse(n, to);
+                    pushCollapse(to, n);
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> out;
+    out.reserve(liveIndexCount);
+    for(uint32_t t = 0; t < triCount; ++t)
+    {
+        if(not dead[t])
+            out.insert(out.end(), &tris[t * 3], &tris[t * 3] + 3);
+    }
+
+    return out;
+}
+
+void buildLodChain(MeshImportData& mesh, const LodSettings& settings)
+{
+    const auto baseCount = static_cast<uint32_t>(mesh.indices.size());
+    mesh.lods = { MeshLod{ 0, baseCount, 0.0f, 0, 0 } };
+
+    const float diagonal = glm::length(mesh.bounds.max - mesh.bounds.min);
+    std::vector<uint32_t> previous(mesh.indices.begin(), mesh.indices.end());
+
+    for(float target : settings.errorTargets)
+    {
+        if(mesh.lods.size() == MAX_MESH_LODS)
+            break;
+
+        // every level starts from full resolution, errors do not stack up that way.
+        const size_t targetCount = size_t(float(previous.size() / 3) * settings.reduction) * 3;
+        float error = 0.0f;
+        auto lod = simplifyMesh(mesh.vertices, std::vector<uint32_t>(mesh.indices.begin(), mesh.indices.begin() + baseCount),
+                                targetCount, target * diagonal, error);
+
+        // less than 10% off the previous level is not worth a level of its own.
+        if(lod.empty() or lod.size() * 10 > previous.size() * 9)
+            break;
+
+        optimizeVertexCache(lod, mesh.vertices.size());
+
+        const float prevError = mesh.lods.back().error;
+        mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lod.size()),
+                              std::max(error, prevError), 0, 0 });
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        previous = std::move(lod);
+    }
+}
+
+} // namespace render
@@ -0,0 +1,150 @@
+#include "MeshletBuilder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace render {
+
+namespace {
+
+// which way is out. Cull mode only cares about winding, but the model shows up right with it,
+// so whichever winding agrees with the authored normals is the one the rasterizer keeps.
+float frontFaceSign(const MeshImportData& mesh, uint32_t indexCount)
+{
+    float agreement = 0.0f;
+    for(uint32_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const Vertex& a = mesh.vertices[mesh.indices[i]];
+        const Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+        const Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+        const glm::vec3 cross = glm::cross(b.pos - a.pos, c.pos - a.pos);
+        agreement += glm::dot(cross, a.surf_normals + b.surf_normals + c.surf_normals);
+    }
+
+    // no normals to go by, counter clockwise it is.
+    return agreement < 0.0f ? -1.0f : 1.0f;
+}
+
+Meshlet finishMeshlet(const MeshImportData& mesh, uint32_t indexOffset, uint32_t indexCount, float sign)
+{
+    Meshlet m{};
+    m.indexOffset = indexOffset;
+    m.indexCount = indexCount;
+
+    // sphere around the box, not minimal, but close enough for a few dozen vertices.
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for(uint32_t i = indexOffset; i < indexOffset + indexCount; ++i)
+    {
+        min = glm::min(min, mesh.vertices[mesh.indices[i]].pos);
+        max = glm::max(max, mesh.vertices[mesh.indices[i]].pos);
+    }
+
+    m.center = (min + max) * 0.5f;
+    float radiusSq = 0.0f;
+    for(uint32_t i = indexOffset; i < indexOffset + indexCount; ++i)
+    {
+        const glm::vec3 d = mesh.vertices[mesh.indices[i]].pos - m.center;
+        radiusSq = std::max(radiusSq, glm::dot(d, d));
+    }
+    m.radius = std::sqrt(radiusSq);
+
+    // cone around the average face normal, wide as the most diverging triangle.
+    glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+    size_t normalCount = 0;
+    glm::vec3 axis(0.0f);
+    for(uint32_t i = indexOffset; i < indexOffset + indexCount; i += 3)
+    {
+        const glm::vec3& a = mesh.vertices[mesh.indices[i]].pos;
+        const glm::vec3 cross = glm::cross(mesh.vertices[mesh.indices[i + 1]].pos - a,
+                                           mesh.vertices[mesh.indices[i + 2]].pos - a) * sign;
+        const float len = glm::length(cross);
+        if(len > 0.0f)
+        {
+            normals[normalCount] = cross / len;
+            axis += normals[normalCount++];
+        }
+    }
+
+    m.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    m.coneCutoff = 1.0f;
+
+    const float axisLength = glm::length(axis);
+    if(normalCount == 0 or axisLength == 0.0f)
+        return m;
+
+    m.coneAxis = axis / axisLength;
+    float minDot = 1.0f;
+    for(size_t n = 0; n < normalCount; ++n)
+    {
+        minDot = std::min(minDot, glm::dot(normals[n], m.coneAxis));
+    }
+
+    // anything wider than a hemisphere can never be back facing as a whole.
+    if(minDot > 0.0f)
+    {
+        m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+    return m;
+}
+
+} // anonymous namespace
+
+void buildMeshlets(MeshImportData& mesh)
+{
+    mesh.meshlets.clear();
+    if(mesh.lods.empty() or mesh.indices.empty())
+        return;
+
+    const float sign = frontFaceSign(mesh, mesh.lods[0].indexCount);
+
+    // vertex -> last meshlet that used it, so unique vertex counting needs no clearing.
+    std::vector<uint32_t> seenIn(mesh.vertices.size(), std::numeric_limits<uint32_t>::max());
+
+    for(auto& lod : mesh.lods)
+    {
+        lod.meshletOffset = static_cast<uint32_t>(mesh.meshlets.size());
+
+        uint32_t start = lod.indexOffset;
+        uint32_t vertexCount = 0;
+        uint32_t current = static_cast<uint32_t>(mesh.meshlets.size());
+        const uint32_t end = lod.indexOffset + lod.indexCount;
+
+        for(uint32_t i = lod.indexOffset; i + 2 < end; i += 3)
+        {
+            uint32_t newVertices = 0;
+            for(int c = 0; c < 3; ++c)
+            {
+                newVertices += seenIn[mesh.indices[i + c]] != current;
+            }
+
+            const bool full = vertexCount + newVertices > MESHLET_MAX_VERTICES
+                or (i - start) / 3 >= MESHLET_MAX_TRIANGLES;
+            if(full)
+            {
+                mesh.meshlets.push_back(finishMeshlet(mesh, start, i - start, sign));
+                start = i;
+                vertexCount = 0;
+                current = static_cast<uint32_t>(mesh.meshlets.size());
+                newVertices = 3;
+            }
+
+            for(int c = 0; c < 3; ++c)
+            {
+                seenIn[mesh.indices[i + c]] = current;
+            }
+            vertexCount += newVertices;
+        }
+
+        if(end > start)
+        {
+            mesh.meshlets.push_back(finishMeshlet(mesh, start, end - start, sign));
+        }
+
+        lod.meshletCount = static_cast<uint32_t>(mesh.meshlets.size()) - lod.meshletOffset;
+    }
+}
+
+} // namespace render
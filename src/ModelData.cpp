@@ -0,0 +1,170 @@
+#include "ModelData.hpp"
+#include "UploadBatch.hpp"
+
+#include <cassert>
+#include <unordered_map>
+
+namespace render {
+
+namespace {
+
+// positions and indices of the source's finest LOD that is cheap enough, only the vertices it uses.
+// Coarser ones would occlude more than the mesh does, the finest one keeps the error as small as it gets.
+OccluderMesh makeOccluder(const MeshSource& source)
+{
+    // without LODs the full mesh is the only one there is.
+    const MeshLod full = { 0, static_cast<uint32_t>(source.indexCount), 0.0f, 0, 0 };
+    const MeshLod* finest = source.lods.empty() ? &full : nullptr;
+    for(const auto& lod : source.lods)
+    {
+        if(lod.indexCount / 3 <= MAX_OCCLUDER_TRIANGLES)
+        {
+            finest = &lod;
+            break;
+        }
+    }
+    if(not finest or finest->indexCount == 0 or finest->indexCount / 3 > MAX_OCCLUDER_TRIANGLES)
+        return {};
+
+    const VertexQuantization quantization {
+        { source.data.pos_scale[0], source.data.pos_scale[1], source.data.pos_scale[2] },
+        { source.data.pos_bias[0], source.data.pos_bias[1], source.data.pos_bias[2] },
+    };
+
+    OccluderMesh occluder;
+    occluder.error = finest->error;
+    occluder.indices.reserve(finest->indexCount);
+    std::unordered_map<uint32_t, uint32_t> remap;
+    for(uint32_t i = finest->indexOffset; i < finest->indexOffset + finest->indexCount; ++i)
+    {
+        const uint32_t index = source.indices[i];
+        auto [it, added] = remap.try_emplace(index, static_cast<uint32_t>(occluder.positions.size()));
+        if(added)
+        {
+            occluder.positions.push_back(source.isCompact()
+                ? decodeVertex(source.compactVertices[index], quantization).pos
+                : source.vertices[index].pos);
+        }
+        occluder.indices.push_back(it->second);
+    }
+
+    return occluder;
+}
+
+} // anonymous namespace
+
+ModelData::ModelData(std::shared_ptr<VulkanDevice> device, std::vector<MeshSource> sources, SceneHierarchy hierarchy)
+    : hierarchy(std::move(hierarchy))
+{
+    this->hierarchy.updateWorldTransforms();
+
+    size_t indexCount = 0;
+    size_t vertexCount = 0;
+    size_t compactCount = 0;
+    for(const auto& source : sources)
+    {
+        indexCount += source.indexCount;
+        if(source.isCompact())
+            compactCount += source.compactVertices.size();
+        else
+            vertexCount += source.vertexCount;
+    }
+
+    // empty buffers are not a thing, a model without any of one kind just does not get it.
+    if(indexCount > 0)
+    {
+        index_buffer = memory::VmaVulkanBuffer(device, indexCount * sizeof(uint32_t),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+    if(vertexCount > 0)
+    {
+        vertex_buffer = memory::VmaVulkanBuffer(device, vertexCount * sizeof(Vertex),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+    if(compactCount > 0)
+    {
+        compact_vertex_buffer = memory::VmaVulkanBuffer(device, compactCount * sizeof(CompactVertex),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+    if(not sources.empty())
+    {
+        draw_data_buffer = memory::VmaVulkanBuffer(device, sources.size() * sizeof(MeshDrawData),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        cull_data_buffer = memory::VmaVulkanBuffer(device, sources.size() * sizeof(MeshCullData),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+
+    // all of it goes up in one staging buffer and one submit.
+    memory::UploadBatch uploads(device);
+    std::vector<MeshDrawData> drawData;
+    drawData.reserve(sources.size());
+    std::vector<MeshCullData> cullData;
+    cullData.reserve(sources.size());
+    meshes.reserve(sources.size());
+    meshNodes.reserve(sources.size());
+
+    uint32_t firstIndex = 0;
+    int32_t firstVertex = 0;
+    int32_t firstCompactVertex = 0;
+    for(auto& source : sources)
+    {
+        assert(source.node < this->hierarchy.size());
+
+        const bool compact = source.isCompact();
+        // before the vertices move into the upload.
+        OccluderMesh occluder = makeOccluder(source);
+        const MeshBufferRange range = {
+            .vertexOffset = compact ? firstCompactVertex : firstVertex,
+            .firstIndex = firstIndex,
+            .indexCount = static_cast<uint32_t>(source.indexCount),
+        };
+
+        uploads.add(source.indices, source.indexCount * sizeof(uint32_t), index_buffer.getVkBuffer(),
+                    firstIndex * sizeof(uint32_t));
+        firstIndex += source.indexCount;
+
+        if(compact)
+        {
+            const auto count = source.compactVertices.size();
+            uploads.add(std::move(source.compactVertices), compact_vertex_buffer.getVkBuffer(),
+                        firstCompactVertex * sizeof(CompactVertex));
+            firstCompactVertex += count;
+        }
+        else
+        {
+            uploads.add(source.vertices, source.vertexCount * sizeof(Vertex), vertex_buffer.getVkBuffer(),
+                        firstVertex * sizeof(Vertex));
+            firstVertex += source.vertexCount;
+        }
+
+        source.data.node = source.node;
+        drawData.push_back(source.data);
+
+        Mesh mesh{source.data, std::move(source.textures), range, compact};
+        mesh.setLods(std::move(source.lods), std::move(source.meshlets), source.bounds);
+        mesh.setOccluder(std::move(occluder));
+        max_draws += mesh.maxDraws();
+        full_mesh_count += compact ? 0 : 1;
+        cullData.push_back(mesh.getCullData());
+        meshes.push_back(std::move(mesh));
+        meshNodes.push_back(source.node);
+    }
+
+    if(not drawData.empty())
+    {
+        uploads.add(std::move(drawData), draw_data_buffer.getVkBuffer());
+        uploads.add(std::move(cullData), cull_data_buffer.getVkBuffer());
+    }
+    uploads.submit();
+}
+
+ModelData::~ModelData()
+{
+    index_buffer.destroy();
+    vertex_buffer.destroy();
+    compact_vertex_buffer.destroy();
+    draw_data_buffer.destroy();
+    cull_data_buffer.destroy();
+}
+
+} // namespace render
@@ -0,0 +1,161 @@
+#include "ObjectDescriptorSets.hpp"
+#include "EDescriptorSets.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace render {
+
+ObjectDescriptorSets::ObjectDescriptorSets(
+        std::shared_ptr<VulkanDevice> deviceptr,
+        Pipeline& pipeline,
+        const ModelData& model)
+    : device(std::move(deviceptr))
+    , uniforms(std::make_unique<memory::UniformData<RenderableUbo, consts::maxFramesInFlight>>(device))
+    , nodeTransforms(std::max<size_t>(model.getHierarchy().size(), 1), glm::mat4(1.0f))
+{
+    nodeBuffers.reserve(consts::maxFramesInFlight);
+    for(uint32_t i = 0; i < consts::maxFramesInFlight; ++i)
+    {
+        nodeBuffers.emplace_back(device, nodeTransforms.size() * sizeof(glm::mat4),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        nodeBuffers.back().map();
+    }
+
+    createDescriptorPool();
+    generateDescriptorSets(pipeline, model);
+}
+
+ObjectDescriptorSets::~ObjectDescriptorSets()
+{
+    uniforms->destroy();
+    for(auto& buffer : nodeBuffers)
+        buffer.destroy();
+    vkDestroyDescriptorPool(device->getDevice(), descriptorPool, nullptr);
+}
+
+void ObjectDescriptorSets::createDescriptorPool()
+{
+    const VkDescriptorPoolSize poolSizes[] = {
+        {
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = consts::maxFramesInFlight,
+        },
+        {
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = consts::maxFramesInFlight * 2, // nodes and draw data
+        },
+    };
+
+    const VkDescriptorPoolCreateInfo ci = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = consts::maxFramesInFlight,
+        .poolSizeCount = 2,
+        .pPoolSizes = poolSizes
+    };
+
+    VK_CHECK(vkCreateDescriptorPool(device->getDevice(), &ci, nullptr, &descriptorPool));
+}
+
+void ObjectDescriptorSets::generateDescriptorSets(Pipeline& pipeline, const ModelData& model)
+{
+    // SPIR-V built before the node and draw buffers were added reflects a set without them,
+    // writing to those bindings would only show up as validation errors or garbage.
+    const uint32_t set = EDescriptorSets::BindFrequency_Object;
+    if(not pipeline.hasBinding(set, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+        or not pipeline.hasBinding(set, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        or not pipeline.hasBinding(set, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER))
+    {
+        throw std::runtime_error("Per object set of the vertex shader is missing its buffers, stale SPIR-V? Run make shaders.");
+    }
+
+    auto setLayout = pipeline.getDescriptorSetLayout(EDescriptorSets::BindFrequency_Object);
+    std::vector<VkDescriptorSetLayout> setLayouts(consts::maxFramesInFlight, setLayout);
+
+    VkDescriptorSetAllocateInfo ai = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = descriptorPool,
+        .descriptorSetCount = consts::maxFramesInFlight,
+        .pSetLayouts = setLayouts.data()
+    };
+
+    descriptorSets.resize(consts::maxFramesInFlight);
+
+    VK_CHECK(vkAllocateDescriptorSets(device->getDevice(), &ai, descriptorSets.data()));
+
+    auto uboBufferInfos = uniforms->getDescriptorBufferInfos();
+    // we now need to fill our descriptor sets with proper buffers.
+    assert(uboBufferInfos.size() == descriptorSets.size());
+
+    // the model's draw data is the same for every frame, it never changes.
+    const VkDescriptorBufferInfo drawDataInfo = {
+        .buffer = model.getDrawDataBuffer().getVkBuffer(),
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+
+    for (size_t i = 0; i < descriptorSets.size(); ++i) {
+        const VkDescriptorBufferInfo nodesInfo = {
+            .buffer = nodeBuffers[i].getVkBuffer(),
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        const VkWriteDescriptorSet wds[] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSets[i],
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                .pBufferInfo = &uboBufferInfos[i]
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSets[i],
+                .dstBinding = 1,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &nodesInfo
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSets[i],
+                .dstBinding = 2,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &drawDataInfo
+            },
+        };
+
+        // a model without meshes has no draw data buffer, nothing reads it then either.
+        const uint32_t writes = drawDataInfo.buffer != VK_NULL_HANDLE ? 3 : 2;
+        vkUpdateDescriptorSets(device->getDevice(), writes, wds, 0, nullptr);
+    }
+}
+
+void ObjectDescriptorSets::update(RenderableUbo ubo, const SceneHierarchy& hierarchy, size_t frameIndex)
+{
+    assert(frameIndex < descriptorSets.size());
+
+    for(uint32_t node = 0; node < hierarchy.size(); ++node)
+    {
+        nodeTransforms[node] = hierarchy.world(node);
+    }
+    nodeBuffers[frameIndex].copyToBuffer(nodeTransforms.data(), nodeTransforms.size() * sizeof(glm::mat4));
+
+    auto& uniformData = *uniforms;
+    uniformData[frameIndex] = std::move(ubo);
+    uniformData.update(frameIndex);
+}
+
+void ObjectDescriptorSets::bind(CommandStateCache& state, VkPipelineLayout layout, uint32_t frameIndex) const
+{
+    assert(frameIndex < descriptorSets.size());
+
+    state.bindDescriptorSet(layout, EDescriptorSets::BindFrequency_Object, descriptorSets[frameIndex]);
+}
+
+} // namespace render
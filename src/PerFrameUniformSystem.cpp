@@ -83,34 +83,41 @@ void PerFrameUniformSystem::fillUboDescriptor()
 
 void PerFrameUniformSystem::fillDescriptorSets()
 {
-    for(auto set : descriptorSets)
+    for(size_t i = 0; i < descriptorSets.size(); ++i)
     {
-        texture_mgr->fillDescriptorSet(set);
+        filledVersions[i] = texture_mgr->descriptorVersion();
+        texture_mgr->fillDescriptorSet(descriptorSets[i]);
     };
 }
 
-void PerFrameUniformSystem::refreshData(uint32_t setIdx)
+bool PerFrameUniformSystem::refreshData(uint32_t setIdx)
 {
     assert(setIdx < descriptorSets.size() and setIdx < consts::maxFramesInFlight);
 
-    // this is extremely wasteful, do an observer or something later. Yuck.
-    texture_mgr->fillDescriptorSet(descriptorSets[setIdx]);
+    // version first, a change landing while filling just gets picked up next time.
+    const uint64_t version = texture_mgr->descriptorVersion();
+    const bool stale = filledVersions[setIdx] != version;
+    if(stale)
+    {
+        filledVersions[setIdx] = version;
+        texture_mgr->fillDescriptorSet(descriptorSets[setIdx]);
+    }
 
     (*ubo)[setIdx].camera = camera->genCurrentVPMatrices();
     ubo->update(setIdx);
+    return stale;
+}
+
+void PerFrameUniformSystem::bind(CommandStateCache& state, uint32_t setIdx)
+{
+    bind(state, setIdx, *pipeline);
 }
 
-void PerFrameUniformSystem::bind(VkCommandBuffer buf, uint32_t setIdx)
+void PerFrameUniformSystem::bind(CommandStateCache& state, uint32_t setIdx, const Pipeline& drawnWith)
 {
     assert(setIdx < descriptorSets.size());
 
-    vkCmdBindDescriptorSets(
-            buf,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipeline->getLayoutHandle(),
-            EDescriptorSets::BindFrequency_Frame, 1, // one set, the object freq set
-            &descriptorSets[setIdx],
-            0, 0);
+    state.bindDescriptorSet(drawnWith.getLayoutHandle(), EDescriptorSets::BindFrequency_Frame, descriptorSets[setIdx]);
 }
 
 } // namespace render
@@ -16,6 +16,7 @@ Pipeline::~Pipeline()
 Pipeline::Pipeline(Pipeline&& rhs)
     : pipeline(rhs.pipeline)
     , descriptorSetLayouts(std::move(rhs.descriptorSetLayouts))
+    , setLayoutData(std::move(rhs.setLayoutData))
     , pipelineLayout(rhs.pipelineLayout)
     , device(rhs.device)
 {
@@ -28,12 +29,21 @@ Pipeline& Pipeline::operator=(Pipeline&& rhs)
     pipeline = rhs.pipeline;
     pipelineLayout = rhs.pipelineLayout;
     descriptorSetLayouts = std::move(rhs.descriptorSetLayouts);
+    setLayoutData = std::move(rhs.setLayoutData);
 
     rhs.pipeline = VK_NULL_HANDLE;
     rhs.pipelineLayout = VK_NULL_HANDLE;
     return *this;
 }
 
+bool Pipeline::hasBinding(uint32_t set, uint32_t binding, VkDescriptorType type) const
+{
+    return std::any_of(setLayoutData.begin(), setLayoutData.end(), [&](const auto& data) {
+        return data.set_number == set and std::any_of(data.bindings.begin(), data.bindings.end(),
+            [&](const auto& b) { return b.binding == binding and b.descriptorType == type; });
+    });
+}
+
 void Pipeline::createPipelineLayout(const Shader& shader)
 {
     const auto& descriptorSetLayouts = shader.getReflectedDescriptorSetLayouts();
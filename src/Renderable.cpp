@@ -1,97 +1,400 @@
 #include "Renderable.hpp"
-#include "EDescriptorSets.hpp"
+#include <algorithm>
+#include <limits>
 
 
 namespace render {
 Renderable::Renderable(
         std::shared_ptr<VulkanDevice> deviceptr,
         std::shared_ptr<Pipeline> pipeline,
-        std::vector<Mesh> meshes)
+        std::shared_ptr<const ModelData> model,
+        std::shared_ptr<Pipeline> compactPipeline)
     : device(std::move(deviceptr))
-    , meshes(std::move(meshes))
+    , modelData(std::move(model))
+    , hierarchy(modelData->getHierarchy())
+    , meshLods(modelData->getMeshes().size(), 0)
     , pipeline(std::move(pipeline))
-    , uniforms(std::make_unique<memory::UniformData<RenderableUbo, consts::maxFramesInFlight>>(device))
+    , compactPipeline(std::move(compactPipeline))
+    , sets(std::make_unique<ObjectDescriptorSets>(device, *this->pipeline, *modelData))
+    , drawCommands(std::max<size_t>(modelData->maxDraws(), 1))
+    , frameDraws(consts::maxFramesInFlight)
 {
-    createDescriptorPool();
-    generateUboDescriptorSets();
+    assert(this->compactPipeline or not modelData->hasCompactMeshes());
+
+    for(const auto& mesh : modelData->getMeshes())
+    {
+        if(not mesh.isCompact())
+            fullCapacity += mesh.maxDraws();
+    }
+
+    indirectBuffers.reserve(consts::maxFramesInFlight);
+    for(uint32_t i = 0; i < consts::maxFramesInFlight; ++i)
+    {
+        indirectBuffers.emplace_back(device, drawCommands.size() * sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        indirectBuffers.back().map();
+    }
+
+    meshBvh.build(meshBoxes());
+    bvhVersion = hierarchy.version();
+}
+
+Renderable::~Renderable()
+{
+    for(auto& buffer : indirectBuffers)
+        buffer.destroy();
+}
+
+void Renderable::updateUniforms(RenderableUbo ubo, size_t bufferIdx)
+{
+    hierarchy.updateWorldTransforms();
+    updateBvh();
+    model = ubo.model;
+    sets->update(std::move(ubo), hierarchy, bufferIdx);
+}
+
+std::vector<Aabb> Renderable::meshBoxes() const
+{
+    const auto& meshes = modelData->getMeshes();
+    const auto& meshNodes = modelData->getMeshNodes();
+
+    std::vector<Aabb> boxes;
+    boxes.reserve(meshes.size());
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        const auto& bounds = meshes[i].getBounds();
+        boxes.push_back(Aabb{bounds.min, bounds.max}.transformed(hierarchy.world(meshNodes[i])));
+    }
+    return boxes;
+}
+
+void Renderable::updateBvh()
+{
+    if(hierarchy.version() != bvhVersion)
+    {
+        meshBvh.refit(meshBoxes());
+        bvhVersion = hierarchy.version();
+    }
+
+    // refits keep the old shape, parts moving apart make it worse until a new build gets swapped in.
+    meshBvh.poll();
+    if(meshBvh.degradation() > Bvh::REBUILD_DEGRADATION)
+        meshBvh.rebuildAsync();
 }
 
-void Renderable::createDescriptorPool()
+uint32_t Renderable::pickMesh(const Ray& worldRay, float* hitT) const
 {
-    const VkDescriptorPoolSize poolSize = {
-        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount = consts::maxFramesInFlight,
+    // the tree is in model space. Direction goes through the same matrix, so t means the same in both.
+    const glm::mat4 toModel = glm::inverse(model);
+    const Ray ray {
+        glm::vec3(toModel * glm::vec4(worldRay.origin, 1.0f)),
+        glm::vec3(toModel * glm::vec4(worldRay.direction, 0.0f)),
     };
+    return meshBvh.raycast(ray, std::numeric_limits<float>::max(), hitT);
+}
+
+void Renderable::cullMeshes(const glm::mat4& viewProj, SoftwareOcclusion* occlusion)
+{
+    const auto& meshes = modelData->getMeshes();
+    const auto& meshNodes = modelData->getMeshNodes();
 
-    const VkDescriptorPoolCreateInfo ci = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .maxSets = consts::maxFramesInFlight,
-        .poolSizeCount = 1,
-        .pPoolSizes = &poolSize
+    auto worldSphere = [&](size_t i, glm::vec3& center, float& radius) {
+        const glm::mat4 world = model * hierarchy.world(meshNodes[i]);
+        const auto& bounds = meshes[i].getBounds();
+        center = glm::vec3(world * glm::vec4(bounds.center, 1.0f));
+        radius = bounds.radius * maxAxisScale(world);
     };
 
-    VK_CHECK(vkCreateDescriptorPool(device->getDevice(), &ci, nullptr, &descriptorPool));
+    cullStats.objectsTested = static_cast<uint32_t>(meshes.size());
+    if(meshes.size() >= BVH_CULL_THRESHOLD)
+    {
+        // whole subtrees in or out at once, in model space. Spheres are left for the visible ones.
+        bvhHits.clear();
+        meshBvh.queryFrustum(Frustum::fromMatrix(viewProj * model), bvhHits);
+
+        meshVisible.assign(meshes.size(), 0);
+        meshSpheres.resize(meshes.size());
+        for(uint32_t i : bvhHits)
+        {
+            glm::vec3 center;
+            float radius;
+            worldSphere(i, center, radius);
+            meshSpheres.set(i, center, radius);
+            meshVisible[i] = 1;
+        }
+        cullStats.objectsVisible = static_cast<uint32_t>(bvhHits.size());
+    }
+    else
+    {
+        // world space spheres of all meshes against one frustum, rather than a frustum per mesh.
+        meshSpheres.clear();
+        for(size_t i = 0; i < meshes.size(); ++i)
+        {
+            glm::vec3 center;
+            float radius;
+            worldSphere(i, center, radius);
+            meshSpheres.push(center, radius);
+        }
+        cullStats.objectsVisible = cullSpheres(Frustum::fromMatrix(viewProj), meshSpheres, meshVisible);
+    }
+
+    if(not occlusion)
+        return;
+
+    // only what survived the frustum, boxes are tighter than the spheres here.
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        const auto& bounds = meshes[i].getBounds();
+        if(meshVisible[i] and not occlusion->boxVisible(model * hierarchy.world(meshNodes[i]), bounds.min, bounds.max))
+        {
+            meshVisible[i] = 0;
+            cullStats.objectsOccluded++;
+        }
+    }
+    cullStats.objectsVisible -= cullStats.objectsOccluded;
+}
+
+void Renderable::addOccluders(SoftwareOcclusion& occlusion) const
+{
+    const auto& meshes = modelData->getMeshes();
+    const auto& meshNodes = modelData->getMeshNodes();
+
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        if(not meshes[i].getOccluder().empty())
+            occlusion.addOccluder(meshes[i].getOccluder(), model * hierarchy.world(meshNodes[i]));
+    }
 }
 
-void Renderable::generateUboDescriptorSets()
+void Renderable::selectLods(CameraSystem& camera, float viewportHeight)
 {
-    auto setLayout = pipeline->getDescriptorSetLayout(EDescriptorSets::BindFrequency_Object);
-    std::vector<VkDescriptorSetLayout> setLayouts(consts::maxFramesInFlight, setLayout);
+    const auto& meshes = modelData->getMeshes();
+    const auto& meshNodes = modelData->getMeshNodes();
+    const glm::vec3 cameraPos = camera.getPosition();
+
+    const float pixelsPerUnit = Renderable::pixelsPerUnit(camera, viewportHeight);
+    const float lower = lodSelection.thresholdPixels * (1.0f - lodSelection.hysteresis);
+    const float upper = lodSelection.thresholdPixels * (1.0f + lodSelection.hysteresis);
+
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        // culled ones keep whatever level they had.
+        const auto& mesh = meshes[i];
+        if(mesh.lodCount() < 2 or not meshVisible[i])
+            continue;
+
+        // errors are in object space, non-uniform scale just takes the worst axis.
+        const float scale = maxAxisScale(model * hierarchy.world(meshNodes[i]));
+        const glm::vec3 center(meshSpheres.x[i], meshSpheres.y[i], meshSpheres.z[i]);
+        const float distance = std::max(glm::length(center - cameraPos) - meshSpheres.radius[i], 1e-3f);
+
+        auto projectedError = [&](size_t lod) { return mesh.lodError(lod) * scale * pixelsPerUnit / distance; };
+
+        size_t& current = meshLods[i];
+        if(projectedError(current) > upper)
+        {
+            // too coarse, step down to what fits the plain threshold.
+            while(current > 0 and projectedError(current) > lodSelection.thresholdPixels)
+                --current;
+        }
+        else
+        {
+            // errors only grow with level, so walk up while there is comfortable room.
+            while(current + 1 < mesh.lodCount() and projectedError(current + 1) <= lower)
+                ++current;
+        }
+    }
+}
 
-    VkDescriptorSetAllocateInfo ai = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = descriptorPool,
-        .descriptorSetCount = consts::maxFramesInFlight,
-        .pSetLayouts = setLayouts.data()
+float Renderable::pixelsPerUnit(CameraSystem& camera, float viewportHeight)
+{
+    // proj[1][1] is 1 / tan(fov / 2).
+    return std::abs(camera.genCurrentVPMatrices().proj[1][1]) * viewportHeight * 0.5f;
+}
+
+void Renderable::enableGpuCulling(std::shared_ptr<ComputePipeline> cullPipeline, std::shared_ptr<DepthPyramid> depthPyramid)
+{
+    assert(cullPipeline and depthPyramid and not gpuCulling);
+    gpuCulling = std::make_unique<GpuCulling>(device, std::move(cullPipeline), std::move(depthPyramid), *modelData, *sets);
+}
+
+void Renderable::cmdCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, ECullPhase phase,
+                         CameraSystem& camera, float viewportHeight)
+{
+    assert(gpuCulling);
+
+    const auto matrices = camera.genCurrentVPMatrices();
+    // the shader works in model space, node transforms are all it applies.
+    const GpuCullConstants constants {
+        .clip = matrices.proj * matrices.view * model,
+        .cameraPos = glm::vec3(glm::inverse(model) * glm::vec4(camera.getPosition(), 1.0f)),
+        .lodFactor = pixelsPerUnit(camera, viewportHeight) / lodSelection.thresholdPixels,
+        .meshCount = static_cast<uint32_t>(modelData->getMeshes().size()),
+        .compactBase = modelData->fullMeshCount(),
+        .phase = 0,
+        .pyramidLevels = 0,
+        .depthSize = {},
     };
 
-    descriptorSets.resize(consts::maxFramesInFlight);
+    // results never come back to the CPU.
+    cullStats = {};
+    cullStats.objectsTested = constants.meshCount;
+
+    gpuCulling->cmdDispatch(commandBuffer, frameIndex, phase, constants);
+}
 
-    VK_CHECK(vkAllocateDescriptorSets(device->getDevice(), &ai, descriptorSets.data()));
+void Renderable::cmdBindSetsDrawCulled(CommandStateCache& state, uint32_t frameIndex, ECullPhase phase)
+{
+    assert(gpuCulling);
+    if(modelData->getMeshes().empty())
+        return;
 
-    auto uboBufferInfos = uniforms->getDescriptorBufferInfos();
-    // we now need to fill our descriptor sets with proper buffers.
-    assert(uboBufferInfos.size() == descriptorSets.size());
+    const VkDeviceSize zero{0};
+    state.bindPipeline(pipeline->getHandle());
+    sets->bind(state, pipeline->getLayoutHandle(), frameIndex);
+    state.bindIndexBuffer(modelData->getIndexBuffer().getVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-    for (size_t i = 0; i < descriptorSets.size(); ++i) {
-        VkWriteDescriptorSet wds = {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = descriptorSets[i],
-            .dstBinding = 0,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo = &uboBufferInfos[i]
-        };
+    if(modelData->fullMeshCount() > 0)
+    {
+        state.bindVertexBuffers(0, 1, modelData->getVertexBuffer().getpVkBuffer(), &zero);
+        gpuCulling->cmdDraw(state.get(), frameIndex, phase, false);
+    }
 
-        vkUpdateDescriptorSets(device->getDevice(), 1, &wds, 0, nullptr);
+    if(modelData->hasCompactMeshes())
+    {
+        state.bindPipeline(compactPipeline->getHandle());
+        state.bindVertexBuffers(0, 1, modelData->getCompactVertexBuffer().getpVkBuffer(), &zero);
+        gpuCulling->cmdDraw(state.get(), frameIndex, phase, true);
     }
 }
 
-void Renderable::updateUniforms(RenderableUbo ubo, size_t bufferIdx)
+void Renderable::cmdDrawCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t first, uint32_t count)
 {
-    auto& uniformData = *uniforms;
-    uniformData[bufferIdx] = std::move(ubo);
-    uniformData.update(bufferIdx);
+    if(count == 0)
+        return;
+
+    const auto& features = device->getEnabledFeatures();
+    if(features.multiDrawIndirect and features.drawIndirectFirstInstance)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffers[frameIndex].getVkBuffer(),
+            first * sizeof(VkDrawIndexedIndirectCommand), count, sizeof(VkDrawIndexedIndirectCommand));
+        return;
+    }
+
+    // device without it, same commands one by one. firstInstance is fine on direct draws.
+    for(uint32_t i = first; i < first + count; ++i)
+    {
+        const auto& c = drawCommands[i];
+        vkCmdDrawIndexed(commandBuffer, c.indexCount, c.instanceCount, c.firstIndex, c.vertexOffset, c.firstInstance);
+    }
 }
 
-void Renderable::cmdBindSetsDrawMeshes(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+void Renderable::sortVisibleMeshes(glm::vec3 cameraPos)
 {
-    assert(frameIndex < descriptorSets.size());
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getHandle());
+    const auto& meshes = modelData->getMeshes();
+
+    // one renderable is one set and one set of geometry buffers, only pipeline and depth tell meshes apart.
+    drawList.clear();
+    for(uint32_t i = 0; i < meshes.size(); ++i)
+    {
+        if(not meshVisible[i])
+            continue;
 
-    vkCmdBindDescriptorSets(
-            commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipeline->getLayoutHandle(),
-            EDescriptorSets::BindFrequency_Object, 1, // object-freq set, one set
-            &descriptorSets[frameIndex],
-            0, 0); // dynamic offsets junk
+        const glm::vec3 center(meshSpheres.x[i], meshSpheres.y[i], meshSpheres.z[i]);
+        const float depth = glm::length(center - cameraPos) - meshSpheres.radius[i];
+        drawList.add(DrawKey::make(meshes[i].isCompact() ? 1 : 0, 0, 0, depth, meshes[i].getDrawData().diffuse_texid), i);
+    }
+
+    drawList.sort();
+}
 
-    for(auto& mesh : meshes)
+bool Renderable::setStableRecording(bool stable)
+{
+    const auto& features = device->getEnabledFeatures();
+    stableRecording = stable and features.multiDrawIndirect and features.drawIndirectFirstInstance;
+    return stableRecording;
+}
+
+void Renderable::prepareDraws(uint32_t frameIndex, CameraSystem& camera, float viewportHeight, SoftwareOcclusion* occlusion)
+{
+    assert(frameIndex < indirectBuffers.size());
+    const auto& meshes = modelData->getMeshes();
+    const auto& meshNodes = modelData->getMeshNodes();
+    assert(not gpuCulling);
+
+    const auto matrices = camera.genCurrentVPMatrices();
+    const glm::mat4 viewProj = matrices.proj * matrices.view;
+    const glm::vec3 cameraPos = camera.getPosition();
+    cullStats = {};
+
+    cullMeshes(viewProj, occlusion);
+    selectLods(camera, viewportHeight);
+    sortVisibleMeshes(cameraPos);
+
+    // sorted by pipeline first, so full vertex meshes come before compact ones and each pipeline
+    // gets one contiguous range, front to back within it. Stable recording starts compact ones at a fixed spot.
+    drawCommands.resize(std::max<size_t>(modelData->maxDraws(), 1));
+    FrameDraws& draws = frameDraws[frameIndex];
+    draws = {};
+    for(const auto& item : drawList.getItems())
+    {
+        const uint32_t i = item.index;
+        const bool compact = meshes[i].isCompact();
+        uint32_t& count = compact ? draws.compactCount : draws.fullCount;
+        const uint32_t first = compact ? (stableRecording ? fullCapacity : draws.fullCount) + count : count;
+
+        // meshlets get culled in model space of their node, so their bounds are used as stored.
+        const auto view = CullView::forObject(viewProj, cameraPos, model * hierarchy.world(meshNodes[i]));
+        count += meshes[i].writeDraws(drawCommands.data() + first, i, meshLods[i], view, cullStats);
+    }
+
+    if(stableRecording)
+    {
+        // empty draws over whatever the ranges did not use this time.
+        std::fill(drawCommands.begin() + draws.fullCount, drawCommands.begin() + fullCapacity, VkDrawIndexedIndirectCommand{});
+        std::fill(drawCommands.begin() + fullCapacity + draws.compactCount, drawCommands.end(), VkDrawIndexedIndirectCommand{});
+    }
+    else
     {
-        mesh.cmdDraw(commandBuffer, pipeline->getLayoutHandle());
+        drawCommands.resize(draws.fullCount + draws.compactCount);
     }
+
+    indirectBuffers[frameIndex].copyToBuffer(drawCommands.data(), drawCommands.size() * sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void Renderable::cmdBindSetsDrawMeshes(CommandStateCache& state, uint32_t frameIndex)
+{
+    assert(frameIndex < frameDraws.size());
+    assert(not gpuCulling);
+
+    // stable ranges are drawn whole, the empty draws in them cost next to nothing.
+    const FrameDraws& draws = frameDraws[frameIndex];
+    const uint32_t fullCount = stableRecording ? fullCapacity : draws.fullCount;
+    const uint32_t compactFirst = stableRecording ? fullCapacity : draws.fullCount;
+    const uint32_t compactCount = stableRecording ? uint32_t(modelData->maxDraws()) - fullCapacity : draws.compactCount;
+    if(fullCount + compactCount == 0)
+        return;
+
+    state.bindPipeline(pipeline->getHandle());
+    sets->bind(state, pipeline->getLayoutHandle(), frameIndex);
+
+    // every mesh of the model lives in the same buffers, vertexOffset/firstIndex pick them apart.
+    const VkDeviceSize zero{0};
+    state.bindIndexBuffer(modelData->getIndexBuffer().getVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+    if(fullCount > 0)
+    {
+        state.bindVertexBuffers(0, 1, modelData->getVertexBuffer().getpVkBuffer(), &zero);
+        cmdDrawCommands(state.get(), frameIndex, 0, fullCount);
+    }
+
+    if(compactCount == 0)
+        return;
+
+    // layouts are compatible, so sets stay bound across the switch.
+    state.bindPipeline(compactPipeline->getHandle());
+    state.bindVertexBuffers(0, 1, modelData->getCompactVertexBuffer().getpVkBuffer(), &zero);
+    cmdDrawCommands(state.get(), frameIndex, compactFirst, compactCount);
 }
 
 } // namespace render
@@ -0,0 +1,182 @@
+#include "SamplerCache.hpp"
+#include "Logger.hpp"
+#include "VulkanMacros.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+namespace render::memory
+{
+
+namespace samplerPresets
+{
+    VkSamplerCreateInfo linear(VkSamplerAddressMode addressMode, float maxAnisotropy)
+    {
+        VkSamplerCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+
+        info.magFilter = VK_FILTER_LINEAR;
+        info.minFilter = VK_FILTER_LINEAR;
+        info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        info.addressModeU = addressMode;
+        info.addressModeV = addressMode;
+        info.addressModeW = addressMode;
+
+        info.anisotropyEnable = maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+        info.maxAnisotropy = std::max(maxAnisotropy, 1.0f);
+        info.maxLod = VK_LOD_CLAMP_NONE;
+        return info;
+    }
+
+    VkSamplerCreateInfo nearest(VkSamplerAddressMode addressMode)
+    {
+        VkSamplerCreateInfo info = linear(addressMode);
+        info.magFilter = VK_FILTER_NEAREST;
+        info.minFilter = VK_FILTER_NEAREST;
+        info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        return info;
+    }
+} // namespace samplerPresets
+
+SamplerCache::Key::Key(const VkSamplerCreateInfo& ci)
+    : flags(ci.flags)
+    , magFilter(ci.magFilter)
+    , minFilter(ci.minFilter)
+    , mipmapMode(ci.mipmapMode)
+    , addressModeU(ci.addressModeU)
+    , addressModeV(ci.addressModeV)
+    , addressModeW(ci.addressModeW)
+    , mipLodBias(ci.mipLodBias)
+    , anisotropyEnable(ci.anisotropyEnable)
+    // value does not matter when disabled, keep it from splitting the cache.
+    , maxAnisotropy(ci.anisotropyEnable ? ci.maxAnisotropy : 1.0f)
+    , compareEnable(ci.compareEnable)
+    , compareOp(ci.compareEnable ? ci.compareOp : VK_COMPARE_OP_NEVER)
+    , minLod(ci.minLod)
+    , maxLod(ci.maxLod)
+    , borderColor(ci.borderColor)
+    , unnormalizedCoordinates(ci.unnormalizedCoordinates)
+{
+}
+
+bool SamplerCache::Key::operator==(const Key& o) const
+{
+    return flags == o.flags
+        and magFilter == o.magFilter
+        and minFilter == o.minFilter
+        and mipmapMode == o.mipmapMode
+        and addressModeU == o.addressModeU
+        and addressModeV == o.addressModeV
+        and addressModeW == o.addressModeW
+        and mipLodBias == o.mipLodBias
+        and anisotropyEnable == o.anisotropyEnable
+        and maxAnisotropy == o.maxAnisotropy
+        and compareEnable == o.compareEnable
+        and compareOp == o.compareOp
+        and minLod == o.minLod
+        and maxLod == o.maxLod
+        and borderColor == o.borderColor
+        and unnormalizedCoordinates == o.unnormalizedCoordinates;
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const
+{
+    size_t seed = 0;
+    auto combine = [&seed](auto value)
+    {
+        // boost::hash_combine
+        seed ^= std::hash<decltype(value)>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+
+    combine(key.flags);
+    combine(static_cast<uint32_t>(key.magFilter));
+    combine(static_cast<uint32_t>(key.minFilter));
+    combine(static_cast<uint32_t>(key.mipmapMode));
+    combine(static_cast<uint32_t>(key.addressModeU));
+    combine(static_cast<uint32_t>(key.addressModeV));
+    combine(static_cast<uint32_t>(key.addressModeW));
+    combine(key.mipLodBias);
+    combine(key.anisotropyEnable);
+    combine(key.maxAnisotropy);
+    combine(key.compareEnable);
+    combine(static_cast<uint32_t>(key.compareOp));
+    combine(key.minLod);
+    combine(key.maxLod);
+    combine(static_cast<uint32_t>(key.borderColor));
+    combine(key.unnormalizedCoordinates);
+
+    return seed;
+}
+
+SamplerCache::SamplerCache(std::shared_ptr<VulkanDevice> device_ptr, const VkSamplerCreateInfo& defaultSampler)
+    : device(std::move(device_ptr))
+{
+    [[maybe_unused]] auto index = getOrCreate(defaultSampler);
+    assert(index == DEFAULT_SAMPLER_INDEX);
+}
+
+SamplerCache::~SamplerCache()
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        vkDestroySampler(device->getDevice(), samplers[i], nullptr);
+    }
+}
+
+void SamplerCache::clampToDevice(VkSamplerCreateInfo& ci) const
+{
+    if(not ci.anisotropyEnable)
+    {
+        return;
+    }
+
+    if(not device->getEnabledFeatures().samplerAnisotropy)
+    {
+        ci.anisotropyEnable = VK_FALSE;
+        ci.maxAnisotropy = 1.0f;
+        return;
+    }
+
+    ci.maxAnisotropy = std::clamp(ci.maxAnisotropy, 1.0f, device->getProperties().limits.maxSamplerAnisotropy);
+}
+
+uint32_t SamplerCache::getOrCreate(VkSamplerCreateInfo ci, bool* created)
+{
+    if(created)
+    {
+        *created = false;
+    }
+
+    clampToDevice(ci);
+    Key key{ci};
+
+    std::lock_guard lock(mut);
+    if(auto it = indices.find(key); it != indices.end())
+    {
+        return it->second;
+    }
+
+    if(count == SAMPLERS_MAX)
+    {
+        dbgE << "All sampler slots are taken. Falling back to default sampler." << NEWL;
+        return DEFAULT_SAMPLER_INDEX;
+    }
+
+    VK_CHECK(vkCreateSampler(device->getDevice(), &ci, nullptr, &samplers[count]));
+    indices.emplace(key, count);
+    if(created)
+    {
+        *created = true;
+    }
+
+    return count++;
+}
+
+VkSampler SamplerCache::getSampler(uint32_t index) const
+{
+    std::lock_guard lock(mut);
+    return index < count ? samplers[index] : samplers[DEFAULT_SAMPLER_INDEX];
+}
+
+} // namespace render::memory
@@ -0,0 +1,158 @@
+#include "Scene.hpp"
+#include "Bvh.hpp"
+
+#include <cassert>
+
+namespace render {
+
+namespace {
+
+// sphere around every mesh of the model under its node transforms.
+glm::vec4 modelSphere(const ModelData& model)
+{
+    const auto& meshes = model.getMeshes();
+    const auto& meshNodes = model.getMeshNodes();
+
+    Aabb box;
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        const auto& bounds = meshes[i].getBounds();
+        box.grow(Aabb{bounds.min, bounds.max}.transformed(model.getHierarchy().world(meshNodes[i])));
+    }
+
+    if(box.empty())
+        return glm::vec4(0.0f);
+    return glm::vec4(box.center(), glm::length(box.max - box.min) * 0.5f);
+}
+
+template<typename T>
+void moveLastTo(std::vector<T>& v, size_t index)
+{
+    v[index] = v.back();
+    v.pop_back();
+}
+
+} // anonymous namespace
+
+uint32_t Scene::addModel(std::shared_ptr<InstancedRenderable> instancer)
+{
+    assert(instancer);
+    modelSpheres.push_back(modelSphere(*instancer->getModel()));
+    models.push_back(std::move(instancer));
+    batches.emplace_back();
+    return static_cast<uint32_t>(models.size() - 1);
+}
+
+Entity Scene::create(uint32_t model, const glm::mat4& transform)
+{
+    assert(model < models.size());
+
+    const Entity entity = entities.create();
+    transforms.push_back(transform);
+    entityModels.push_back(model);
+    flags.push_back(ENTITY_MOVED);
+    bounds.push(glm::vec3(0.0f), 0.0f);
+    visible.push_back(0);
+
+    return entity;
+}
+
+void Scene::destroy(Entity entity)
+{
+    const uint32_t dense = entities.destroy(entity);
+    if(dense == Entity::NO_SLOT)
+        return;
+
+    // last one fills the hole, so the arrays stay packed.
+    moveLastTo(transforms, dense);
+    moveLastTo(entityModels, dense);
+    moveLastTo(flags, dense);
+    moveLastTo(bounds.x, dense);
+    moveLastTo(bounds.y, dense);
+    moveLastTo(bounds.z, dense);
+    moveLastTo(bounds.radius, dense);
+    moveLastTo(visible, dense);
+}
+
+const glm::mat4& Scene::getTransform(Entity entity) const
+{
+    const uint32_t dense = entities.denseIndex(entity);
+    assert(dense != Entity::NO_SLOT);
+    return transforms[dense];
+}
+
+void Scene::setTransform(Entity entity, const glm::mat4& transform)
+{
+    const uint32_t dense = entities.denseIndex(entity);
+    assert(dense != Entity::NO_SLOT);
+    transforms[dense] = transform;
+    flags[dense] |= ENTITY_MOVED;
+}
+
+void Scene::setHidden(Entity entity, bool hidden)
+{
+    const uint32_t dense = entities.denseIndex(entity);
+    assert(dense != Entity::NO_SLOT);
+    flags[dense] = hidden ? (flags[dense] | ENTITY_HIDDEN) : (flags[dense] & ~ENTITY_HIDDEN);
+}
+
+void Scene::updateBounds()
+{
+    const auto count = static_cast<int64_t>(transforms.size());
+
+    #pragma omp parallel for if(size_t(count) >= PARALLEL_CULL_THRESHOLD)
+    for(int64_t i = 0; i < count; ++i)
+    {
+        if(not (flags[i] & ENTITY_MOVED))
+            continue;
+
+        const glm::vec4& sphere = modelSpheres[entityModels[i]];
+        const glm::vec3 center(transforms[i] * glm::vec4(glm::vec3(sphere), 1.0f));
+        bounds.x[i] = center.x;
+        bounds.y[i] = center.y;
+        bounds.z[i] = center.z;
+        bounds.radius[i] = sphere.w * maxAxisScale(transforms[i]);
+        flags[i] &= ~ENTITY_MOVED;
+    }
+}
+
+void Scene::cull(const glm::mat4& viewProj)
+{
+    cullStats = {};
+    cullStats.objectsTested = static_cast<uint32_t>(transforms.size());
+    cullStats.objectsVisible = cullSpheres(Frustum::fromMatrix(viewProj), bounds, visible);
+
+    for(size_t i = 0; i < visible.size(); ++i)
+    {
+        if(visible[i] and (flags[i] & ENTITY_HIDDEN))
+        {
+            visible[i] = 0;
+            cullStats.objectsVisible--;
+        }
+    }
+}
+
+void Scene::buildDraws()
+{
+    assert(visible.size() == transforms.size());
+
+    for(auto& batch : batches)
+        batch.clear();
+
+    for(size_t i = 0; i < transforms.size(); ++i)
+    {
+        if(visible[i])
+            batches[entityModels[i]].emplace_back(transforms[i]);
+    }
+
+    cullStats.draws = 0;
+    for(size_t m = 0; m < models.size(); ++m)
+    {
+        if(not batches[m].empty())
+            cullStats.draws += static_cast<uint32_t>(models[m]->getModel()->getMeshes().size());
+        // copied, so the batch keeps its capacity for the next frame.
+        models[m]->setInstances(batches[m]);
+    }
+}
+
+} // namespace render
@@ -0,0 +1,41 @@
+#include "SceneHierarchy.hpp"
+
+#include <cassert>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace render {
+
+uint32_t SceneHierarchy::addNode(int32_t parent, glm::vec3 translation, glm::quat rotation, glm::vec3 scale)
+{
+    assert(parent == NO_PARENT or (parent >= 0 and size_t(parent) < size()));
+
+    const auto idx = static_cast<uint32_t>(size());
+    parents.push_back(parent);
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    worlds.push_back(glm::mat4(1.0f));
+    dirty = true;
+
+    return idx;
+}
+
+void SceneHierarchy::updateWorldTransforms()
+{
+    if(not dirty)
+        return;
+
+    for(size_t i = 0; i < parents.size(); ++i)
+    {
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), translations[i]);
+        local = local * glm::mat4_cast(rotations[i]);
+        local = glm::scale(local, scales[i]);
+
+        worlds[i] = parents[i] == NO_PARENT ? local : worlds[parents[i]] * local;
+    }
+
+    dirty = false;
+    ++worldVersion;
+}
+
+} // namespace render
@@ -101,7 +101,7 @@ namespace {
     }
 
     // only one push constant block is supported.
-    VkPushConstantRange reflectPushConstants(const std::vector<char>& bytecode)
+    VkPushConstantRange reflectPushConstants(const std::vector<char>& bytecode, VkShaderStageFlags stages)
     {
         SpvReflectShaderModule module = {};
         SpvReflectResult result = spvReflectCreateShaderModule(bytecode.size(), bytecode.data(), &module);
@@ -121,7 +121,7 @@ namespace {
 
         VkPushConstantRange ret =
         {
-            .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+            .stageFlags = stages,
             .offset = reflection_data->offset,
             .size = reflection_data->size,
         };
@@ -156,6 +156,8 @@ namespace {
             return VK_SHADER_STAGE_VERTEX_BIT;
         case (render::EShaderType::FRAGMENT_SHADER):
             return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case (render::EShaderType::COMPUTE_SHADER):
+            return VK_SHADER_STAGE_COMPUTE_BIT;
         default:
             throw std::runtime_error("Unsupported shader type... yet!");
         }
@@ -176,13 +178,20 @@ namespace {
     }
 
     // awful hack so i can have one UBO shared by all stages.
-    void addAllGraphicsBitToBindings(std::vector<render::DescriptorSetLayoutData>& sets)
+    // Compute shaders are a pipeline of their own, they keep their one stage.
+    VkShaderStageFlags layoutStageFlags(VkShaderStageFlagBits stage)
+    {
+        return stage == VK_SHADER_STAGE_COMPUTE_BIT ? VkShaderStageFlags(VK_SHADER_STAGE_COMPUTE_BIT)
+                                                    : VkShaderStageFlags(VK_SHADER_STAGE_ALL_GRAPHICS);
+    }
+
+    void setBindingStageFlags(std::vector<render::DescriptorSetLayoutData>& sets, VkShaderStageFlags stages)
     {
         for(auto& set : sets)
         {
             for(auto& binding : set.bindings)
             {
-                binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+                binding.stageFlags = stages;
             }
         }
     }
@@ -202,8 +211,8 @@ Shader::Shader(VkDevice device, const std::string& path, EShaderType type)
 
     createInfo = makeShaderCreateInfo(type, *shaderModule);
     setLayoutData = reflectDescriptorSets(vShaderCode);
-    pushConstantRange = reflectPushConstants(vShaderCode);
-    addAllGraphicsBitToBindings(setLayoutData);
+    pushConstantRange = reflectPushConstants(vShaderCode, layoutStageFlags(shaderType));
+    setBindingStageFlags(setLayoutData, layoutStageFlags(shaderType));
 
     descriptorSetLayouts = createDescriptorSetLayouts(device, setLayoutData);
 }
@@ -215,6 +224,7 @@ Shader::Shader(Shader&& rhs)
     , shaderType(rhs.shaderType)
     , setLayoutData(std::move(rhs.setLayoutData))
     , descriptorSetLayouts(std::move(rhs.descriptorSetLayouts))
+    , pushConstantRange(rhs.pushConstantRange)
 {
     //rhs.shaderModule = VK_NULL_HANDLE;
     rhs.shaderModule.reset();
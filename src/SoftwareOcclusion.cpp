@@ -0,0 +1,286 @@
+#include "SoftwareOcclusion.hpp"
+#include "Culling.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <utility>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace render {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// anything closer to the eye plane than this does not project well enough to trust.
+constexpr float NEAR_W = 1e-5f;
+
+// below this many triangles the threads cost more than they save.
+constexpr uint32_t PARALLEL_RASTER_THRESHOLD = 256;
+
+float msSince(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+glm::vec3 toScreen(const glm::vec4& clip)
+{
+    const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    return { (ndc.x * 0.5f + 0.5f) * SoftwareOcclusion::WIDTH, (ndc.y * 0.5f + 0.5f) * SoftwareOcclusion::HEIGHT, ndc.z };
+}
+
+// all three on the outer side of one of the side or far planes.
+bool outsideClip(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+    return (a.x < -a.w and b.x < -b.w and c.x < -c.w)
+        or (a.x > a.w and b.x > b.w and c.x > c.w)
+        or (a.y < -a.w and b.y < -b.w and c.y < -c.w)
+        or (a.y > a.w and b.y > b.w and c.y > c.w)
+        or (a.z > a.w and b.z > b.w and c.z > c.w);
+}
+
+} // anonymous namespace
+
+SoftwareOcclusion::SoftwareOcclusion()
+    : depth(WIDTH * HEIGHT, 1.0f)
+    , bins(HEIGHT / BAND_ROWS)
+{
+    static_assert(HEIGHT % BAND_ROWS == 0 and WIDTH % 4 == 0);
+}
+
+void SoftwareOcclusion::beginFrame(const glm::mat4& frameViewProj)
+{
+    viewProj = frameViewProj;
+    // clip x and y change by at most the length of their rows per unit moved.
+    pixelsPerUnit = std::max(
+        0.5f * WIDTH * glm::length(glm::vec3(viewProj[0][0], viewProj[1][0], viewProj[2][0])),
+        0.5f * HEIGHT * glm::length(glm::vec3(viewProj[0][1], viewProj[1][1], viewProj[2][1])));
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    triangles.clear();
+    for(auto& bin : bins)
+        bin.clear();
+    stats = {};
+}
+
+void SoftwareOcclusion::addOccluder(const OccluderMesh& occluder, const glm::mat4& model)
+{
+    const auto start = Clock::now();
+    const glm::mat4 toClip = viewProj * model;
+
+    clipPositions.resize(occluder.positions.size());
+    float minW = std::numeric_limits<float>::max();
+    for(size_t i = 0; i < occluder.positions.size(); ++i)
+    {
+        clipPositions[i] = toClip * glm::vec4(occluder.positions[i], 1.0f);
+        minW = std::min(minW, clipPositions[i].w);
+    }
+
+    // the error projected at the nearest vertex, where it is the largest.
+    if(occluder.error > 0.0f)
+    {
+        const float errorPixels = occluder.error * maxAxisScale(model) * pixelsPerUnit / std::max(minW, NEAR_W);
+        if(not (errorPixels <= MAX_OCCLUDER_ERROR_PIXELS))
+        {
+            stats.occludersTooCoarse++;
+            stats.setupMs += msSince(start);
+            return;
+        }
+    }
+
+    for(size_t t = 0; t + 2 < occluder.indices.size(); t += 3)
+    {
+        const glm::vec4& c0 = clipPositions[occluder.indices[t]];
+        const glm::vec4& c1 = clipPositions[occluder.indices[t + 1]];
+        const glm::vec4& c2 = clipPositions[occluder.indices[t + 2]];
+
+        // no clipping, a triangle crossing the eye plane just does not occlude anything.
+        if(not (c0.w > NEAR_W and c1.w > NEAR_W and c2.w > NEAR_W) or outsideClip(c0, c1, c2))
+            continue;
+
+        const glm::vec3 v[3] = { toScreen(c0), toScreen(c1), toScreen(c2) };
+        const float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if(not (std::abs(area) > 1e-6f))
+            continue;
+
+        Triangle tri;
+        const float sign = area > 0.0f ? 1.0f : -1.0f;
+        for(int e = 0; e < 3; ++e)
+        {
+            const glm::vec3& a = v[e];
+            const glm::vec3& b = v[(e + 1) % 3];
+            tri.edgeA[e] = -sign * (b.y - a.y);
+            tri.edgeB[e] = sign * (b.x - a.x);
+            tri.edgeC[e] = -tri.edgeA[e] * a.x - tri.edgeB[e] * a.y;
+        }
+
+        tri.dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+        tri.dzdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+        tri.z0 = v[0].z - tri.dzdx * v[0].x - tri.dzdy * v[0].y;
+
+        // pixel i has its center at i + 0.5.
+        const float minX = std::min({ v[0].x, v[1].x, v[2].x });
+        const float maxX = std::max({ v[0].x, v[1].x, v[2].x });
+        const float minY = std::min({ v[0].y, v[1].y, v[2].y });
+        const float maxY = std::max({ v[0].y, v[1].y, v[2].y });
+        tri.minX = std::max(0, int(std::ceil(minX - 0.5f)));
+        tri.maxX = std::min(int(WIDTH) - 1, int(std::floor(maxX - 0.5f)));
+        tri.minY = std::max(0, int(std::ceil(minY - 0.5f)));
+        tri.maxY = std::min(int(HEIGHT) - 1, int(std::floor(maxY - 0.5f)));
+        if(tri.minX > tri.maxX or tri.minY > tri.maxY)
+            continue;
+
+        const auto index = static_cast<uint32_t>(triangles.size());
+        triangles.push_back(tri);
+        for(int band = tri.minY / int(BAND_ROWS); band <= tri.maxY / int(BAND_ROWS); ++band)
+            bins[band].push_back(index);
+    }
+
+    stats.occluderTriangles = static_cast<uint32_t>(triangles.size());
+    stats.setupMs += msSince(start);
+}
+
+void SoftwareOcclusion::rasterizeRows(const Triangle& tri, int rowBegin, int rowEnd)
+{
+    for(int y = rowBegin; y <= rowEnd; ++y)
+    {
+        const float py = float(y) + 0.5f;
+        float* row = depth.data() + y * WIDTH;
+
+#if defined(__SSE__)
+        // four pixels at a time from a multiple of four, rows are too, so it never runs off a row.
+        const __m128 laneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        __m128 rowEdge[3];
+        for(int e = 0; e < 3; ++e)
+            rowEdge[e] = _mm_set1_ps(tri.edgeB[e] * py + tri.edgeC[e]);
+        const __m128 rowZ = _mm_set1_ps(tri.z0 + tri.dzdy * py);
+
+        for(int x = tri.minX & ~3; x <= tri.maxX; x += 4)
+        {
+            const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), laneCenters);
+
+            __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+            for(int e = 0; e < 3; ++e)
+            {
+                const __m128 dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edgeA[e]), px), rowEdge[e]);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, _mm_setzero_ps()));
+            }
+
+            const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.dzdx), px), rowZ);
+            const __m128 old = _mm_loadu_ps(row + x);
+            // min takes the second operand on NaN, a bad depth leaves the pixel alone.
+            const __m128 nearer = _mm_min_ps(z, old);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+        }
+#else
+        for(int x = tri.minX; x <= tri.maxX; ++x)
+        {
+            const float px = float(x) + 0.5f;
+            bool inside = true;
+            for(int e = 0; e < 3; ++e)
+                inside = inside and tri.edgeA[e] * px + tri.edgeB[e] * py + tri.edgeC[e] >= 0.0f;
+
+            const float z = tri.z0 + tri.dzdx * px + tri.dzdy * py;
+            if(inside and z < row[x])
+                row[x] = z;
+        }
+#endif
+    }
+}
+
+void SoftwareOcclusion::rasterize()
+{
+    const auto start = Clock::now();
+    const int bandCount = static_cast<int>(bins.size());
+
+    // every band owns its rows, so threads never write the same pixel.
+    #pragma omp parallel for schedule(dynamic) if(triangles.size() >= PARALLEL_RASTER_THRESHOLD)
+    for(int band = 0; band < bandCount; ++band)
+    {
+        const int rowBegin = band * int(BAND_ROWS);
+        const int rowEnd = rowBegin + int(BAND_ROWS) - 1;
+        for(uint32_t t : bins[band])
+        {
+            const Triangle& tri = triangles[t];
+            rasterizeRows(tri, std::max(rowBegin, tri.minY), std::min(rowEnd, tri.maxY));
+        }
+    }
+
+    stats.rasterMs += msSince(start);
+}
+
+bool SoftwareOcclusion::boxVisible(const glm::mat4& model, glm::vec3 min, glm::vec3 max)
+{
+    const auto start = Clock::now();
+
+    const bool visible = [&]()
+    {
+        const glm::mat4 toClip = viewProj * model;
+
+        float minX = std::numeric_limits<float>::max(), minY = minX;
+        float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+        float nearest = std::numeric_limits<float>::max();
+        for(int corner = 0; corner < 8; ++corner)
+        {
+            const glm::vec3 p(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+            const glm::vec4 clip = toClip * glm::vec4(p, 1.0f);
+            if(not (clip.w > NEAR_W))
+                return true;
+
+            const glm::vec3 s = toScreen(clip);
+            minX = std::min(minX, s.x);
+            maxX = std::max(maxX, s.x);
+            minY = std::min(minY, s.y);
+            maxY = std::max(maxY, s.y);
+            nearest = std::min(nearest, s.z);
+        }
+
+        // every pixel the rect touches, not only those whose center it covers. One pixel here is a
+        // handful on screen, a box reaching partly into an edge pixel is not hidden by it.
+        // Clamped before going to int, corners close to the eye plane land far off.
+        auto pixelRange = [](float lo, float hi, uint32_t size) {
+            lo = std::max(-1.0f, std::min(lo, float(size)));
+            hi = std::max(-1.0f, std::min(hi, float(size)));
+            const int first = int(std::floor(lo));
+            const int last = std::max(first, int(std::ceil(hi)) - 1);
+            return std::make_pair(std::max(0, first), std::min(int(size) - 1, last));
+        };
+        const auto [x0, x1] = pixelRange(minX, maxX, WIDTH);
+        const auto [y0, y1] = pixelRange(minY, maxY, HEIGHT);
+        // off screen, frustum culling has the final word.
+        if(x0 > x1 or y0 > y1)
+            return true;
+
+        // strictly in front, so an occluder never hides the box it sits in.
+        for(int y = y0; y <= y1; ++y)
+        {
+            const float* row = depth.data() + y * WIDTH;
+            int x = x0;
+#if defined(__SSE__)
+            const __m128 boxZ = _mm_set1_ps(nearest);
+            for(; x + 3 <= x1; x += 4)
+            {
+                if(_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxZ)))
+                    return true;
+            }
+#endif
+            for(; x <= x1; ++x)
+            {
+                if(row[x] >= nearest)
+                    return true;
+            }
+        }
+
+        return false;
+    }();
+
+    stats.boxesTested++;
+    stats.boxesOccluded += visible ? 0 : 1;
+    stats.testMs += msSince(start);
+    return visible;
+}
+
+} // namespace render
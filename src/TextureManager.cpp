@@ -1,7 +1,19 @@
 #include "TextureManager.hpp"
 #include "Logger.hpp"
 #include "stb_image.h"
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <set>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "Constants.hpp"
 
 namespace render::memory
@@ -9,6 +21,12 @@ namespace render::memory
 
 namespace
 {
+// cache keys, so "a/./b.png" and "a/c/../b.png" are the one texture the asset watcher calls "a/b.png".
+std::string normalizedPath(const std::string& path)
+{
+    return std::filesystem::path(path).lexically_normal().string();
+}
+
 struct image_data
 {
     image_data(const std::string& path)
@@ -43,16 +61,154 @@ struct image_data
     bool valid{false};
 };
 
+// Sets every RGBA8 pixel to the same value.
+void fillPixels(uint8_t* dst, size_t pixel_count, uint32_t value)
+{
+    auto* pixels = reinterpret_cast<uint32_t*>(dst);
+    std::fill(pixels, pixels + pixel_count, value);
+}
+
+// Takes the R channel of every RGBA8 source pixel and writes it to `channel` of dst,
+// leaving other channels of dst alone.
+void packChannel(uint8_t* dst, const uint8_t* src, size_t pixel_count, uint32_t channel)
+{
+    assert(channel < 4);
+    const uint32_t shift = 8 * channel;
+    const uint32_t keep_mask = ~(0xFFu << shift);
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // 4 pixels at once: mask out R, shift it into place, merge.
+    const __m128i r_mask = _mm_set1_epi32(0xFF);
+    const __m128i dst_mask = _mm_set1_epi32(static_cast<int>(keep_mask));
+    const __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+
+    for(; i + 4 <= pixel_count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+
+        s = _mm_sll_epi32(_mm_and_si128(s, r_mask), shift_count);
+        d = _mm_or_si128(_mm_and_si128(d, dst_mask), s);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), d);
+    }
+#endif
+
+    for(; i < pixel_count; ++i)
+    {
+        uint32_t s, d;
+        std::memcpy(&s, src + i * 4, 4);
+        std::memcpy(&d, dst + i * 4, 4);
+        d = (d & keep_mask) | ((s & 0xFFu) << shift);
+        std::memcpy(dst + i * 4, &d, 4);
+    }
+}
+
+// R = AO, G = specular, B = metallic, A = height, see loadPackedMaterial. Size is the one of the
+// first valid channel, mismatched ones get skipped.
+std::vector<uint8_t> packMaterialPixels(const std::array<std::string, 4>& channel_paths, int& width, int& height)
+{
+    // channels nobody provided get neutral values: full AO, no specular, no metal, flat height.
+    constexpr std::array<uint8_t, 4> defaults = { 255, 0, 0, 128 };
+
+    std::array<std::future<std::unique_ptr<image_data>>, 4> decodes;
+    for(size_t c = 0; c < 4; ++c)
+    {
+        if(not channel_paths[c].empty())
+        {
+            decodes[c] = std::async(std::launch::async,
+                [&path = channel_paths[c]]() { return std::make_unique<image_data>(path); });
+        }
+    }
+
+    std::array<std::unique_ptr<image_data>, 4> sources;
+    width = height = 0;
+    for(size_t c = 0; c < 4; ++c)
+    {
+        if(not decodes[c].valid())
+        {
+            continue;
+        }
+
+        sources[c] = decodes[c].get();
+        if(not sources[c]->isValid())
+        {
+            sources[c].reset();
+            continue;
+        }
+
+        // first valid one decides the size.
+        if(width == 0)
+        {
+            width = sources[c]->width;
+            height = sources[c]->height;
+        }
+        else if(sources[c]->width != width or sources[c]->height != height)
+        {
+            dbgE << "Material channel " << channel_paths[c] << " does not match size of the others, skipping it." << NEWL;
+            sources[c].reset();
+        }
+    }
+
+    // nothing to pack, a single texel of defaults will do.
+    if(width == 0)
+    {
+        width = height = 1;
+    }
+
+    const size_t pixel_count = size_t(width) * height;
+    std::vector<uint8_t> packed(pixel_count * 4);
+
+    uint32_t fill = 0;
+    for(size_t c = 0; c < 4; ++c)
+    {
+        if(not sources[c])
+        {
+            fill |= uint32_t(defaults[c]) << (8 * c);
+        }
+    }
+
+    fillPixels(packed.data(), pixel_count, fill);
+
+    for(uint32_t c = 0; c < 4; ++c)
+    {
+        if(sources[c])
+        {
+            packChannel(packed.data(), sources[c]->image, pixel_count, c);
+        }
+    }
+
+    return packed;
+}
+
+// Texture images go away with the last entry pointing at them, which for a packed image is whichever
+// of its layers gets released last. Deleter closures of a whole model run together, so counting
+// references from inside them would never see the last one.
+std::shared_ptr<VulkanImage> makeImage(const VulkanImageCreateInfo& ci, std::shared_ptr<VulkanDevice> device,
+                                       const void* data, size_t size)
+{
+    return std::shared_ptr<VulkanImage>(new VulkanImage(ci, std::move(device), data, size), [](VulkanImage* image) {
+        image->destroy();
+        delete image;
+    });
+}
+
 } // anonymous namespace
 
 TextureManager::TextureManager(std::shared_ptr<VulkanDevice> device_ptr)
     : device(std::move(device_ptr))
+    , samplers(device, samplerPresets::linear(VK_SAMPLER_ADDRESS_MODE_REPEAT, 16.0f))
 {
     createPlaceholderImage();
-    createSampler();
     initialBindingInformationCreation();
 }
 
+TextureManager::~TextureManager()
+{
+    placeholder_image->destroy();
+}
+
 void TextureManager::initialBindingInformationCreation()
 {
     assert(placeholder_image);
@@ -61,7 +217,7 @@ void TextureManager::initialBindingInformationCreation()
     {
         {
             .type = VK_DESCRIPTOR_TYPE_SAMPLER,
-            .descriptorCount = consts::maxFramesInFlight,
+            .descriptorCount = consts::maxFramesInFlight * SAMPLERS_MAX,
         },
         {
             .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
@@ -76,8 +232,11 @@ void TextureManager::initialBindingInformationCreation()
         binding_info.descriptors[i].imageView = placeholder_image->getImageView();
     }
 
-    binding_info.samplerDescriptor.sampler = sampler;
-    binding_info.samplerDescriptor.imageView = VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < SAMPLERS_MAX; ++i)
+    {
+        binding_info.samplerDescriptors[i].sampler = samplers.getSampler(i);
+        binding_info.samplerDescriptors[i].imageView = VK_NULL_HANDLE;
+    }
 }
 
 // a yellow - red stripped texture will do.
@@ -121,96 +280,475 @@ void TextureManager::createPlaceholderImage()
     dbgI << "placeholder image properly created and transitioned!" << NEWL;
 }
 
-void TextureManager::createSampler()
+uint32_t TextureManager::getSamplerIndex(const VkSamplerCreateInfo& ci)
 {
-    VkSamplerCreateInfo ci = [](VkFilter filters, VkSamplerAddressMode samplerAddressMode)
+    bool created = false;
+    auto index = samplers.getOrCreate(ci, &created);
+    // hits are already in the descriptors, bumping the version would rewrite every frame's set for nothing.
+    if(created)
     {
-        VkSamplerCreateInfo info{};
-	    info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	    info.pNext = nullptr;
+        std::lock_guard lock(descriptor_mut);
+        binding_info.samplerDescriptors[index].sampler = samplers.getSampler(index);
+        descriptor_version.fetch_add(1, std::memory_order_release);
+    }
 
-	    info.magFilter = filters;
-	    info.minFilter = filters;
-	    info.addressModeU = samplerAddressMode;
-	    info.addressModeV = samplerAddressMode;
-	    info.addressModeW = samplerAddressMode;
+    return index;
+}
 
-        info.anisotropyEnable = VK_TRUE;
-        info.maxAnisotropy = 16.0;
-	    return info;
-    }(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+TextureHandle::Slot::Slot(uint32_t index, std::string path, std::weak_ptr<TextureManager> owner)
+    : index(index)
+    , path(std::move(path))
+    , owner(std::move(owner))
+{
+}
 
-    vkCreateSampler(device->getDevice(), &ci, nullptr, &sampler);
+TextureHandle::Slot::~Slot()
+{
+    // manager could already be gone during shutdown, then there is nothing to recycle.
+    if(auto manager = owner.lock())
+    {
+        manager->releaseSlot(index, path);
+    }
 }
 
-size_t TextureManager::loadTexture(const std::string& path)
+TextureHandle TextureManager::loadTexture(const std::string& raw_path)
 {
+    const std::string path = normalizedPath(raw_path);
     dbgI << "trying to load texture: " << path << NEWL;
-    if(auto it = findInIndexMapSafe(path); it != index_map.end())
+    return loadCached(path, [this, &path]() { return createTextureSlot(path); });
+}
+
+TextureHandle TextureManager::loadPackedMaterial(const std::array<std::string, 4>& raw_channel_paths)
+{
+    std::array<std::string, 4> channel_paths;
+    std::transform(raw_channel_paths.begin(), raw_channel_paths.end(), channel_paths.begin(), normalizedPath);
+
+    // the key only has to be unique, never gets opened.
+    std::string key = "packed:";
+    for(const auto& path : channel_paths)
     {
-        return it->second;
+        key += path + '|';
     }
 
+    dbgI << "trying to load packed material: " << key << NEWL;
+    return loadCached(key, [this, &key, &channel_paths]() { return createPackedMaterialSlot(key, channel_paths); });
+}
+
+TextureHandle TextureManager::loadCached(
+    const std::string& key,
+    const std::function<std::shared_ptr<TextureHandle::Slot>()>& create)
+{
+    // Cache only holds weak references, so a waiter can find the slot already expired
+    // if the loading thread dropped its handle right away. Then just go again.
+    while(true)
+    {
+        bool loaded_here = false;
+        std::shared_ptr<TextureHandle::Slot> loaded;
+
+        auto cached = texture_cache.getOrLoad(key,
+            [&]()
+            {
+                loaded_here = true;
+                loaded = create();
+                return std::weak_ptr<TextureHandle::Slot>(loaded);
+            },
+            [](const std::weak_ptr<TextureHandle::Slot>& slot) { return not slot.expired(); });
+
+        if(loaded_here)
+        {
+            // empty on failed load, placeholder it is.
+            return TextureHandle{std::move(loaded)};
+        }
+
+        if(auto slot = cached.lock())
+        {
+            return TextureHandle{std::move(slot)};
+        }
+    }
+}
+
+std::shared_ptr<TextureHandle::Slot> TextureManager::createTextureSlot(const std::string& path)
+{
     image_data image{path};
     if(not image.isValid())
     {
         dbgI << "Invalid image presented." << NEWL;
-        return TEXTURES_MAX - 1;
+        return nullptr;
     }
 
+    return createSlotFromPixels(path, image.image, image.size,
+        static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), VK_FORMAT_R8G8B8A8_SRGB);
+}
+
+std::shared_ptr<TextureHandle::Slot> TextureManager::createPackedMaterialSlot(
+    const std::string& key, const std::array<std::string, 4>& channel_paths)
+{
+    {
+        std::lock_guard lock(reload_mut);
+        packed_materials[key] = channel_paths;
+    }
+
+    int width = 0, height = 0;
+    auto packed = packMaterialPixels(channel_paths, width, height);
+
+    // data, not color. No sRGB decode here.
+    return createSlotFromPixels(key, packed.data(), packed.size(),
+        static_cast<uint32_t>(width), static_cast<uint32_t>(height), VK_FORMAT_R8G8B8A8_UNORM);
+}
+
+std::shared_ptr<VulkanImage> TextureManager::createImage(
+    const void* data, size_t size, uint32_t width, uint32_t height, VkFormat format)
+{
     VulkanImageCreateInfo ci =
     {
-        .width = static_cast<uint32_t>(image.width),
-        .height = static_cast<uint32_t>(image.height),
+        .width = width,
+        .height = height,
         .layerCount = 1,
         .mipLevels = 1,
-        .format = VK_FORMAT_R8G8B8A8_SRGB,
+        .format = format,
         .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
     };
 
-    auto texture = std::make_unique<VulkanImage>(ci, device, image.image, image.size);
+    return makeImage(ci, device, data, size);
+}
+
+std::shared_ptr<TextureHandle::Slot> TextureManager::createSlotFromPixels(
+    const std::string& key, const void* data, size_t size, uint32_t width, uint32_t height, VkFormat format)
+{
+    auto texture = createImage(data, size, width, height, format);
 
     // array insertion and descriptor generation can be parallelized because every load will touch different index number.
     // This will be false-shared sometimes because of cache-line occupancy. This is non-realtime for now so fuck it.
-    // seq-cst as every thread needs to know about current index. Im not sure i can get away with acq-rel ordering here.
-    size_t texture_index = num_of_textures.fetch_add(1, std::memory_order_seq_cst);
-    if(texture_index >= TEXTURES_MAX)
+    auto texture_index = free_slots.pop();
+    if(not texture_index)
     {
-        dbgE << "Trying to create texture over maximum. Increase texture limits. Aborting exec." << NEWL;
-        throw std::runtime_error("Texture limit reached!");
+        dbgE << "All texture slots are taken. Increase texture limits. Falling back to placeholder." << NEWL;
+        return nullptr;
     }
 
-    textures[texture_index] = std::move(texture);
-    setInIndexMapSafe(path, texture_index);
-    generateDescriptorEntry(texture_index);
+    auto view = texture->getImageView();
+    textures[*texture_index] = TextureEntry{std::move(texture), view, false};
+    generateDescriptorEntry(*texture_index);
 
     dbgI << "Proper texture created." << NEWL;
 
-    return texture_index;
+    return std::make_shared<TextureHandle::Slot>(*texture_index, key, weak_from_this());
+}
+
+std::vector<TextureHandle> TextureManager::loadTexturesPacked(const std::vector<std::string>& raw_paths)
+{
+    std::vector<std::string> paths(raw_paths.size());
+    std::transform(raw_paths.begin(), raw_paths.end(), paths.begin(), normalizedPath);
+
+    std::vector<TextureHandle> handles(paths.size());
+
+    // Group by size first. stbi_info only parses the header, so this is cheap.
+    // Already loaded textures stay where they are.
+    std::map<std::pair<int, int>, std::vector<size_t>> groups;
+    std::set<std::string> seen;
+    for(size_t i = 0; i < paths.size(); ++i)
+    {
+        if(not seen.insert(paths[i]).second)
+        {
+            continue;
+        }
+
+        if(auto cached = texture_cache.find(paths[i]); cached and not cached->expired())
+        {
+            continue;
+        }
+
+        int width, height, channels;
+        if(stbi_info(paths[i].c_str(), &width, &height, &channels)
+            and width <= static_cast<int>(PACKED_TEXTURE_MAX_DIM)
+            and height <= static_cast<int>(PACKED_TEXTURE_MAX_DIM))
+        {
+            groups[{width, height}].push_back(i);
+        }
+    }
+
+    for(const auto& [size, members] : groups)
+    {
+        for(size_t first = 0; first < members.size(); first += PACKED_TEXTURE_MAX_LAYERS)
+        {
+            size_t count = std::min<size_t>(PACKED_TEXTURE_MAX_LAYERS, members.size() - first);
+
+            // lonely ones are not worth it, regular path below takes them.
+            if(count < 2)
+            {
+                continue;
+            }
+
+            std::vector<std::string> layer_paths;
+            for(size_t i = first; i < first + count; ++i)
+            {
+                layer_paths.push_back(paths[members[i]]);
+            }
+
+            auto slots = createPackedTextureSlots(layer_paths, size.first, size.second);
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                if(not slots[i])
+                {
+                    continue;
+                }
+
+                // someone could have loaded the same path meanwhile, then theirs wins
+                // and our layer gets released right away.
+                auto cached = texture_cache.getOrLoad(layer_paths[i],
+                    [&slots, i]() { return std::weak_ptr<TextureHandle::Slot>(slots[i]); },
+                    [](const std::weak_ptr<TextureHandle::Slot>& slot) { return not slot.expired(); });
+
+                handles[members[first + i]] = TextureHandle{cached.lock()};
+            }
+        }
+    }
+
+    // everything that was not packed, and duplicates, which are just cache hits by now.
+    for(size_t i = 0; i < paths.size(); ++i)
+    {
+        if(not handles[i].valid())
+        {
+            handles[i] = loadTexture(paths[i]);
+        }
+    }
+
+    return handles;
 }
 
-std::map<std::string, size_t>::iterator TextureManager::findInIndexMapSafe(const std::string& key)
+std::vector<std::shared_ptr<TextureHandle::Slot>> TextureManager::createPackedTextureSlots(
+    const std::vector<std::string>& paths, uint32_t width, uint32_t height)
 {
-    std::shared_lock lock(index_map_mut);
-    return index_map.find(key);
+    std::vector<std::shared_ptr<TextureHandle::Slot>> slots(paths.size());
+
+    std::vector<std::future<std::unique_ptr<image_data>>> decodes;
+    for(const auto& path : paths)
+    {
+        decodes.emplace_back(std::async(std::launch::async,
+            [&path]() { return std::make_unique<image_data>(path); }));
+    }
+
+    // header could lie, or file changed since. Only matching ones go in.
+    std::vector<std::unique_ptr<image_data>> images;
+    std::vector<size_t> image_to_path;
+    const size_t layer_size = size_t(width) * height * 4;
+    for(size_t i = 0; i < decodes.size(); ++i)
+    {
+        auto image = decodes[i].get();
+        if(image->isValid() and image->size == layer_size)
+        {
+            images.push_back(std::move(image));
+            image_to_path.push_back(i);
+        }
+    }
+
+    if(images.size() < 2)
+    {
+        return slots;
+    }
+
+    std::vector<uint8_t> pixels(layer_size * images.size());
+    for(size_t layer = 0; layer < images.size(); ++layer)
+    {
+        std::memcpy(pixels.data() + layer * layer_size, images[layer]->image, layer_size);
+    }
+    images.clear();
+
+    VulkanImageCreateInfo ci =
+    {
+        .width = width,
+        .height = height,
+        .layerCount = static_cast<uint32_t>(image_to_path.size()),
+        .mipLevels = 1,
+        .format = VK_FORMAT_R8G8B8A8_SRGB,
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+    };
+
+    auto texture = makeImage(ci, device, pixels.data(), pixels.size());
+    dbgI << "Packed " << ci.layerCount << " textures of " << width << "x" << height << " into one image." << NEWL;
+
+    for(uint32_t layer = 0; layer < ci.layerCount; ++layer)
+    {
+        auto texture_index = free_slots.pop();
+        if(not texture_index)
+        {
+            dbgE << "All texture slots are taken. Increase texture limits. Falling back to placeholder." << NEWL;
+            break;
+        }
+
+        const auto& path = paths[image_to_path[layer]];
+        textures[*texture_index] = TextureEntry{texture, texture->createLayerView(layer), true};
+        generateDescriptorEntry(*texture_index);
+        slots[image_to_path[layer]] = std::make_shared<TextureHandle::Slot>(*texture_index, path, weak_from_this());
+    }
+
+    return slots;
 }
 
-void TextureManager::setInIndexMapSafe(const std::string& key, size_t value)
+void TextureManager::releaseSlot(uint32_t texture_index, const std::string& path)
 {
-    std::unique_lock lock(index_map_mut);
-    index_map[key] = value;
+    assert(texture_index < PLACEHOLDER_TEXTURE_INDEX);
+    dbgI << "Unloading texture: " << path << NEWL;
+
+    // the entry could have been taken over by a newer load of the same path in the meantime.
+    texture_cache.eraseIf(path, [](const std::weak_ptr<TextureHandle::Slot>& slot) { return slot.expired(); });
+
+    // Frames recorded from now on will sample the placeholder. Frames still in flight might sample
+    // the old image, so the image and the slot itself are retired through the deletion queue.
+    {
+        std::lock_guard lock(descriptor_mut);
+        binding_info.descriptors[texture_index].imageView = placeholder_image->getImageView();
+        descriptor_version.fetch_add(1, std::memory_order_release);
+    }
+
+    {
+        std::lock_guard lock(reload_mut);
+        packed_materials.erase(path);
+    }
+
+    retireEntry(std::move(textures[texture_index]), texture_index);
+}
+
+void TextureManager::retireEntry(TextureEntry entry, std::optional<uint32_t> free_index)
+{
+    device->getDeletionQueue().push(
+        [entry = std::move(entry), device = device, free_index, manager = weak_from_this()]() mutable
+        {
+            if(entry.owns_view)
+            {
+                vkDestroyImageView(device->getDevice(), entry.view, nullptr);
+            }
+
+            // layers of a packed image share it, the image itself goes with the last of them.
+            entry.image.reset();
+
+            if(free_index)
+            {
+                if(auto mgr = manager.lock())
+                {
+                    mgr->free_slots.push(*free_index);
+                }
+            }
+        });
+}
+
+bool TextureManager::isTextureFile(const std::string& path)
+{
+    // what stb_image decodes.
+    static const std::set<std::string> extensions = {
+        ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".gif", ".hdr", ".pic", ".pnm", ".ppm", ".pgm",
+    };
+
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extensions.count(extension) > 0;
 }
 
-void TextureManager::generateDescriptorEntry(size_t texture_index)
+bool TextureManager::reloadTexture(const std::string& raw_path)
+{
+    const std::string path = normalizedPath(raw_path);
+
+    // only slots somebody still holds are worth the trouble.
+    auto liveSlot = [this](const std::string& key) -> std::shared_ptr<TextureHandle::Slot>
+    {
+        auto cached = texture_cache.find(key);
+        return cached ? cached->lock() : nullptr;
+    };
+
+    std::vector<std::pair<std::shared_ptr<TextureHandle::Slot>, std::shared_ptr<VulkanImage>>> reloaded;
+
+    if(auto slot = liveSlot(path))
+    {
+        image_data image{path};
+        if(image.isValid())
+        {
+            reloaded.emplace_back(std::move(slot), createImage(image.image, image.size,
+                static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), VK_FORMAT_R8G8B8A8_SRGB));
+        }
+        else
+        {
+            dbgE << "Reloaded " << path << " is not a valid image, keeping the old one." << NEWL;
+        }
+    }
+
+    std::vector<std::pair<std::string, std::array<std::string, 4>>> materials;
+    {
+        std::lock_guard lock(reload_mut);
+        for(const auto& [key, channels] : packed_materials)
+        {
+            if(std::find(channels.begin(), channels.end(), path) != channels.end())
+            {
+                materials.emplace_back(key, channels);
+            }
+        }
+    }
+
+    for(const auto& [key, channels] : materials)
+    {
+        if(auto slot = liveSlot(key))
+        {
+            int width = 0, height = 0;
+            auto packed = packMaterialPixels(channels, width, height);
+            reloaded.emplace_back(std::move(slot), createImage(packed.data(), packed.size(),
+                static_cast<uint32_t>(width), static_cast<uint32_t>(height), VK_FORMAT_R8G8B8A8_UNORM));
+        }
+    }
+
+    if(reloaded.empty())
+    {
+        return false;
+    }
+
+    // layers of packed images come back as standalone images, that is fine until the next full load.
+    std::lock_guard lock(reload_mut);
+    for(auto& [slot, image] : reloaded)
+    {
+        auto view = image->getImageView();
+        pending_reloads.push_back({ slot, TextureEntry{std::move(image), view, false} });
+    }
+
+    return true;
+}
+
+void TextureManager::applyReloads()
+{
+    std::vector<PendingReload> reloads;
+    {
+        std::lock_guard lock(reload_mut);
+        reloads.swap(pending_reloads);
+    }
+
+    for(auto& reload : reloads)
+    {
+        // slot went away in the meantime, image never got used.
+        auto slot = reload.slot.lock();
+        if(not slot)
+        {
+            retireEntry(std::move(reload.entry), std::nullopt);
+            continue;
+        }
+
+        retireEntry(std::exchange(textures[slot->index], std::move(reload.entry)), std::nullopt);
+        generateDescriptorEntry(slot->index);
+        dbgI << "Reloaded texture: " << slot->path << NEWL;
+    }
+}
+
+void TextureManager::generateDescriptorEntry(uint32_t texture_index)
 {
     assert(texture_index < TEXTURES_MAX);
-    binding_info.descriptors[texture_index].imageView = textures[texture_index]->getImageView();
+    std::lock_guard lock(descriptor_mut);
+    binding_info.descriptors[texture_index].imageView = textures[texture_index].view;
+    descriptor_version.fetch_add(1, std::memory_order_release);
 }
 
-// Unsafe, i should just mutex it all. Torn reads are possible here because we can be mangling
-// with descriptors while doing vkUpdateDescriptorSets. Too bad!
 void TextureManager::fillDescriptorSet(VkDescriptorSet descriptorSet)
 {
+    // loader threads write entries while this reads them, the device copies them out before returning.
+    std::lock_guard lock(descriptor_mut);
+
     // @TODO: This should all be done as one call to UpdateDescriptorSets.
     VkWriteDescriptorSet wds_tex_array = {
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -229,9 +767,9 @@ void TextureManager::fillDescriptorSet(VkDescriptorSet descriptorSet)
         .dstSet = descriptorSet,
         .dstBinding = consts::perFrame_textureSamplerBinding,
         .dstArrayElement = 0,
-        .descriptorCount = 1,
+        .descriptorCount = SAMPLERS_MAX,
         .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
-        .pImageInfo = &binding_info.samplerDescriptor,
+        .pImageInfo = binding_info.samplerDescriptors.data(),
     };
 
     vkUpdateDescriptorSets(device->getDevice(), 1, &wds_sampler, 0, nullptr);
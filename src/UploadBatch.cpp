@@ -0,0 +1,64 @@
+#include "UploadBatch.hpp"
+#include "VmaVulkanBuffer.hpp"
+#include "Logger.hpp"
+
+#include <cstring>
+
+namespace render::memory {
+
+UploadBatch::UploadBatch(std::shared_ptr<VulkanDevice> device_ptr)
+    : device(std::move(device_ptr))
+{
+}
+
+void UploadBatch::add(const void* data, size_t size, VkBuffer dst, VkDeviceSize dstOffset)
+{
+    if (not data or size == 0) {
+        return;
+    }
+
+    // keep every region 16 byte aligned in staging, memcpy likes it better.
+    totalSize = (totalSize + 15) & ~size_t(15);
+    regions.push_back({ data, size, dst, dstOffset, totalSize });
+    totalSize += size;
+}
+
+void UploadBatch::submit()
+{
+    if (regions.empty()) {
+        return;
+    }
+
+    VmaVulkanBuffer staging(device, totalSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+    staging.map();
+    auto* mapped = static_cast<std::byte*>(staging.mem());
+    for (const auto& region : regions) {
+        std::memcpy(mapped + region.stagingOffset, region.data, region.size);
+    }
+    vmaFlushAllocation(device->getVmaAllocator(), staging.getVmaAllocation(), 0, VK_WHOLE_SIZE);
+    staging.unmap();
+
+    device->immediateSubmitBlocking(
+            [&](VkCommandBuffer cmd)
+            {
+                for (const auto& region : regions) {
+                    VkBufferCopy copy = {
+                        .srcOffset = region.stagingOffset,
+                        .dstOffset = region.dstOffset,
+                        .size = region.size,
+                    };
+
+                    vkCmdCopyBuffer(cmd, staging.getVkBuffer(), region.dst, 1, &copy);
+                }
+            });
+
+    dbgI << "Uploaded " << regions.size() << " buffers, " << totalSize << " bytes in one batch." << NEWL;
+
+    staging.destroy();
+    regions.clear();
+    owned.clear();
+    totalSize = 0;
+}
+
+} // namespace render::memory
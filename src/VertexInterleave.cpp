@@ -0,0 +1,104 @@
+#include "VertexInterleave.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace render {
+
+namespace {
+
+// SIMD path writes fields with 16 byte stores that spill 4 bytes into the next field,
+// which then gets overwritten by the next store. Only holds for this exact layout.
+constexpr size_t POS_OFFSET = 0;
+constexpr size_t NORMAL_OFFSET = 12;
+constexpr size_t TANGENT_OFFSET = 24;
+constexpr size_t TEXCOORD_OFFSET = 36;
+static_assert(sizeof(Vertex) == 44);
+static_assert(offsetof(Vertex, pos) == POS_OFFSET);
+static_assert(offsetof(Vertex, surf_normals) == NORMAL_OFFSET);
+static_assert(offsetof(Vertex, tangents) == TANGENT_OFFSET);
+static_assert(offsetof(Vertex, tex_coords) == TEXCOORD_OFFSET);
+
+void copyOrZero(std::byte* dst, const float* stream, size_t idx, size_t bytes)
+{
+    if(stream)
+    {
+        std::memcpy(dst, stream + idx * 3, bytes);
+    }
+    else
+    {
+        std::memset(dst, 0, bytes);
+    }
+}
+
+void interleaveRangeScalar(const VertexStreams& streams, size_t begin, size_t end, Vertex* dst)
+{
+    for(size_t i = begin; i < end; ++i)
+    {
+        auto* out = reinterpret_cast<std::byte*>(dst + i);
+        copyOrZero(out + POS_OFFSET, streams.positions, i, 12);
+        copyOrZero(out + NORMAL_OFFSET, streams.normals, i, 12);
+        copyOrZero(out + TANGENT_OFFSET, streams.tangents, i, 12);
+        copyOrZero(out + TEXCOORD_OFFSET, streams.texCoords, i, 8);
+    }
+}
+
+} // anonymous namespace
+
+void interleaveVerticesScalar(const VertexStreams& streams, size_t count, Vertex* dst)
+{
+    interleaveRangeScalar(streams, 0, count, dst);
+}
+
+void interleaveVertices(const VertexStreams& streams, size_t count, Vertex* dst)
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // missing streams are rare enough to not bother, scalar handles them.
+    const bool all_streams = streams.positions and streams.normals and streams.tangents and streams.texCoords;
+
+    // 16 byte loads read 4 bytes past a triplet, so the last vertex has to go scalar
+    // to not read past the end of the streams.
+    if(all_streams and count > 1)
+    {
+        for(; i < count - 1; ++i)
+        {
+            const auto* pos = reinterpret_cast<const __m128i*>(streams.positions + i * 3);
+            const auto* normal = reinterpret_cast<const __m128i*>(streams.normals + i * 3);
+            const auto* tangent = reinterpret_cast<const __m128i*>(streams.tangents + i * 3);
+            const auto* uv = reinterpret_cast<const __m128i*>(streams.texCoords + i * 3);
+
+            auto* out = reinterpret_cast<std::byte*>(dst + i);
+
+            // order matters, every store fixes up the 4 garbage bytes of the previous one.
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + POS_OFFSET), _mm_loadu_si128(pos));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + NORMAL_OFFSET), _mm_loadu_si128(normal));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + TANGENT_OFFSET), _mm_loadu_si128(tangent));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + TEXCOORD_OFFSET), _mm_loadl_epi64(uv));
+        }
+    }
+#endif
+
+    interleaveRangeScalar(streams, i, count, dst);
+
+#ifndef NDEBUG
+    // debug builds check the fast path against the reference one.
+    std::vector<Vertex> reference(count);
+    interleaveVerticesScalar(streams, count, reference.data());
+    assert(std::memcmp(reference.data(), dst, count * sizeof(Vertex)) == 0);
+#endif
+}
+
+} // namespace render
@@ -49,6 +49,33 @@ VmaVulkanBuffer::VmaVulkanBuffer(
     }
 }
 
+VmaVulkanBuffer::VmaVulkanBuffer(
+    std::shared_ptr<VulkanDevice> deviceptr,
+    size_t size,
+    VkBufferUsageFlags vk_flags,
+    VmaMemoryUsage vma_usage)
+    : device(std::move(deviceptr))
+    , allocator(device->getVmaAllocator())
+    , is_gpu_buffer(vma_usage == VMA_MEMORY_USAGE_GPU_ONLY)
+{
+    // gpu buffers can only be filled by transfers.
+    buffer = createMemoryBuffer(
+            size,
+            is_gpu_buffer ? vk_flags | VK_BUFFER_USAGE_TRANSFER_DST_BIT : vk_flags,
+            vma_usage);
+}
+
+void VmaVulkanBuffer::destroy()
+{
+    if (buffer.vkBuffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    buffer.unmap();
+    vmaDestroyBuffer(allocator, buffer.vkBuffer, buffer.allocation);
+    buffer.vkBuffer = VK_NULL_HANDLE;
+}
+
 void VmaVulkanBuffer::copyToBuffer(
     BufferInfo& buffer,
     const void* transfer_data,
@@ -68,6 +68,72 @@ void VulkanApplication::createGraphicsPipeline()
         vkDevice->getDevice(),
         vkSwapchainFramebuffer.getRenderPass(),
         Pipeline::vertex_input_tag<Vertex>{});
+
+    // same fragment shader, vertex shader only differs in how it unpacks attributes.
+    std::vector<Shader> compactShaders = {
+        Shader { vkDevice->getDevice(), "shaders/vert_compact.spv", EShaderType::VERTEX_SHADER },
+        Shader { vkDevice->getDevice(), "shaders/frag.spv", EShaderType::FRAGMENT_SHADER }
+    };
+
+    compactPipeline = std::make_shared<Pipeline>(
+        compactShaders,
+        vkSwapchain.getSwapchainExtent(),
+        vkDevice->getDevice(),
+        vkSwapchainFramebuffer.getRenderPass(),
+        Pipeline::vertex_input_tag<CompactVertex>{});
+
+    if(scene_grid > 0)
+    {
+        std::vector<Shader> instancedShaders = {
+            Shader { vkDevice->getDevice(), "shaders/vert_instanced.spv", EShaderType::VERTEX_SHADER },
+            Shader { vkDevice->getDevice(), "shaders/frag.spv", EShaderType::FRAGMENT_SHADER }
+        };
+
+        instancedPipeline = std::make_shared<Pipeline>(
+            instancedShaders,
+            vkSwapchain.getSwapchainExtent(),
+            vkDevice->getDevice(),
+            vkSwapchainFramebuffer.getRenderPass(),
+            Pipeline::vertex_input_tag<Vertex>{},
+            Pipeline::vertex_input_tag<InstanceData>{});
+    }
+
+    if(gpu_culling and GpuCulling::supported(*vkDevice))
+    {
+        const Shader cullShader { vkDevice->getDevice(), "shaders/cull.spv", EShaderType::COMPUTE_SHADER };
+        cullPipeline = std::make_shared<ComputePipeline>(cullShader, vkDevice->getDevice());
+
+        const Shader reduceShader { vkDevice->getDevice(), "shaders/hiz.spv", EShaderType::COMPUTE_SHADER };
+        depthPyramid = std::make_shared<DepthPyramid>(vkDevice, vkSwapchainFramebuffer.getDepthAttachment(), reduceShader);
+    }
+    else if(gpu_culling)
+    {
+        dbgE << "Device cannot do GPU culling, staying on the CPU." << NEWL;
+    }
+}
+
+void VulkanApplication::createScene()
+{
+    auto instancer = assetLoader->loadInstanced(scene_path, instancedPipeline);
+    if(not instancer)
+    {
+        dbgE << "Loading " << scene_path << " failed, nothing to put in the scene." << NEWL;
+        return;
+    }
+
+    scene = std::make_unique<Scene>();
+    const uint32_t model = scene->addModel(std::move(instancer));
+
+    // centered on x, rows going away from the camera along -z.
+    const float half = (scene_grid - 1) * scene_spacing * 0.5f;
+    for(uint32_t x = 0; x < scene_grid; ++x)
+    {
+        for(uint32_t z = 0; z < scene_grid; ++z)
+        {
+            const glm::vec3 position(x * scene_spacing - half, 0.0f, -(z * scene_spacing) - scene_spacing);
+            scene->create(model, glm::translate(glm::mat4(1.0f), position));
+        }
+    }
 }
 
 void VulkanApplication::createOffscreenFramebuffer()
@@ -103,6 +169,32 @@ void VulkanApplication::createCommandPool()
         throw std::runtime_error("Failed to create command pool.");
 }
 
+void VulkanApplication::createSecondaryCommandBuffers()
+{
+    // cached passes get re-recorded one by one, so they need a pool that lets them reset alone.
+    const VkCommandPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = vkDevice->getGraphicsQueueIndice(),
+    };
+
+    VK_CHECK(vkCreateCommandPool(vkDevice->getDevice(), &poolInfo, nullptr, &secondaryCommandPool));
+
+    std::array<VkCommandBuffer, consts::maxFramesInFlight * 2> buffers;
+    const VkCommandBufferAllocateInfo ai = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = secondaryCommandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = static_cast<uint32_t>(buffers.size()),
+    };
+
+    VK_CHECK(vkAllocateCommandBuffers(vkDevice->getDevice(), &ai, buffers.data()));
+    for(size_t i = 0; i < buffers.size(); ++i)
+    {
+        cachedPasses[i / 2][i % 2].commandBuffer = buffers[i];
+    }
+}
+
 void VulkanApplication::createCommandBuffers()
 {
     commandBuffers.resize(vkSwapchainFramebuffer.size());
@@ -163,15 +255,134 @@ void VulkanApplication::recordCommandBuffers(uint32_t swapchainImgIdx, uint32_t
         }();
 
         auto cmd = commandBuffers[frameInFlightIdx];
-        vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        if(frame_renderable and frame_renderable->gpuCullingEnabled())
+        {
+            recordOcclusionCulledFrame(cmd, renderPassInfo, frameInFlightIdx);
+        }
+        else
+        {
+            // culling stays per frame, only the recording of its results can be cached.
+            if(frame_renderable)
+            {
+                frame_renderable->prepareDraws(frameInFlightIdx, *cameraSystem,
+                                               static_cast<float>(vkSwapchain.getSwapchainExtent().height),
+                                               prepareSoftwareOcclusion());
+            }
+
+            recordPass(cmd, renderPassInfo, frameInFlightIdx, std::nullopt);
+        }
+
+        if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+            throw std::runtime_error("failed to record command buffer.");
+}
+
+SoftwareOcclusion* VulkanApplication::prepareSoftwareOcclusion()
+{
+    if(not softwareOcclusion)
+        return nullptr;
+
+    const auto matrices = cameraSystem->genCurrentVPMatrices();
+    softwareOcclusion->beginFrame(matrices.proj * matrices.view);
+    if(frame_renderable and frame_renderable->isOccluder())
+    {
+        frame_renderable->addOccluders(*softwareOcclusion);
+    }
+    softwareOcclusion->rasterize();
+
+    return softwareOcclusion.get();
+}
+
+void VulkanApplication::recordOcclusionCulledFrame(VkCommandBuffer cmd, const VkRenderPassBeginInfo& beginInfo,
+                                                   uint32_t frameInFlightIdx)
+{
+    const float height = static_cast<float>(vkSwapchain.getSwapchainExtent().height);
+
+    // compute work can not go inside a render pass, so culling splits the frame in two.
+    auto drawPhase = [&](ECullPhase phase, ESplitPass part)
+    {
+        frame_renderable->cmdCull(cmd, frameInFlightIdx, phase, *cameraSystem, height);
+
+        VkRenderPassBeginInfo rbi = beginInfo;
+        rbi.renderPass = vkSwapchainFramebuffer.getSplitRenderPass(part);
+        recordPass(cmd, rbi, frameInFlightIdx, phase);
+    };
+
+    drawPhase(ECullPhase::EARLY, ESplitPass::FIRST);
+    depthPyramid->cmdBuild(cmd);
+    drawPhase(ECullPhase::LATE, ESplitPass::SECOND);
+}
+
+void VulkanApplication::recordPassContents(CommandStateCache& state, uint32_t frameInFlightIdx,
+                                           std::optional<ECullPhase> phase)
+{
+    if(scene)
+    {
+        // the instanced layout has a push constant range the main one lacks, so set 0 has to go through it.
+        perFrameData->bind(state, frameInFlightIdx, *instancedPipeline);
+        for(const auto& instancer : scene->getModels())
+            instancer->cmdBindSetsDrawMeshes(state, frameInFlightIdx);
+        return;
+    }
+
+    perFrameData->bind(state, frameInFlightIdx);
+    if(not frame_renderable)
+        return;
 
-        perFrameData->bind(cmd, frameInFlightIdx);
-        to_render_test->cmdBindSetsDrawMeshes(cmd, frameInFlightIdx);
+    if(phase)
+        frame_renderable->cmdBindSetsDrawCulled(state, frameInFlightIdx, *phase);
+    else
+        frame_renderable->cmdBindSetsDrawMeshes(state, frameInFlightIdx);
+}
+
+bool VulkanApplication::canCacheRecording() const
+{
+    return cache_recording and frame_renderable
+        and (frame_renderable->gpuCullingEnabled() or frame_renderable->hasStableRecording());
+}
 
+void VulkanApplication::recordPass(VkCommandBuffer cmd, const VkRenderPassBeginInfo& beginInfo, uint32_t frameInFlightIdx,
+                                   std::optional<ECullPhase> phase)
+{
+    if(not canCacheRecording())
+    {
+        vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        CommandStateCache state(cmd);
+        recordPassContents(state, frameInFlightIdx, phase);
         vkCmdEndRenderPass(cmd);
+        return;
+    }
 
-        if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
-            throw std::runtime_error("failed to record command buffer.");
+    auto& pass = cachedPasses[frameInFlightIdx][phase == ECullPhase::LATE ? 1 : 0];
+    if(pass.version != recordingVersion or pass.renderPass != beginInfo.renderPass)
+    {
+        // the primary that last executed it is done, its fence was waited on before recording started.
+        VK_CHECK(vkResetCommandBuffer(pass.commandBuffer, 0));
+
+        const VkCommandBufferInheritanceInfo inheritance = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .renderPass = beginInfo.renderPass,
+            .subpass = 0,
+            .framebuffer = VK_NULL_HANDLE, // swapchain image changes from frame to frame.
+        };
+
+        const VkCommandBufferBeginInfo cbi = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+            .pInheritanceInfo = &inheritance,
+        };
+
+        VK_CHECK(vkBeginCommandBuffer(pass.commandBuffer, &cbi));
+        CommandStateCache state(pass.commandBuffer);
+        recordPassContents(state, frameInFlightIdx, phase);
+        VK_CHECK(vkEndCommandBuffer(pass.commandBuffer));
+
+        pass.version = recordingVersion;
+        pass.renderPass = beginInfo.renderPass;
+    }
+
+    vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(cmd, 1, &pass.commandBuffer);
+    vkCmdEndRenderPass(cmd);
 }
 
 void VulkanApplication::initVulkan()
@@ -188,6 +399,10 @@ void VulkanApplication::initVulkan()
     vkSwapchain = VulkanSwapchain(*vkDevice, surface, window);
     vkSwapchainFramebuffer = VulkanFramebuffer(vkDevice, vkSwapchain, true);
     createGraphicsPipeline();
+    if(software_occlusion and not cullPipeline)
+    {
+        softwareOcclusion = std::make_unique<SoftwareOcclusion>();
+    }
     textureManager = std::make_shared<memory::TextureManager>(vkDevice);
     assetLoader = std::make_shared<AssetLoader>(vkDevice, textureManager);
     cameraSystem = std::make_shared<CameraSystem>(window, (float)WIDTH/(float)HEIGHT, 30.0f);
@@ -195,10 +410,22 @@ void VulkanApplication::initVulkan()
     frameSyncData = std::make_shared<VulkanApplication::FrameSyncData>(vkDevice, vkSwapchain.size());
 
     // to remove later on
-    to_render_test = assetLoader->loadObject("assets/backpack/backpack.obj", pipeline);
+    if(scene_grid > 0)
+    {
+        createScene();
+    }
+    else
+    {
+        pending_load = assetLoader->loadObjectAsync(scene_path, pipeline, 0, compactPipeline);
+    }
+    assetWatcher = std::make_unique<AssetWatcher>(std::vector<std::string>{ "assets" });
 
     createCommandPool();
     createCommandBuffers();
+    if(cache_recording)
+    {
+        createSecondaryCommandBuffers();
+    }
 }
 
 void VulkanApplication::mainLoop()
@@ -217,6 +444,10 @@ void VulkanApplication::render()
     // we need to wait if all frames inflight are used right now.
     vkWaitForFences(vkDevice->getDevice(), 1, &frameSyncData->inFlightFences[inFlightFrameNo], VK_TRUE, UINT64_MAX);
 
+    // oldest frame in flight is done, anything released before it can go now.
+    vkDevice->getDeletionQueue().retireFrame();
+    processAssetChanges();
+
     uint32_t imageIndex;
     vkAcquireNextImageKHR(vkDevice->getDevice(),
         vkSwapchain.getSwapchain(),
@@ -225,13 +456,93 @@ void VulkanApplication::render()
         VK_NULL_HANDLE, //fence, if applicable.
         &imageIndex);
 
-    recordCommandBuffers(imageIndex, inFlightFrameNo);
+    // descriptor writes have to happen before recording, they would invalidate buffers that bound the set.
     updateUbos(inFlightFrameNo);
+    recordCommandBuffers(imageIndex, inFlightFrameNo);
     sendBufferToQueue(imageIndex, inFlightFrameNo);
 
     frameSyncData->advanceFrame();
 }
 
+void VulkanApplication::processAssetChanges()
+{
+    // reloads jump ahead of anything else queued, somebody is staring at the screen waiting for them.
+    constexpr int RELOAD_PRIORITY = 10;
+
+    for(const auto& path : assetWatcher->takeChanged())
+    {
+        if(path == scene_path and scene)
+        {
+            dbgI << "Scene changed on disk, instanced scenes do not reload." << NEWL;
+        }
+        else if(path == scene_path)
+        {
+            dbgI << "Scene changed on disk, reloading." << NEWL;
+            if(pending_load)
+            {
+                pending_load->cancel();
+            }
+            pending_load = assetLoader->loadObjectAsync(scene_path, pipeline, RELOAD_PRIORITY, compactPipeline);
+        }
+        else if(memory::TextureManager::isTextureFile(path))
+        {
+            // textures nothing has loaded get ignored by the texture manager.
+            assetLoader->reloadTextureAsync(path, RELOAD_PRIORITY);
+        }
+    }
+
+    textureManager->applyReloads();
+
+    if(pending_load and pending_load->done())
+    {
+        // on a failed reload the old scene stays, better than nothing.
+        if(auto loaded = pending_load->get())
+        {
+            to_render_test = std::move(loaded);
+        }
+        else if(pending_load->state() == LoadHandle::State::Failed)
+        {
+            dbgE << "Loading " << scene_path << " failed." << NEWL;
+        }
+
+        pending_load.reset();
+    }
+
+    // the old scene keeps drawing while a reload is in flight, proxy is only for the first load.
+    auto next = to_render_test ? to_render_test : pending_load ? pending_load->proxy() : nullptr;
+    if(next != frame_renderable)
+    {
+        retireRenderable(std::move(frame_renderable));
+        frame_renderable = std::move(next);
+        recordingVersion++;
+
+        if(cullPipeline and frame_renderable and not frame_renderable->gpuCullingEnabled())
+        {
+            frame_renderable->enableGpuCulling(cullPipeline, depthPyramid);
+        }
+
+        if(cache_recording and frame_renderable and not frame_renderable->setStableRecording(true)
+            and not frame_renderable->gpuCullingEnabled())
+        {
+            dbgE << "Device cannot draw with multiDrawIndirect, recording every frame." << NEWL;
+        }
+
+        // the one renderable there is hides its own meshes behind each other.
+        if(softwareOcclusion and frame_renderable)
+        {
+            frame_renderable->setOccluder(true);
+        }
+    }
+}
+
+void VulkanApplication::retireRenderable(std::shared_ptr<Renderable> r)
+{
+    if(r)
+    {
+        vkDevice->getDeletionQueue().push([r = std::move(r)]() mutable { r.reset(); });
+    }
+}
+
 void VulkanApplication::sendBufferToQueue(uint32_t imageIndex, size_t currentFrame)
 {
     if (frameSyncData->imagesInFlight[imageIndex] != VK_NULL_HANDLE)
@@ -269,7 +580,8 @@ void VulkanApplication::sendBufferToQueue(uint32_t imageIndex, size_t currentFra
     // Reset operation makes fence block! Not the other way around.
     vkResetFences(vkDevice->getDevice(), 1, &frameSyncData->inFlightFences[currentFrame]);
 
-    // dont we have a race condition right there? Yes but this is not multithreaded. (yet!)
+    // loader threads submit uploads to the same queue.
+    auto queueLock = vkDevice->lockQueues();
     VK_CHECK(vkQueueSubmit(vkDevice->getGraphicsQueue(), 1, &submitInfo, frameSyncData->inFlightFences[currentFrame]));
 
     VkSwapchainKHR swapchains[] = { vkSwapchain.getSwapchain() };
@@ -303,15 +615,73 @@ void VulkanApplication::updateUbos(size_t frameIdx)
         .times = glfwGetTime(),
     };
 
-    to_render_test->updateUniforms(ubo, frameIdx);
-    perFrameData->refreshData(frameIdx);
+    if(frame_renderable)
+    {
+        frame_renderable->updateUniforms(ubo, frameIdx);
+    }
+    if(scene)
+    {
+        updateScene(frameIdx, ubo);
+    }
+    if(perFrameData->refreshData(frameIdx))
+    {
+        // that frame's cached passes bound the rewritten set.
+        for(auto& pass : cachedPasses[frameIdx])
+            pass.version = 0;
+    }
 }
 
 
+void VulkanApplication::updateScene(size_t frameIdx, const RenderableUbo& ubo)
+{
+    const auto matrices = cameraSystem->genCurrentVPMatrices();
+    scene->updateBounds();
+    scene->cull(matrices.proj * matrices.view);
+    scene->buildDraws();
+
+    // entities carry their whole transform, the group one would move them away from their bounds.
+    const RenderableUbo sceneUbo = {
+        .model = glm::mat4(1.0f),
+        .times = ubo.times,
+    };
+    for(const auto& instancer : scene->getModels())
+        instancer->updateUniforms(sceneUbo, frameIdx);
+}
+
 void VulkanApplication::cleanup()
 {
+    assetWatcher.reset();
+
+    // loader threads still submitting would race the teardown. Not only the current load: cancelled
+    // older ones and texture reloads can still be queued or running, and uploads go to the same queue.
+    if(pending_load)
+    {
+        pending_load->cancel();
+        pending_load.reset();
+    }
+    assetLoader->waitIdle();
+
+    vkDeviceWaitIdle(vkDevice->getDevice());
+
+    // drop the scene first so its textures land in the deletion queue, then flush it.
+    frame_renderable.reset();
+    to_render_test.reset();
+    scene.reset();
+    depthPyramid.reset();
+    cullPipeline.reset();
+    vkDevice->getDeletionQueue().flushAll();
+
+    // the loader's cache still holds textures, and samplers and images have to go before the device.
+    assetLoader.reset();
+    perFrameData.reset();
+    vkDevice->getDeletionQueue().flushAll();
+    textureManager.reset();
 
     vkDestroyCommandPool(vkDevice->getDevice(), commandPool, nullptr);
+    if(cache_recording)
+    {
+        vkDestroyCommandPool(vkDevice->getDevice(), secondaryCommandPool, nullptr);
+    }
 
     //for(auto&& framebuffer : swapChainFramebuffers)
     //    vkDestroyFramebuffer(vkDevice->getDevice(), framebuffer, nullptr);
@@ -1,8 +1,10 @@
 #include "VulkanDevice.hpp"
 #include "Logger.hpp"
 #include "VulkanMacros.hpp"
+#include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cstring>
 #include <optional>
 #include <set>
 
@@ -71,8 +73,37 @@ VkPhysicalDevice pickPhysicalDevice(const VkInstance& instance)
     throw std::runtime_error("No device with all required queue families found.");
 }
 
+// Only things we actually use, and only if the device has them. Users have to check
+// VulkanDevice::getEnabledFeatures() instead of assuming.
+VkPhysicalDeviceFeatures pickEnabledFeatures(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceFeatures supported;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supported);
+
+    VkPhysicalDeviceFeatures enabled {};
+    enabled.samplerAnisotropy = supported.samplerAnisotropy;
+    // one indirect draw per pipeline, with firstInstance picking per draw data.
+    enabled.multiDrawIndirect = supported.multiDrawIndirect;
+    enabled.drawIndirectFirstInstance = supported.drawIndirectFirstInstance;
+
+    return enabled;
+}
+
+bool hasDeviceExtension(VkPhysicalDevice physicalDevice, const char* name)
+{
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, extensions.data());
+
+    return std::any_of(extensions.begin(), extensions.end(),
+        [name](const auto& ext) { return std::strcmp(ext.extensionName, name) == 0; });
+}
+
 VkDevice createLogicalDevice(const VkPhysicalDevice& physicalDevice,
-    render::QueueFamiliesIndices indices)
+    render::QueueFamiliesIndices indices,
+    const VkPhysicalDeviceFeatures& deviceFeatures,
+    bool drawIndirectCount)
 {
     std::vector<VkDeviceQueueCreateInfo> deviceQueueCreateInfos;
     std::set<uint32_t> uniqueQueueFamiliesIndices = {
@@ -94,14 +125,16 @@ VkDevice createLogicalDevice(const VkPhysicalDevice& physicalDevice,
         }());
     }
 
-    // Right now we are not interested in any special features, so we enable none.
-    VkPhysicalDeviceFeatures deviceFeatures {};
     std::vector<const char*> deviceExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
         //"VK_KHR_get_memory_requirements2",
         //"VK_KHR_dedicated_allocation"
     };
 
+    // optional, GPU culling draws exactly as many commands as survived with it.
+    if (drawIndirectCount)
+        deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
     const auto createInfo = [&deviceFeatures, &deviceQueueCreateInfos, &deviceExtensions] {
         VkDeviceCreateInfo createInfo {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -145,7 +178,9 @@ namespace render {
 VulkanDevice::VulkanDevice(VkInstance instance, VkSurfaceKHR surface)
     : vkPhysicalDevice(pickPhysicalDevice(instance))
     , queueIndices(queryQueueFamilies(vkPhysicalDevice, surface))
-    , vkLogicalDevice(createLogicalDevice(vkPhysicalDevice, queueIndices))
+    , enabledFeatures(pickEnabledFeatures(vkPhysicalDevice))
+    , drawIndirectCount(hasDeviceExtension(vkPhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+    , vkLogicalDevice(createLogicalDevice(vkPhysicalDevice, queueIndices, enabledFeatures, drawIndirectCount))
 {
     vkGetPhysicalDeviceProperties(vkPhysicalDevice, &deviceProperties);
     vkGetPhysicalDeviceFeatures(vkPhysicalDevice, &deviceFeatures);
@@ -156,6 +191,13 @@ VulkanDevice::VulkanDevice(VkInstance instance, VkSurfaceKHR surface)
 
     allocator = createVmaAllocator(instance, vkPhysicalDevice, vkLogicalDevice);
 
+    if (drawIndirectCount) {
+        pfnDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(vkLogicalDevice, "vkCmdDrawIndexedIndirectCountKHR"));
+        drawIndirectCount = pfnDrawIndexedIndirectCount != nullptr;
+    }
+    dbgI << "VK_KHR_draw_indirect_count: " << (drawIndirectCount ? "yes" : "no") << NEWL;
+
     // unsignaled fence
     const VkFenceCreateInfo fenceInfo = {
         .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
@@ -179,6 +221,9 @@ VulkanDevice::~VulkanDevice()
 
 void VulkanDevice::immediateSubmitBlocking(std::function<void(VkCommandBuffer)> func)
 {
+    // texture loads come in from many threads at once, and neither pool nor fence can be shared.
+    std::lock_guard lock(uploadContext.mut);
+
     VkCommandBufferAllocateInfo ai =
     {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
@@ -204,7 +249,10 @@ void VulkanDevice::immediateSubmitBlocking(std::function<void(VkCommandBuffer)>
         .commandBufferCount = 1,
         .pCommandBuffers = &cmdb
     };
-    VK_CHECK(vkQueueSubmit(getGraphicsQueue(), 1, &submitInfo, uploadContext.uploadFence));
+    {
+        auto queueLock = lockQueues();
+        VK_CHECK(vkQueueSubmit(getGraphicsQueue(), 1, &submitInfo, uploadContext.uploadFence));
+    }
 
     vkWaitForFences(getDevice(), 1, &uploadContext.uploadFence, VK_TRUE, UINT64_MAX);
     vkResetFences(getDevice(), 1, &uploadContext.uploadFence);
@@ -63,7 +63,12 @@ VulkanFramebuffer::VulkanFramebuffer(std::shared_ptr<VulkanDevice> deviceptr, co
         framebuffers.emplace_back(std::move(fb));
     }
 
-    createRenderPass();
+    renderPass = createRenderPass();
+    if(createDepthAttachment)
+    {
+        splitRenderPasses[0] = createRenderPass(ESplitPass::FIRST);
+        splitRenderPasses[1] = createRenderPass(ESplitPass::SECOND);
+    }
     createFramebuffer();
 }
 
@@ -110,16 +115,31 @@ VulkanFramebuffer::VulkanFramebuffer(std::shared_ptr<VulkanDevice> deviceptr, st
 
     // after the Framebuffer vector is ready and we have all attachments in check, we can create a renderpass based on that,
     // and then finally the VkFramebuffer objects.
-    createRenderPass();
+    renderPass = createRenderPass();
     createFramebuffer();
 }
 
-void VulkanFramebuffer::createRenderPass()
+VkRenderPass VulkanFramebuffer::createRenderPass(std::optional<ESplitPass> split)
 {
     std::vector<VkAttachmentDescription> attachmentDescriptions;
 
     for (auto& attachment : attachmentsInfo) {
-        attachmentDescriptions.push_back(attachment.description);
+        VkAttachmentDescription description = attachment.description;
+        const bool depth = attachment.type == EFramebufferAttachmentType::ATTACHMENT_DEPTH;
+
+        // the first half hands everything over to the second one, depth in a layout compute can read.
+        const VkImageLayout handover = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                             : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        if (split == ESplitPass::FIRST) {
+            description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            description.finalLayout = handover;
+        }
+        else if (split == ESplitPass::SECOND) {
+            description.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            description.initialLayout = handover;
+        }
+
+        attachmentDescriptions.push_back(description);
     }
 
     // Collect attachment references
@@ -221,6 +241,36 @@ void VulkanFramebuffer::createRenderPass()
     sd.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     sd.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
+    std::vector<VkSubpassDependency> subpassDependencies = { sd };
+
+    constexpr VkAccessFlags attachmentAccess = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+        | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    constexpr VkPipelineStageFlags attachmentStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+        | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+    if (split == ESplitPass::FIRST) {
+        // depth gets read by compute (depth pyramid) and everything gets drawn over by the second half.
+        subpassDependencies.push_back({
+            .srcSubpass = 0,
+            .dstSubpass = VK_SUBPASS_EXTERNAL,
+            .srcStageMask = attachmentStages,
+            .dstStageMask = attachmentStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = attachmentAccess | VK_ACCESS_SHADER_READ_BIT,
+        });
+    }
+    else if (split == ESplitPass::SECOND) {
+        // compute reading depth in between has to be done before it becomes an attachment again.
+        subpassDependencies[0] = {
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = attachmentStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            .dstStageMask = attachmentStages,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = attachmentAccess,
+        };
+    }
+
     // Create render pass
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -228,13 +278,14 @@ void VulkanFramebuffer::createRenderPass()
     renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescriptions.size());
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &sd;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+    renderPassInfo.pDependencies = subpassDependencies.data();
     //renderPassInfo.dependencyCount = 2;
     //renderPassInfo.pDependencies = dependencies.data();
 
-
-    VK_CHECK(vkCreateRenderPass(device->getDevice(), &renderPassInfo, nullptr, &renderPass));
+    VkRenderPass pass;
+    VK_CHECK(vkCreateRenderPass(device->getDevice(), &renderPassInfo, nullptr, &pass));
+    return pass;
 }
 
 void VulkanFramebuffer::createFramebuffer()
@@ -288,7 +339,8 @@ memory::VulkanImage VulkanFramebuffer::createDepthAttachment()
         .layerCount = 1,
         .mipLevels = 1,
         .format = VK_FORMAT_D32_SFLOAT,
-        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        // sampled for the depth pyramid.
+        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
     };
 
     return memory::VulkanImage(ci, device);
@@ -47,10 +47,8 @@ VulkanImage::VulkanImage(const VulkanImageCreateInfo& ci, std::shared_ptr<Vulkan
 
     VkImageAspectFlags aspectMask = 0;
 
-    if (ci.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)) {
-        aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    }
-    else if (ci.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+    // depth attachments can be sampled too, format decides over usage then.
+    if (ci.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
         if (hasDepth()) {
             aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
         }
@@ -58,6 +56,9 @@ VulkanImage::VulkanImage(const VulkanImageCreateInfo& ci, std::shared_ptr<Vulkan
             aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
         }
     }
+    else if (ci.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT)) {
+        aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    }
 
     assert(aspectMask > 0);
 
@@ -117,6 +118,71 @@ VulkanImage::VulkanImage(const VulkanImageCreateInfo& ci, std::shared_ptr<Vulkan
     transitionLayoutBarrier(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
+void VulkanImage::destroy()
+{
+    assert(not swapchainImage);
+
+    if (vkImageView != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(device->getDevice(), vkImageView, nullptr);
+        vkImageView = VK_NULL_HANDLE;
+    }
+
+    if (vkImage != VK_NULL_HANDLE)
+    {
+        vmaDestroyImage(device->getVmaAllocator(), vkImage, allocation);
+        vkImage = VK_NULL_HANDLE;
+        allocation = VK_NULL_HANDLE;
+    }
+}
+
+VkImageView VulkanImage::createLayerView(uint32_t layer)
+{
+    assert(not swapchainImage);
+    assert(layer < creationData.layerCount);
+
+    const auto imageViewCi = [layer, this]() {
+        VkImageViewCreateInfo ivci {};
+        ivci.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ivci.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        ivci.format = format;
+        ivci.subresourceRange = subresourceRange;
+        ivci.subresourceRange.baseArrayLayer = layer;
+        ivci.subresourceRange.layerCount = 1;
+        ivci.image = vkImage;
+
+        return ivci;
+    }();
+
+    VkImageView view;
+    VK_CHECK(vkCreateImageView(device->getDevice(), &imageViewCi, nullptr, &view));
+    return view;
+}
+
+VkImageView VulkanImage::createMipView(uint32_t baseLevel, uint32_t levelCount)
+{
+    assert(not swapchainImage);
+    assert(baseLevel + levelCount <= creationData.mipLevels);
+
+    const auto imageViewCi = [baseLevel, levelCount, this]() {
+        VkImageViewCreateInfo ivci {};
+        ivci.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ivci.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        ivci.format = format;
+        ivci.subresourceRange = subresourceRange;
+        ivci.subresourceRange.baseMipLevel = baseLevel;
+        ivci.subresourceRange.levelCount = levelCount;
+        ivci.subresourceRange.layerCount = 1;
+        ivci.image = vkImage;
+
+        return ivci;
+    }();
+
+    VkImageView view;
+    VK_CHECK(vkCreateImageView(device->getDevice(), &imageViewCi, nullptr, &view));
+    return view;
+}
+
 // this will need changes to subresourceRange element. Or will it?
 void VulkanImage::transitionLayoutBarrier(VkImageLayout from, VkImageLayout to)
 {
@@ -165,7 +231,8 @@ void VulkanImage::copyToImageStaging(const void* data, size_t size)
 	            copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	            copyRegion.imageSubresource.mipLevel = 0;
 	            copyRegion.imageSubresource.baseArrayLayer = 0;
-	            copyRegion.imageSubresource.layerCount = 1;
+	            // layers follow each other in the buffer, so a single region covers all of them.
+	            copyRegion.imageSubresource.layerCount = creationData.layerCount;
 	            copyRegion.imageExtent = VkExtent3D{
                     .width = creationData.width,
                     .height = creationData.height,
@@ -176,6 +243,9 @@ void VulkanImage::copyToImageStaging(const void* data, size_t size)
 	            vkCmdCopyBufferToImage(cmd, stagingBuffer.getVkBuffer(), getImage(),
                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
             });
+
+    // upload is blocking, so staging can go right away.
+    stagingBuffer.destroy();
 }
 
 // just a wrapper for externally created vkImages, like we get from the swapchain
@@ -3,11 +3,13 @@
 
 layout (location = 0) in vec3 vNormal;
 layout (location = 1) in vec2 texCoords;
+layout (location = 2) flat in uint diffuseIdx; // per draw, from DrawData
+layout (location = 3) flat in uint diffuseSamplerIdx;
 
 layout (location = 0) out vec4 outColor;
 
 layout(binding = 0, set = 0) uniform texture2D textures[4096];
-layout(binding = 1, set = 0) uniform sampler samp;
+layout(binding = 1, set = 0) uniform sampler samplers[16];
 
 layout(binding = 0, set = 1) uniform UboPerObject
 {
@@ -15,15 +17,8 @@ layout(binding = 0, set = 1) uniform UboPerObject
     float time;
 } ubosek;
 
-layout( push_constant ) uniform constants
-{
-	uint diffuse_idx;
-	uint normal_idx;
-	uint specular_idx;
-} PushConstants;
-
 void main()
 {
-    outColor = texture(sampler2D(textures[PushConstants.diffuse_idx], samp), texCoords);
+    outColor = texture(sampler2D(textures[diffuseIdx], samplers[diffuseSamplerIdx]), texCoords);
     //outColor = vec4(vNormal.xyz, 1.0);
 }
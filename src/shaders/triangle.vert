@@ -7,7 +7,7 @@ layout (location = 2) in vec3 vTangents;
 layout (location = 3) in vec2 vTexCoords;
 
 layout(binding = 0, set = 0) uniform texture2D textures[4096];
-layout(binding = 1, set = 0) uniform sampler samp;
+layout(binding = 1, set = 0) uniform sampler samplers[16];
 layout(binding = 2, set = 0) uniform UboPerFrame
 {
     mat4 view;
@@ -20,19 +20,41 @@ layout(binding = 0, set = 1) uniform UboPerObject
     float time;
 } objectData;
 
-layout( push_constant ) uniform constants
+// MeshDrawData, one per mesh of the model. firstInstance of every draw points at its own.
+struct DrawData
 {
+	uint node; // index into nodes
 	uint diffuse_idx;
 	uint normal_idx;
-	uint specular_idx;
-} PushConstants;
+	uint material_idx; // r = ao, g = specular, b = metallic, a = height
+	uint diffuse_sampler_idx;
+	uint data_sampler_idx;
+	float pos_scale[3]; // compact vertices only
+	float pos_bias[3];
+};
+
+layout(std430, binding = 1, set = 1) readonly buffer NodeTransforms
+{
+	mat4 world[]; // world transform of the node within the model
+} nodes;
+
+layout(std430, binding = 2, set = 1) readonly buffer Draws
+{
+	DrawData draws[];
+} drawData;
 
 layout (location = 0) out vec3 normal;
 layout (location = 1) out vec2 texCoords;
+layout (location = 2) flat out uint diffuseIdx;
+layout (location = 3) flat out uint diffuseSamplerIdx;
 
 void main()
 {
-    gl_Position = frameData.proj * frameData.view * objectData.model * vec4(vPosition, 1.0);
+    DrawData draw = drawData.draws[gl_InstanceIndex];
+
+    gl_Position = frameData.proj * frameData.view * objectData.model * nodes.world[draw.node] * vec4(vPosition, 1.0);
     texCoords = vTexCoords;
     normal = vNormal;
+    diffuseIdx = draw.diffuse_idx;
+    diffuseSamplerIdx = draw.diffuse_sampler_idx;
 }
@@ -0,0 +1,75 @@
+#version 450
+#extension GL_ARB_sepatrate_shader_objects : enable
+
+// CompactVertex input, see CompactVertex.hpp.
+layout (location = 0) in vec4 vPosition; // unorm, xyz relative to mesh bounds
+layout (location = 1) in vec2 vNormal; // octahedral
+layout (location = 2) in vec2 vTangents; // octahedral
+layout (location = 3) in vec2 vTexCoords;
+
+layout(binding = 0, set = 0) uniform texture2D textures[4096];
+layout(binding = 1, set = 0) uniform sampler samplers[16];
+layout(binding = 2, set = 0) uniform UboPerFrame
+{
+    mat4 view;
+    mat4 proj;
+} frameData;
+
+layout(binding = 0, set = 1) uniform UboPerObject
+{
+    mat4 model;
+    float time;
+} objectData;
+
+// MeshDrawData, one per mesh of the model. firstInstance of every draw points at its own.
+struct DrawData
+{
+	uint node; // index into nodes
+	uint diffuse_idx;
+	uint normal_idx;
+	uint material_idx; // r = ao, g = specular, b = metallic, a = height
+	uint diffuse_sampler_idx;
+	uint data_sampler_idx;
+	float pos_scale[3]; // compact vertices only
+	float pos_bias[3];
+};
+
+layout(std430, binding = 1, set = 1) readonly buffer NodeTransforms
+{
+	mat4 world[]; // world transform of the node within the model
+} nodes;
+
+layout(std430, binding = 2, set = 1) readonly buffer Draws
+{
+	DrawData draws[];
+} drawData;
+
+layout (location = 0) out vec3 normal;
+layout (location = 1) out vec2 texCoords;
+layout (location = 2) flat out uint diffuseIdx;
+layout (location = 3) flat out uint diffuseSamplerIdx;
+
+vec3 octDecode(vec2 p)
+{
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    if(n.z < 0.0)
+    {
+        n.xy = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main()
+{
+    DrawData draw = drawData.draws[gl_InstanceIndex];
+
+    vec3 scale = vec3(draw.pos_scale[0], draw.pos_scale[1], draw.pos_scale[2]);
+    vec3 bias = vec3(draw.pos_bias[0], draw.pos_bias[1], draw.pos_bias[2]);
+    vec3 position = bias + vPosition.xyz * scale;
+
+    gl_Position = frameData.proj * frameData.view * objectData.model * nodes.world[draw.node] * vec4(position, 1.0);
+    texCoords = vTexCoords;
+    normal = octDecode(vNormal);
+    diffuseIdx = draw.diffuse_idx;
+    diffuseSamplerIdx = draw.diffuse_sampler_idx;
+}
@@ -0,0 +1,72 @@
+#version 450
+#extension GL_ARB_sepatrate_shader_objects : enable
+
+layout (location = 0) in vec3 vPosition;
+layout (location = 1) in vec3 vNormal;
+layout (location = 2) in vec3 vTangents;
+layout (location = 3) in vec2 vTexCoords;
+
+// InstanceData, per instance. Top three rows of the instance's model matrix.
+layout (location = 4) in vec4 iTransform0;
+layout (location = 5) in vec4 iTransform1;
+layout (location = 6) in vec4 iTransform2;
+
+layout(binding = 0, set = 0) uniform texture2D textures[4096];
+layout(binding = 1, set = 0) uniform sampler samplers[16];
+layout(binding = 2, set = 0) uniform UboPerFrame
+{
+    mat4 view;
+    mat4 proj;
+} frameData;
+
+layout(binding = 0, set = 1) uniform UboPerObject
+{
+    mat4 model;
+    float time;
+} objectData;
+
+// MeshDrawData, one per mesh of the model.
+struct DrawData
+{
+	uint node; // index into nodes
+	uint diffuse_idx;
+	uint normal_idx;
+	uint material_idx; // r = ao, g = specular, b = metallic, a = height
+	uint diffuse_sampler_idx;
+	uint data_sampler_idx;
+	float pos_scale[3]; // compact vertices only
+	float pos_bias[3];
+};
+
+layout(std430, binding = 1, set = 1) readonly buffer NodeTransforms
+{
+	mat4 world[]; // world transform of the node within the model
+} nodes;
+
+layout(std430, binding = 2, set = 1) readonly buffer Draws
+{
+	DrawData draws[];
+} drawData;
+
+// gl_InstanceIndex is the instance here, so the draw comes in separately.
+layout( push_constant ) uniform constants
+{
+	uint draw_idx;
+} PushConstants;
+
+layout (location = 0) out vec3 normal;
+layout (location = 1) out vec2 texCoords;
+layout (location = 2) flat out uint diffuseIdx;
+layout (location = 3) flat out uint diffuseSamplerIdx;
+
+void main()
+{
+    DrawData draw = drawData.draws[PushConstants.draw_idx];
+    mat4 instance = transpose(mat4(iTransform0, iTransform1, iTransform2, vec4(0.0, 0.0, 0.0, 1.0)));
+
+    gl_Position = frameData.proj * frameData.view * objectData.model * instance * nodes.world[draw.node] * vec4(vPosition, 1.0);
+    texCoords = vTexCoords;
+    normal = vNormal;
+    diffuseIdx = draw.diffuse_idx;
+    diffuseSamplerIdx = draw.diffuse_sampler_idx;
+}
@@ -0,0 +1,318 @@
+// Bvh queries against testing every box, on random boxes: right after a build, after refits that
+// scatter the boxes, and after a background rebuild swapped in by poll() while the boxes kept moving.
+// Also the shape the traversal relies on (depth first nodes, every item in exactly one leaf, parents
+// around their children) and Aabb::transformed.
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace render;
+
+namespace {
+
+constexpr size_t ITEM_COUNT = 2000;
+constexpr int QUERY_COUNT = 200;
+constexpr float WORLD_SIZE = 200.0f;
+constexpr float MAX_T = 1000.0f;
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+std::vector<Aabb> randomBoxes(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> pos(-WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f);
+    std::uniform_real_distribution<float> size(0.1f, 6.0f);
+
+    std::vector<Aabb> boxes(count);
+    for(auto& box : boxes)
+    {
+        box.min = glm::vec3(pos(rng), pos(rng), pos(rng));
+        box.max = box.min + glm::vec3(size(rng), size(rng), size(rng));
+    }
+    return boxes;
+}
+
+bool contains(const Aabb& outer, const Aabb& inner)
+{
+    return outer.min.x <= inner.min.x and outer.min.y <= inner.min.y and outer.min.z <= inner.min.z
+        and outer.max.x >= inner.max.x and outer.max.y >= inner.max.y and outer.max.z >= inner.max.z;
+}
+
+// the references, one box at a time.
+bool outsideFrustum(const Frustum& frustum, const Aabb& box)
+{
+    for(const auto& plane : frustum.planes)
+    {
+        const glm::vec3 n(plane);
+        const glm::vec3 outer(n.x >= 0.0f ? box.max.x : box.min.x, n.y >= 0.0f ? box.max.y : box.min.y, n.z >= 0.0f ? box.max.z : box.min.z);
+        if(glm::dot(n, outer) + plane.w < 0.0f)
+            return true;
+    }
+    return false;
+}
+
+bool touchesSphere(const Aabb& box, glm::vec3 center, float radius)
+{
+    float distSq = 0.0f;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        const float d = center[axis] - std::min(std::max(center[axis], box.min[axis]), box.max[axis]);
+        distSq += d * d;
+    }
+    return distSq <= radius * radius;
+}
+
+bool entryOf(const Aabb& box, const Ray& ray, float& entry)
+{
+    float t0 = 0.0f, t1 = MAX_T;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        float tNear = (box.min[axis] - ray.origin[axis]) * (1.0f / ray.direction[axis]);
+        float tFar = (box.max[axis] - ray.origin[axis]) * (1.0f / ray.direction[axis]);
+        if(tNear > tFar)
+            std::swap(tNear, tFar);
+        t0 = std::max(t0, tNear);
+        t1 = std::min(t1, tFar);
+        if(t0 > t1)
+            return false;
+    }
+    entry = t0;
+    return true;
+}
+
+Frustum cameraFrustum(glm::vec3 eye, glm::vec3 target)
+{
+    const glm::mat4 proj = glm::perspective(glm::radians(50.0f), 1.5f, 0.5f, 120.0f);
+    return Frustum::fromMatrix(proj * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+}
+
+void checkShape(const Bvh& bvh)
+{
+    const auto& nodes = bvh.getNodes();
+    CHECK(not nodes.empty());
+    CHECK(nodes.size() <= 2 * bvh.itemCount() - 1);
+
+    size_t leafItems = 0;
+    for(uint32_t i = 0; i < nodes.size(); ++i)
+    {
+        const BvhNode& node = nodes[i];
+        if(node.isLeaf())
+        {
+            CHECK(node.count <= Bvh::MAX_LEAF_ITEMS);
+            CHECK(node.offset + node.count <= bvh.itemCount());
+            leafItems += node.count;
+            continue;
+        }
+
+        CHECK(i + 1 < nodes.size());
+        CHECK(node.offset > i + 1 and node.offset < nodes.size());
+        CHECK(contains(node.bounds, nodes[i + 1].bounds));
+        CHECK(contains(node.bounds, nodes[node.offset].bounds));
+    }
+
+    // leaves share the item list without overlapping, so this many means each item once.
+    CHECK(leafItems == bvh.itemCount());
+}
+
+void checkQueries(const Bvh& bvh, const std::vector<Aabb>& boxes, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> pos(-WORLD_SIZE * 0.6f, WORLD_SIZE * 0.6f);
+    std::uniform_real_distribution<float> radius(0.0f, 30.0f);
+    std::uniform_real_distribution<float> dir(-1.0f, 1.0f);
+
+    std::vector<uint32_t> found, expected;
+    for(int q = 0; q < QUERY_COUNT; ++q)
+    {
+        const glm::vec3 center(pos(rng), pos(rng), pos(rng));
+        const float r = radius(rng);
+
+        found.clear();
+        expected.clear();
+        bvh.querySphere(center, r, found);
+        for(uint32_t i = 0; i < boxes.size(); ++i)
+        {
+            if(touchesSphere(boxes[i], center, r))
+                expected.push_back(i);
+        }
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+
+        const Frustum frustum = cameraFrustum(center, glm::vec3(pos(rng), pos(rng), pos(rng)));
+        found.clear();
+        expected.clear();
+        bvh.queryFrustum(frustum, found);
+        for(uint32_t i = 0; i < boxes.size(); ++i)
+        {
+            if(not outsideFrustum(frustum, boxes[i]))
+                expected.push_back(i);
+        }
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+
+        const Ray ray { center, glm::vec3(dir(rng), dir(rng), dir(rng)) };
+        float nearest = MAX_T;
+        bool anyHit = false;
+        for(const auto& box : boxes)
+        {
+            float t;
+            if(entryOf(box, ray, t) and t <= nearest)
+            {
+                nearest = t;
+                anyHit = true;
+            }
+        }
+
+        float hitT = -1.0f;
+        const uint32_t hit = bvh.raycast(ray, MAX_T, &hitT);
+        CHECK((hit != Bvh::NO_HIT) == anyHit);
+        if(anyHit)
+        {
+            // ties can go to either box, the distance cannot.
+            float t;
+            CHECK(hitT == nearest);
+            CHECK(entryOf(boxes[hit], ray, t) and t == nearest);
+        }
+    }
+}
+
+void queries()
+{
+    std::mt19937 rng(1234);
+    const auto boxes = randomBoxes(rng, ITEM_COUNT);
+
+    Bvh bvh;
+    bvh.build(boxes);
+    CHECK(bvh.itemCount() == ITEM_COUNT);
+    CHECK(bvh.degradation() == 1.0f);
+    checkShape(bvh);
+    checkQueries(bvh, boxes, rng);
+
+    // a ray starting inside a box enters it right away.
+    const Ray inside { boxes[7].center(), glm::vec3(0.0f, 1.0f, 0.0f) };
+    float hitT = -1.0f;
+    CHECK(bvh.raycast(inside, MAX_T, &hitT) != Bvh::NO_HIT);
+    CHECK(hitT == 0.0f);
+}
+
+void refitAndRebuild()
+{
+    std::mt19937 rng(5678);
+    Bvh bvh;
+    bvh.build(randomBoxes(rng, ITEM_COUNT));
+
+    // every box somewhere else entirely, the old shape fits badly.
+    auto moved = randomBoxes(rng, ITEM_COUNT);
+    bvh.refit(moved);
+    checkShape(bvh);
+    checkQueries(bvh, moved, rng);
+    CHECK(bvh.degradation() > Bvh::REBUILD_DEGRADATION);
+
+    bvh.rebuildAsync();
+    CHECK(bvh.rebuilding());
+    // a second request while one runs changes nothing.
+    bvh.rebuildAsync();
+
+    // and the boxes keep moving while it builds, poll has to refit to these.
+    for(auto& box : moved)
+    {
+        box.min += glm::vec3(1.0f, -2.0f, 0.5f);
+        box.max += glm::vec3(1.0f, -2.0f, 0.5f);
+    }
+    bvh.refit(moved);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while(not bvh.poll())
+    {
+        CHECK(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    CHECK(not bvh.rebuilding());
+    CHECK(not bvh.poll());
+    CHECK(bvh.degradation() == 1.0f);
+    checkShape(bvh);
+    checkQueries(bvh, moved, rng);
+}
+
+void buildDropsRebuild()
+{
+    std::mt19937 rng(91011);
+    Bvh bvh;
+    bvh.build(randomBoxes(rng, ITEM_COUNT));
+    bvh.rebuildAsync();
+
+    // a build for a different item count, the one in flight is for items that are gone.
+    const auto fewer = randomBoxes(rng, 10);
+    bvh.build(fewer);
+    CHECK(not bvh.rebuilding());
+    CHECK(not bvh.poll());
+    CHECK(bvh.itemCount() == 10);
+    checkShape(bvh);
+    checkQueries(bvh, fewer, rng);
+}
+
+void emptyAndSingle()
+{
+    Bvh bvh;
+    std::vector<uint32_t> found;
+    bvh.querySphere(glm::vec3(0.0f), 100.0f, found);
+    CHECK(found.empty());
+    CHECK(bvh.raycast({ glm::vec3(0.0f), glm::vec3(1.0f) }, MAX_T) == Bvh::NO_HIT);
+    bvh.rebuildAsync();
+    CHECK(not bvh.rebuilding());
+
+    // all boxes in one spot, nothing for SAH to split by.
+    Aabb box;
+    box.grow(glm::vec3(1.0f));
+    box.grow(glm::vec3(2.0f));
+    bvh.build(std::vector<Aabb>(9, box));
+    checkShape(bvh);
+    bvh.querySphere(glm::vec3(1.5f), 0.1f, found);
+    CHECK(found.size() == 9);
+}
+
+void transformedBox()
+{
+    Aabb box;
+    box.grow(glm::vec3(-1.0f, -2.0f, -3.0f));
+    box.grow(glm::vec3(1.0f, 2.0f, 3.0f));
+
+    const glm::mat4 moved = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 0.0f, -5.0f)), glm::vec3(2.0f));
+    const Aabb result = box.transformed(moved);
+    CHECK(result.min == glm::vec3(8.0f, -4.0f, -11.0f));
+    CHECK(result.max == glm::vec3(12.0f, 4.0f, 1.0f));
+
+    // a quarter turn around z swaps x and y extents.
+    const Aabb turned = box.transformed(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+    CHECK(std::fabs(turned.min.x + 2.0f) < 1e-5f and std::fabs(turned.max.x - 2.0f) < 1e-5f);
+    CHECK(std::fabs(turned.min.y + 1.0f) < 1e-5f and std::fabs(turned.max.y - 1.0f) < 1e-5f);
+
+    CHECK(Aabb().transformed(moved).empty());
+}
+
+} // anonymous namespace
+
+int main()
+{
+    queries();
+    refitAndRebuild();
+    buildDropsRebuild();
+    emptyAndSingle();
+    transformedBox();
+    std::puts("BvhTest passed");
+    return 0;
+}
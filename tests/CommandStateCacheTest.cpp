@@ -0,0 +1,196 @@
+// What CommandStateCache records and what it drops, against vkCmd* stand-ins that only count calls,
+// so no device is needed. Handles are made up numbers, the cache only compares them.
+#include "CommandStateCache.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace render;
+
+namespace {
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+struct Calls
+{
+    uint32_t pipelines {0};
+    uint32_t sets {0};
+    uint32_t vertexBuffers {0};
+    uint32_t indexBuffers {0};
+    uint32_t pushes {0};
+} calls;
+
+template<typename T>
+T handle(uintptr_t value)
+{
+    return reinterpret_cast<T>(value);
+}
+
+const VkCommandBuffer COMMAND_BUFFER = handle<VkCommandBuffer>(0x10);
+const VkPipelineLayout LAYOUT_A = handle<VkPipelineLayout>(0x20);
+const VkPipelineLayout LAYOUT_B = handle<VkPipelineLayout>(0x21);
+const VkDescriptorSet SET_0 = handle<VkDescriptorSet>(0x30);
+const VkDescriptorSet SET_1 = handle<VkDescriptorSet>(0x31);
+const VkDescriptorSet SET_2 = handle<VkDescriptorSet>(0x32);
+
+void pipelines()
+{
+    calls = {};
+    CommandStateCache state(COMMAND_BUFFER);
+
+    state.bindPipeline(handle<VkPipeline>(1));
+    state.bindPipeline(handle<VkPipeline>(1));
+    state.bindPipeline(handle<VkPipeline>(2));
+    state.bindPipeline(handle<VkPipeline>(2));
+    CHECK(calls.pipelines == 2);
+    CHECK(state.getStats().recorded == 2);
+    CHECK(state.getStats().skipped == 2);
+
+    state.invalidate();
+    state.bindPipeline(handle<VkPipeline>(2));
+    CHECK(calls.pipelines == 3);
+}
+
+void descriptorSets()
+{
+    calls = {};
+    CommandStateCache state(COMMAND_BUFFER);
+
+    state.bindDescriptorSet(LAYOUT_A, 0, SET_0);
+    state.bindDescriptorSet(LAYOUT_A, 1, SET_1);
+    state.bindDescriptorSet(LAYOUT_A, 0, SET_0);
+    state.bindDescriptorSet(LAYOUT_A, 1, SET_1);
+    CHECK(calls.sets == 2);
+
+    // same set through another layout gets bound again.
+    state.bindDescriptorSet(LAYOUT_B, 1, SET_1);
+    CHECK(calls.sets == 3);
+
+    // and the set below, bound through the old layout, is not trusted to still be there.
+    state.bindDescriptorSet(LAYOUT_A, 0, SET_0);
+    CHECK(calls.sets == 4);
+
+    // which in turn forgets set 1 from LAYOUT_B.
+    state.bindDescriptorSet(LAYOUT_B, 1, SET_1);
+    CHECK(calls.sets == 5);
+
+    // sets bound through the layout being switched to are kept.
+    state.bindDescriptorSet(LAYOUT_B, 0, SET_0);
+    state.bindDescriptorSet(LAYOUT_B, 2, SET_2);
+    CHECK(calls.sets == 7);
+    state.bindDescriptorSet(LAYOUT_B, 1, SET_1);
+    state.bindDescriptorSet(LAYOUT_B, 0, SET_0);
+    CHECK(calls.sets == 7);
+
+    state.invalidate();
+    state.bindDescriptorSet(LAYOUT_B, 0, SET_0);
+    CHECK(calls.sets == 8);
+}
+
+void buffers()
+{
+    calls = {};
+    CommandStateCache state(COMMAND_BUFFER);
+
+    const VkBuffer vertex[2] = { handle<VkBuffer>(0x40), handle<VkBuffer>(0x41) };
+    const VkDeviceSize offsets[2] = { 0, 64 };
+    const VkDeviceSize moved[2] = { 0, 128 };
+
+    state.bindVertexBuffers(0, 2, vertex, offsets);
+    state.bindVertexBuffers(0, 2, vertex, offsets);
+    CHECK(calls.vertexBuffers == 1);
+    state.bindVertexBuffers(0, 2, vertex, moved);
+    CHECK(calls.vertexBuffers == 2);
+    state.bindVertexBuffers(1, 1, &vertex[1], &moved[1]);
+    CHECK(calls.vertexBuffers == 2);
+
+    const VkBuffer index = handle<VkBuffer>(0x50);
+    state.bindIndexBuffer(index, 0, VK_INDEX_TYPE_UINT32);
+    state.bindIndexBuffer(index, 0, VK_INDEX_TYPE_UINT32);
+    CHECK(calls.indexBuffers == 1);
+    state.bindIndexBuffer(index, 0, VK_INDEX_TYPE_UINT16);
+    state.bindIndexBuffer(index, 256, VK_INDEX_TYPE_UINT16);
+    CHECK(calls.indexBuffers == 3);
+}
+
+void pushConstants()
+{
+    calls = {};
+    CommandStateCache state(COMMAND_BUFFER);
+
+    const uint32_t a[4] = { 1, 2, 3, 4 };
+    const uint32_t b[4] = { 1, 2, 3, 5 };
+    const VkShaderStageFlags stages = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+    state.pushConstants(LAYOUT_A, stages, 0, sizeof(a), a);
+    state.pushConstants(LAYOUT_A, stages, 0, sizeof(a), a);
+    CHECK(calls.pushes == 1);
+
+    // a part of what was pushed already, unchanged.
+    state.pushConstants(LAYOUT_A, stages, 4, 8, &a[1]);
+    CHECK(calls.pushes == 1);
+
+    state.pushConstants(LAYOUT_A, stages, 0, sizeof(b), b);
+    CHECK(calls.pushes == 2);
+
+    // bytes never pushed count as changed, whatever they are compared to.
+    const uint32_t zero = 0;
+    state.pushConstants(LAYOUT_A, stages, 64, sizeof(zero), &zero);
+    CHECK(calls.pushes == 3);
+
+    // other layout or other stages, everything pushed before is forgotten.
+    state.pushConstants(LAYOUT_B, stages, 0, sizeof(b), b);
+    CHECK(calls.pushes == 4);
+    state.pushConstants(LAYOUT_B, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(b), b);
+    CHECK(calls.pushes == 5);
+
+    state.invalidate();
+    state.pushConstants(LAYOUT_B, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(b), b);
+    CHECK(calls.pushes == 6);
+}
+
+} // anonymous namespace
+
+// stand-ins for the loader, only counted.
+VKAPI_ATTR void VKAPI_CALL vkCmdBindPipeline(VkCommandBuffer, VkPipelineBindPoint, VkPipeline)
+{
+    calls.pipelines++;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBindDescriptorSets(VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t,
+                                                   uint32_t, const VkDescriptorSet*, uint32_t, const uint32_t*)
+{
+    calls.sets++;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBindVertexBuffers(VkCommandBuffer, uint32_t, uint32_t, const VkBuffer*, const VkDeviceSize*)
+{
+    calls.vertexBuffers++;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBindIndexBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkIndexType)
+{
+    calls.indexBuffers++;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPushConstants(VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t, const void*)
+{
+    calls.pushes++;
+}
+
+int main()
+{
+    pipelines();
+    descriptorSets();
+    buffers();
+    pushConstants();
+    std::puts("CommandStateCacheTest passed");
+    return 0;
+}
@@ -0,0 +1,178 @@
+// CompactVertex round trips: random vertices of a mesh of reasonable size have to come back within
+// the default error bounds, directions all over the sphere included (the folded -z half, the poles,
+// zero vectors from meshes without normals). A mesh too large for 16 bit positions, or with texture
+// coordinates far outside the texture, has to be refused.
+#include "CompactVertex.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace render;
+
+namespace {
+
+constexpr size_t VERTEX_COUNT = 20000;
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+glm::vec3 randomDirection(std::mt19937& rng)
+{
+    std::normal_distribution<float> dist;
+    glm::vec3 d;
+    do
+    {
+        d = glm::vec3(dist(rng), dist(rng), dist(rng));
+    } while(glm::length(d) < 1e-3f);
+    return glm::normalize(d);
+}
+
+// positions inside min..max, texture coordinates inside the texture.
+std::vector<Vertex> randomVertices(std::mt19937& rng, size_t count, glm::vec3 min, glm::vec3 max)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Vertex> vertices(count);
+    for(auto& v : vertices)
+    {
+        v.pos = min + glm::vec3(unit(rng), unit(rng), unit(rng)) * (max - min);
+        v.surf_normals = randomDirection(rng);
+        v.tangents = randomDirection(rng);
+        v.tex_coords = glm::vec2(unit(rng), unit(rng));
+    }
+    return vertices;
+}
+
+void randomRoundTrip()
+{
+    std::mt19937 rng(1234);
+    const glm::vec3 min(-3.0f, 0.0f, -7.5f);
+    const glm::vec3 max(3.0f, 12.0f, 2.5f);
+    const auto vertices = randomVertices(rng, VERTEX_COUNT, min, max);
+    const auto q = VertexQuantization::forBounds(min, max);
+    const QuantizationErrorBounds bounds;
+
+    std::vector<CompactVertex> compact;
+    CHECK(quantizeVertices(vertices.data(), vertices.size(), q, bounds, compact));
+    CHECK(compact.size() == vertices.size());
+
+    for(size_t i = 0; i < vertices.size(); ++i)
+    {
+        const Vertex decoded = decodeVertex(compact[i], q);
+        for(int c = 0; c < 3; ++c)
+            CHECK(std::fabs(decoded.pos[c] - vertices[i].pos[c]) <= bounds.position);
+
+        CHECK(glm::length(decoded.surf_normals - vertices[i].surf_normals) <= bounds.direction);
+        CHECK(glm::length(decoded.tangents - vertices[i].tangents) <= bounds.direction);
+        CHECK(std::fabs(glm::length(decoded.surf_normals) - 1.0f) < 1e-5f);
+        CHECK(std::fabs(decoded.tex_coords.x - vertices[i].tex_coords.x) <= bounds.texCoord);
+        CHECK(std::fabs(decoded.tex_coords.y - vertices[i].tex_coords.y) <= bounds.texCoord);
+    }
+}
+
+void directions()
+{
+    const auto q = VertexQuantization::forBounds(glm::vec3(0.0f), glm::vec3(1.0f));
+    const QuantizationErrorBounds bounds;
+    const float h = std::sqrt(0.5f);
+
+    // axes, both poles, the fold of the octahedron and the diagonals under it.
+    const glm::vec3 normals[] = {
+        { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, { h, h, 0.0f }, { -h, 0.0f, -h },
+        { 0.0f, h, -h }, glm::normalize(glm::vec3(-1.0f, -1.0f, -1.0f)), glm::normalize(glm::vec3(1.0f, -1.0f, -1.0f)),
+    };
+
+    for(const glm::vec3& n : normals)
+    {
+        Vertex v;
+        v.surf_normals = n;
+        v.tangents = -n;
+        const Vertex decoded = decodeVertex(encodeVertex(v, q), q);
+        CHECK(glm::length(decoded.surf_normals - n) <= bounds.direction);
+        CHECK(glm::length(decoded.tangents + n) <= bounds.direction);
+    }
+
+    // no normals in the source: nothing to keep, comes back as +z and does not fail the mesh.
+    Vertex none;
+    std::vector<CompactVertex> compact;
+    CHECK(quantizeVertices(&none, 1, q, bounds, compact));
+    CHECK(decodeVertex(compact[0], q).surf_normals == glm::vec3(0.0f, 0.0f, 1.0f));
+
+    // unnormalized ones are kept as directions.
+    Vertex longer;
+    longer.surf_normals = glm::vec3(0.0f, 5.0f, 0.0f);
+    CHECK(quantizeVertices(&longer, 1, q, bounds, compact));
+    CHECK(glm::length(decodeVertex(compact[0], q).surf_normals - glm::vec3(0.0f, 1.0f, 0.0f)) <= bounds.direction);
+}
+
+void positions()
+{
+    const glm::vec3 min(-2.0f, 1.0f, 4.0f);
+    const glm::vec3 max(6.0f, 1.0f, 5.0f); // flat along y.
+    const auto q = VertexQuantization::forBounds(min, max);
+
+    // the corners of the bounds land on the ends of the range.
+    Vertex low, high;
+    low.pos = min;
+    high.pos = max;
+    const CompactVertex lowCompact = encodeVertex(low, q);
+    const CompactVertex highCompact = encodeVertex(high, q);
+    CHECK(lowCompact.pos[0] == 0 and lowCompact.pos[2] == 0);
+    CHECK(highCompact.pos[0] == 65535 and highCompact.pos[2] == 65535);
+
+    // nothing to spread over a flat axis, it comes back as exactly where the mesh is.
+    CHECK(highCompact.pos[1] == 0);
+    CHECK(decodeVertex(highCompact, q).pos.y == 1.0f);
+    CHECK(std::fabs(decodeVertex(highCompact, q).pos.x - max.x) < 1e-6f);
+
+    // outside the bounds gets clamped to them.
+    Vertex outside;
+    outside.pos = glm::vec3(100.0f, 1.0f, -100.0f);
+    const CompactVertex clamped = encodeVertex(outside, q);
+    CHECK(clamped.pos[0] == 65535 and clamped.pos[2] == 0);
+}
+
+void refused()
+{
+    std::mt19937 rng(5678);
+    const QuantizationErrorBounds bounds;
+    std::vector<CompactVertex> compact;
+
+    // a 16 bit step over 2000 units is 0.03, way past a millimeter.
+    const glm::vec3 min(-1000.0f), max(1000.0f);
+    auto huge = randomVertices(rng, 100, min, max);
+    CHECK(not quantizeVertices(huge.data(), huge.size(), VertexQuantization::forBounds(min, max), bounds, compact));
+
+    // texture coordinates in the hundreds, where half floats are a long way from texel precise.
+    const glm::vec3 unitMin(0.0f), unitMax(1.0f);
+    auto tiled = randomVertices(rng, 100, unitMin, unitMax);
+    const auto q = VertexQuantization::forBounds(unitMin, unitMax);
+    CHECK(quantizeVertices(tiled.data(), tiled.size(), q, bounds, compact));
+    tiled[50].tex_coords = glm::vec2(300.3f, 0.5f);
+    CHECK(not quantizeVertices(tiled.data(), tiled.size(), q, bounds, compact));
+
+    // looser bounds let the same mesh through.
+    QuantizationErrorBounds loose;
+    loose.texCoord = 0.5f;
+    CHECK(quantizeVertices(tiled.data(), tiled.size(), q, loose, compact));
+}
+
+} // anonymous namespace
+
+int main()
+{
+    randomRoundTrip();
+    directions();
+    positions();
+    refused();
+    std::puts("CompactVertexTest passed");
+    return 0;
+}
@@ -0,0 +1,128 @@
+// The SSE path of cullSpheres against Frustum::sphereVisible, one sphere at a time. Short counts end
+// on the scalar tail, a long one goes through the OpenMP split, and NaN spheres have to stay visible
+// in both like the scalar test keeps them.
+#include "Culling.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace render;
+
+namespace {
+
+constexpr size_t MAX_SHORT_COUNT = 67;
+constexpr size_t LONG_COUNT = PARALLEL_CULL_THRESHOLD * 4 + 3;
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+Frustum cameraFrustum()
+{
+    const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    return Frustum::fromMatrix(proj * view);
+}
+
+// spread wider than the frustum so both sides of every plane get hit.
+SphereSoA randomSpheres(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> pos(-120.0f, 120.0f);
+    std::uniform_real_distribution<float> radius(0.0f, 8.0f);
+
+    SphereSoA spheres;
+    for(size_t i = 0; i < count; ++i)
+        spheres.push(glm::vec3(pos(rng), pos(rng), pos(rng)), radius(rng));
+    return spheres;
+}
+
+void compare(const Frustum& frustum, const SphereSoA& spheres)
+{
+    std::vector<uint8_t> visible(3, 7); // stale contents, has to be resized and overwritten.
+    const uint32_t visibleCount = cullSpheres(frustum, spheres, visible);
+
+    CHECK(visible.size() == spheres.size());
+
+    uint32_t expectedCount = 0;
+    for(size_t i = 0; i < spheres.size(); ++i)
+    {
+        const bool expected = frustum.sphereVisible(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+        CHECK(visible[i] == uint8_t(expected));
+        expectedCount += expected;
+    }
+
+    CHECK(visibleCount == expectedCount);
+}
+
+void shortCounts()
+{
+    const Frustum frustum = cameraFrustum();
+    std::mt19937 rng(1234);
+    for(size_t count = 0; count <= MAX_SHORT_COUNT; ++count)
+        compare(frustum, randomSpheres(rng, count));
+}
+
+void longCount()
+{
+    const Frustum frustum = cameraFrustum();
+    std::mt19937 rng(5678);
+    const SphereSoA spheres = randomSpheres(rng, LONG_COUNT);
+    compare(frustum, spheres);
+
+    // with spheres this spread out some have to land on each side.
+    std::vector<uint8_t> visible;
+    const uint32_t visibleCount = cullSpheres(frustum, spheres, visible);
+    CHECK(visibleCount > 0 and visibleCount < LONG_COUNT);
+}
+
+void knownSpheres()
+{
+    const Frustum frustum = cameraFrustum();
+
+    SphereSoA spheres;
+    spheres.push(glm::vec3(0.0f), 1.0f);                   // looked at, inside.
+    spheres.push(glm::vec3(0.0f, 2.0f, 20.0f), 1.0f);      // behind the camera.
+    spheres.push(glm::vec3(0.0f, 2.0f, 10.5f), 1.0f);      // behind, but reaching past the near plane.
+    spheres.push(glm::vec3(0.0f, 2.0f, -200.0f), 5.0f);    // past the far plane.
+    spheres.push(glm::vec3(std::numeric_limits<float>::quiet_NaN()), 1.0f);
+
+    std::vector<uint8_t> visible;
+    const uint32_t visibleCount = cullSpheres(frustum, spheres, visible);
+
+    CHECK(visible[0] == 1);
+    CHECK(visible[1] == 0);
+    CHECK(visible[2] == 1);
+    CHECK(visible[3] == 0);
+    CHECK(visible[4] == 1);
+    CHECK(visibleCount == 3);
+
+    // the same NaN inside a group of four, where the SSE path decides.
+    SphereSoA block;
+    for(int i = 0; i < 4; ++i)
+        block.push(glm::vec3(0.0f, 2.0f, 20.0f), 1.0f);
+    block.x[2] = std::numeric_limits<float>::quiet_NaN();
+    compare(frustum, block);
+    cullSpheres(frustum, block, visible);
+    CHECK(visible[2] == 1);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    shortCounts();
+    longCount();
+    knownSpheres();
+    std::puts("CullingTest passed");
+    return 0;
+}
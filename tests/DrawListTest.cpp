@@ -0,0 +1,139 @@
+// radixSort against std::stable_sort on random keys, keys that share most of their bytes (the passes
+// that get skipped) and many equal keys (stability). Then that DrawKey orders by pipeline, set,
+// geometry, front to back depth and material, in that order.
+#include "DrawList.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace render;
+
+namespace {
+
+constexpr size_t MAX_SHORT_COUNT = 40;
+constexpr size_t LONG_COUNT = 50001;
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+// keys are key & mask | fixed, so the bytes outside the mask are the same in all of them.
+std::vector<DrawItem> randomItems(std::mt19937_64& rng, size_t count, uint64_t mask, uint64_t fixed)
+{
+    std::vector<DrawItem> items(count);
+    for(size_t i = 0; i < count; ++i)
+        items[i] = { (rng() & mask) | fixed, uint32_t(i) };
+    return items;
+}
+
+void compare(std::vector<DrawItem> items)
+{
+    auto expected = items;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+
+    std::vector<DrawItem> scratch;
+    radixSort(items, scratch);
+
+    CHECK(items.size() == expected.size());
+    for(size_t i = 0; i < items.size(); ++i)
+    {
+        CHECK(items[i].key == expected[i].key);
+        CHECK(items[i].index == expected[i].index);
+    }
+}
+
+void randomKeys()
+{
+    std::mt19937_64 rng(1234);
+    for(size_t count = 0; count <= MAX_SHORT_COUNT; ++count)
+        compare(randomItems(rng, count, ~0ull, 0));
+
+    compare(randomItems(rng, LONG_COUNT, ~0ull, 0));
+}
+
+void sharedBytes()
+{
+    std::mt19937_64 rng(5678);
+
+    // only the middle bytes differ, the outer passes are skipped.
+    compare(randomItems(rng, LONG_COUNT, 0x0000'00ff'ff00'0000ull, 0xab00'0000'0000'00cdull));
+    // an odd number of passes left, the result ends up in what was the scratch.
+    compare(randomItems(rng, LONG_COUNT, 0x00ff'0000'0000'0000ull, 0x1200'3400'0000'0000ull));
+    // all keys the same, nothing moves.
+    compare(randomItems(rng, 1000, 0, 0x0123'4567'89ab'cdefull));
+}
+
+void equalKeys()
+{
+    // few distinct keys in many items, stability decides the order of the indices.
+    std::mt19937_64 rng(91011);
+    compare(randomItems(rng, LONG_COUNT, 0x0f00'0000'0000'0003ull, 0));
+}
+
+void drawKeyOrder()
+{
+    // each field wins over everything after it.
+    CHECK(DrawKey::make(0, 1023, 1023, 1e30f, 0xffff) < DrawKey::make(1, 0, 0, 0.0f, 0));
+    CHECK(DrawKey::make(2, 0, 1023, 1e30f, 0xffff) < DrawKey::make(2, 1, 0, 0.0f, 0));
+    CHECK(DrawKey::make(2, 3, 0, 1e30f, 0xffff) < DrawKey::make(2, 3, 1, 0.0f, 0));
+    CHECK(DrawKey::make(2, 3, 4, 1.0f, 0xffff) < DrawKey::make(2, 3, 4, 2.0f, 0));
+    CHECK(DrawKey::make(2, 3, 4, 1.0f, 5) < DrawKey::make(2, 3, 4, 1.0f, 6));
+
+    // front to back over a wide range of distances.
+    float previous = 0.0f;
+    for(float depth = 0.001f; depth < 1e6f; depth *= 1.5f)
+    {
+        CHECK(DrawKey::make(0, 0, 0, previous, 0) < DrawKey::make(0, 0, 0, depth, 0));
+        previous = depth;
+    }
+
+    // behind the camera counts as right in front of it.
+    CHECK(DrawKey::make(1, 2, 3, -5.0f, 4) == DrawKey::make(1, 2, 3, 0.0f, 4));
+
+    // the pipeline comes back out, and too large ids do not spill into the fields before them.
+    CHECK(DrawKey::pipeline(DrawKey::make(9, 1023, 1023, 1e30f, 0xffff)) == 9);
+    CHECK(DrawKey::make(0, 1024, 0, 0.0f, 0) == DrawKey::make(0, 0, 0, 0.0f, 0));
+    CHECK(DrawKey::make(0, 0, 1024, 0.0f, 0) == DrawKey::make(0, 0, 0, 0.0f, 0));
+    CHECK(DrawKey::make(0, 0, 0, 0.0f, 0x10000) == DrawKey::make(0, 0, 0, 0.0f, 0));
+}
+
+void drawListSort()
+{
+    DrawList list;
+    list.add(DrawKey::make(1, 0, 0, 5.0f, 0), 0);
+    list.add(DrawKey::make(0, 1, 0, 1.0f, 0), 1);
+    list.add(DrawKey::make(0, 0, 0, 3.0f, 0), 2);
+    list.add(DrawKey::make(0, 0, 0, 2.0f, 0), 3);
+    list.sort();
+
+    const auto& items = list.getItems();
+    CHECK(list.size() == 4);
+    CHECK(items[0].index == 3);
+    CHECK(items[1].index == 2);
+    CHECK(items[2].index == 1);
+    CHECK(items[3].index == 0);
+
+    list.clear();
+    CHECK(list.size() == 0);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    randomKeys();
+    sharedBytes();
+    equalKeys();
+    drawKeyOrder();
+    drawListSort();
+    std::puts("DrawListTest passed");
+    return 0;
+}
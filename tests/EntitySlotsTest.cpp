@@ -0,0 +1,162 @@
+// EntitySlots driven the way Scene drives it, with one packed component array moved along. Random
+// creates and destroys are checked against a plain list of what should be alive: live handles have
+// to find their own component, dead ones (including ones whose slot got reused) must find nothing,
+// and the packed arrays have to stay packed.
+#include "EntitySlots.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace render;
+
+namespace {
+
+constexpr int STEP_COUNT = 200000;
+constexpr size_t MAX_ALIVE = 300;
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+// what the owner keeps per entity, here just a number to tell them apart.
+struct Owner
+{
+    EntitySlots entities;
+    std::vector<uint32_t> payloads;
+
+    Entity create(uint32_t payload)
+    {
+        const Entity entity = entities.create();
+        payloads.push_back(payload);
+        return entity;
+    }
+
+    void destroy(Entity entity)
+    {
+        const uint32_t dense = entities.destroy(entity);
+        if(dense == Entity::NO_SLOT)
+            return;
+        payloads[dense] = payloads.back();
+        payloads.pop_back();
+    }
+
+    // NO_SLOT for dead handles.
+    uint32_t payload(Entity entity) const
+    {
+        const uint32_t dense = entities.denseIndex(entity);
+        return dense == Entity::NO_SLOT ? Entity::NO_SLOT : payloads[dense];
+    }
+};
+
+struct Expected
+{
+    Entity entity;
+    uint32_t payload;
+};
+
+void basics()
+{
+    Owner owner;
+    CHECK(not owner.entities.alive(Entity{}));
+    CHECK(not owner.entities.alive(Entity{ 0, 0 }));
+
+    const Entity a = owner.create(10);
+    const Entity b = owner.create(11);
+    const Entity c = owner.create(12);
+    CHECK(a != b and b != c);
+    CHECK(owner.entities.size() == 3);
+
+    // a from the front, c moves into its place.
+    owner.destroy(a);
+    CHECK(not owner.entities.alive(a));
+    CHECK(owner.entities.size() == 2);
+    CHECK(owner.entities.denseIndex(c) == 0);
+    CHECK(owner.entities.entityAt(0) == c);
+    CHECK(owner.payload(c) == 12);
+    CHECK(owner.payload(b) == 11);
+
+    // destroying again, or what never was, changes nothing.
+    owner.destroy(a);
+    owner.destroy(Entity{ 77, 0 });
+    CHECK(owner.entities.size() == 2);
+
+    // a's slot gets reused, a itself still does not resolve.
+    const Entity d = owner.create(13);
+    CHECK(d.slot == a.slot);
+    CHECK(d.generation != a.generation);
+    CHECK(not owner.entities.alive(a));
+    CHECK(owner.payload(a) == Entity::NO_SLOT);
+    CHECK(owner.payload(d) == 13);
+
+    // the last one, nothing has to move.
+    owner.destroy(d);
+    CHECK(owner.entities.size() == 2);
+    CHECK(owner.payload(b) == 11 and owner.payload(c) == 12);
+}
+
+void randomOps()
+{
+    std::mt19937 rng(1234);
+    Owner owner;
+    std::vector<Expected> alive;
+    std::vector<Entity> dead;
+    uint32_t nextPayload = 0;
+
+    for(int step = 0; step < STEP_COUNT; ++step)
+    {
+        // grows to about MAX_ALIVE and hovers there, so slots keep getting reused.
+        const bool grow = alive.empty() or (alive.size() < MAX_ALIVE and rng() % 2 == 0);
+        if(grow)
+        {
+            const Entity entity = owner.create(nextPayload);
+            CHECK(owner.entities.alive(entity));
+            alive.push_back({ entity, nextPayload++ });
+        }
+        else
+        {
+            const size_t victim = rng() % alive.size();
+            owner.destroy(alive[victim].entity);
+            dead.push_back(alive[victim].entity);
+            alive[victim] = alive.back();
+            alive.pop_back();
+        }
+
+        CHECK(owner.entities.size() == alive.size());
+        CHECK(owner.payloads.size() == alive.size());
+
+        // checking everything every step is slow, every so often is plenty.
+        if(step % 97 != 0)
+            continue;
+
+        for(const auto& e : alive)
+        {
+            CHECK(owner.payload(e.entity) == e.payload);
+            CHECK(owner.entities.entityAt(owner.entities.denseIndex(e.entity)) == e.entity);
+        }
+
+        // the recently dead, their slots are the ones about to be reused.
+        for(size_t i = dead.size() > MAX_ALIVE ? dead.size() - MAX_ALIVE : 0; i < dead.size(); ++i)
+            CHECK(not owner.entities.alive(dead[i]));
+    }
+
+    // slots went through many generations, none of the old handles came back to life.
+    CHECK(dead.size() > MAX_ALIVE * 10);
+    for(const Entity& entity : dead)
+        CHECK(not owner.entities.alive(entity));
+}
+
+} // anonymous namespace
+
+int main()
+{
+    basics();
+    randomOps();
+    std::puts("EntitySlotsTest passed");
+    return 0;
+}
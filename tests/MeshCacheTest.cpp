@@ -0,0 +1,247 @@
+// MeshCache writes and reads back a small model, everything compared field by field. A cache for
+// another source or other import flags, a truncated file and an index pointing past the vertices
+// all have to be misses rather than crashes. Writers racing on the same path have to leave one
+// whole file and no temporaries behind, and hashFile has to notice a change in the last few bytes.
+#include "MeshCache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+using namespace render;
+
+namespace {
+
+constexpr uint64_t SOURCE_HASH = 0x1234'5678'9abc'def0ull;
+constexpr uint32_t IMPORT_FLAGS = 0x42;
+constexpr uint32_t FAN_SIZE = 40; // vertices in the first mesh.
+constexpr int WRITER_COUNT = 8;
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+// a triangle fan and a single triangle under a two node hierarchy.
+ModelImportData testModel()
+{
+    ModelImportData model;
+    model.hierarchy.addNode(SceneHierarchy::NO_PARENT, glm::vec3(1.0f, 2.0f, 3.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    model.hierarchy.addNode(0, glm::vec3(0.0f, -1.0f, 0.0f), glm::quat(0.0f, 0.0f, 1.0f, 0.0f), glm::vec3(2.0f));
+
+    MeshImportData fan;
+    for(uint32_t i = 0; i < FAN_SIZE; ++i)
+        fan.vertices.push_back(Vertex(glm::vec3(float(i), float(i * i) * 0.1f, -float(i)), glm::vec3(0.0f, 0.0f, 1.0f),
+                                      glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(float(i) / FAN_SIZE, 0.5f)));
+    for(uint32_t i = 1; i + 1 < FAN_SIZE; ++i)
+        fan.indices.insert(fan.indices.end(), { 0, i, i + 1 });
+    const auto half = static_cast<uint32_t>(fan.indices.size() / 2 / 3 * 3);
+    fan.lods = { MeshLod{ 0, half, 0.0f, 0, 1 }, MeshLod{ half, static_cast<uint32_t>(fan.indices.size()) - half, 0.25f, 1, 1 } };
+    fan.meshlets = { Meshlet{ glm::vec3(1.0f), 2.0f, glm::vec3(0.0f, 0.0f, 1.0f), 0.5f, 0, half },
+                     Meshlet{ glm::vec3(3.0f), 4.0f, glm::vec3(0.0f, 1.0f, 0.0f), 1.0f, half, static_cast<uint32_t>(fan.indices.size()) - half } };
+    fan.material.diffuse = "textures/fan_diffuse.png";
+    fan.material.channels[2] = "textures/fan_specular.png";
+    fan.bounds = { glm::vec3(0.0f, 0.0f, -39.0f), glm::vec3(39.0f, 152.1f, 0.0f), glm::vec3(19.5f, 76.0f, -19.5f), 80.0f };
+    fan.node = 1;
+
+    // no LODs or meshlets, the cache gives it its one full level.
+    MeshImportData single;
+    single.vertices = { Vertex(), Vertex(), Vertex() };
+    single.vertices[1].pos = glm::vec3(1.0f, 0.0f, 0.0f);
+    single.vertices[2].pos = glm::vec3(0.0f, 1.0f, 0.0f);
+    single.indices = { 0, 1, 2 };
+    single.material.normal = "normal.png";
+
+    model.meshes.push_back(std::move(fan));
+    model.meshes.push_back(std::move(single));
+    return model;
+}
+
+std::vector<char> readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<char>& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size());
+}
+
+bool sameMaterial(const MeshMaterialPaths& a, const MeshMaterialPaths& b)
+{
+    return a.diffuse == b.diffuse and a.normal == b.normal and a.channels == b.channels;
+}
+
+void checkMesh(const MeshView& view, const MeshImportData& mesh)
+{
+    CHECK(view.vertexCount == mesh.vertices.size());
+    CHECK(std::memcmp(view.vertices, mesh.vertices.data(), view.vertexCount * sizeof(Vertex)) == 0);
+    CHECK(view.indexCount == mesh.indices.size());
+    CHECK(std::memcmp(view.indices, mesh.indices.data(), view.indexCount * sizeof(uint32_t)) == 0);
+    CHECK(view.meshletCount == mesh.meshlets.size());
+    if(view.meshletCount > 0)
+        CHECK(std::memcmp(view.meshlets, mesh.meshlets.data(), view.meshletCount * sizeof(Meshlet)) == 0);
+    CHECK(sameMaterial(view.material, mesh.material));
+    CHECK(view.bounds.min == mesh.bounds.min and view.bounds.max == mesh.bounds.max);
+    CHECK(view.bounds.center == mesh.bounds.center and view.bounds.radius == mesh.bounds.radius);
+    CHECK(view.node == mesh.node);
+
+    const size_t lodCount = mesh.lods.empty() ? 1 : mesh.lods.size();
+    CHECK(view.lods.size() == lodCount);
+    for(size_t l = 0; l < mesh.lods.size(); ++l)
+    {
+        CHECK(view.lods[l].indexOffset == mesh.lods[l].indexOffset);
+        CHECK(view.lods[l].indexCount == mesh.lods[l].indexCount);
+        CHECK(view.lods[l].error == mesh.lods[l].error);
+        CHECK(view.lods[l].meshletOffset == mesh.lods[l].meshletOffset);
+        CHECK(view.lods[l].meshletCount == mesh.lods[l].meshletCount);
+    }
+    if(mesh.lods.empty())
+        CHECK(view.lods[0].indexOffset == 0 and view.lods[0].indexCount == mesh.indices.size());
+}
+
+void roundTrip(const std::string& dir)
+{
+    const std::string path = dir + "/model.cache";
+    const ModelImportData model = testModel();
+    CHECK(MeshCache::write(path, SOURCE_HASH, IMPORT_FLAGS, model));
+
+    const auto cache = MeshCache::open(path, SOURCE_HASH, IMPORT_FLAGS);
+    CHECK(cache);
+    CHECK(cache->meshCount() == model.meshes.size());
+    for(size_t i = 0; i < model.meshes.size(); ++i)
+        checkMesh(cache->mesh(i), model.meshes[i]);
+
+    const SceneHierarchy& nodes = cache->hierarchy();
+    CHECK(nodes.size() == 2);
+    CHECK(nodes.parent(0) == SceneHierarchy::NO_PARENT and nodes.parent(1) == 0);
+    CHECK(nodes.translation(1) == model.hierarchy.translation(1));
+    CHECK(nodes.scale(1) == model.hierarchy.scale(1));
+    CHECK(nodes.rotation(1).y == 1.0f);
+
+    // anything that does not match what it was written for is a miss.
+    CHECK(not MeshCache::open(path, SOURCE_HASH + 1, IMPORT_FLAGS));
+    CHECK(not MeshCache::open(path, SOURCE_HASH, IMPORT_FLAGS ^ 1));
+    CHECK(not MeshCache::open(dir + "/missing.cache", SOURCE_HASH, IMPORT_FLAGS));
+}
+
+void damaged(const std::string& dir)
+{
+    const std::string path = dir + "/damaged.cache";
+    const ModelImportData model = testModel();
+    CHECK(MeshCache::write(path, SOURCE_HASH, IMPORT_FLAGS, model));
+    const std::vector<char> good = readFile(path);
+
+    // cut short anywhere.
+    for(size_t size : { size_t(0), size_t(16), good.size() / 2, good.size() - 1 })
+    {
+        writeFile(path, std::vector<char>(good.begin(), good.begin() + size));
+        CHECK(not MeshCache::open(path, SOURCE_HASH, IMPORT_FLAGS));
+    }
+
+    // the fan's index stream, found by its bytes, it is the only place they show up.
+    const auto& indices = model.meshes[0].indices;
+    const size_t indexBytes = indices.size() * sizeof(uint32_t);
+    const auto* pattern = reinterpret_cast<const char*>(indices.data());
+    size_t found = good.size();
+    for(size_t at = 0; at + indexBytes <= good.size(); ++at)
+    {
+        if(std::memcmp(good.data() + at, pattern, indexBytes) == 0)
+        {
+            CHECK(found == good.size());
+            found = at;
+        }
+    }
+    CHECK(found < good.size());
+
+    // the last vertex is fine, one past it is not.
+    std::vector<char> bytes = good;
+    uint32_t index = FAN_SIZE - 1;
+    std::memcpy(bytes.data() + found + 5 * sizeof(uint32_t), &index, sizeof(index));
+    writeFile(path, bytes);
+    CHECK(MeshCache::open(path, SOURCE_HASH, IMPORT_FLAGS));
+
+    index = FAN_SIZE;
+    std::memcpy(bytes.data() + found + 5 * sizeof(uint32_t), &index, sizeof(index));
+    writeFile(path, bytes);
+    CHECK(not MeshCache::open(path, SOURCE_HASH, IMPORT_FLAGS));
+
+    writeFile(path, good);
+    CHECK(MeshCache::open(path, SOURCE_HASH, IMPORT_FLAGS));
+}
+
+void racingWriters(const std::string& dir)
+{
+    const std::string path = dir + "/raced.cache";
+    const ModelImportData model = testModel();
+
+    std::vector<std::thread> writers;
+    for(int w = 0; w < WRITER_COUNT; ++w)
+        writers.emplace_back([&]() { CHECK(MeshCache::write(path, SOURCE_HASH, IMPORT_FLAGS, model)); });
+    for(auto& writer : writers)
+        writer.join();
+
+    const auto cache = MeshCache::open(path, SOURCE_HASH, IMPORT_FLAGS);
+    CHECK(cache);
+    checkMesh(cache->mesh(0), model.meshes[0]);
+
+    // every temporary got renamed over the cache, none left lying around.
+    for(const auto& entry : std::filesystem::directory_iterator(dir))
+        CHECK(entry.path().extension() != ".tmp");
+}
+
+void hashes(const std::string& dir)
+{
+    const std::string a = dir + "/a.bin", b = dir + "/b.bin";
+    std::vector<char> bytes(1003);
+    for(size_t i = 0; i < bytes.size(); ++i)
+        bytes[i] = char(i * 31);
+
+    writeFile(a, bytes);
+    writeFile(b, bytes);
+    CHECK(MeshCache::hashFile(a) != 0);
+    CHECK(MeshCache::hashFile(a) == MeshCache::hashFile(b));
+
+    // a change in the tail that does not fill a whole word, and a file one byte shorter.
+    bytes.back() ^= 1;
+    writeFile(b, bytes);
+    CHECK(MeshCache::hashFile(a) != MeshCache::hashFile(b));
+    bytes.back() ^= 1;
+    bytes.pop_back();
+    writeFile(b, bytes);
+    CHECK(MeshCache::hashFile(a) != MeshCache::hashFile(b));
+
+    CHECK(MeshCache::hashFile(dir + "/missing.bin") == 0);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    const auto dir = std::filesystem::temp_directory_path() / ("MeshCacheTest." + std::to_string(::getpid()));
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    roundTrip(dir.string());
+    damaged(dir.string());
+    racingWriters(dir.string());
+    hashes(dir.string());
+
+    std::filesystem::remove_all(dir);
+    std::puts("MeshCacheTest passed");
+    return 0;
+}
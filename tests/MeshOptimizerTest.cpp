@@ -0,0 +1,215 @@
+// The mesh optimizer passes on a shuffled grid: each has to keep exactly the triangles it got, winding
+// included, Tipsify has to beat the shuffled order by a wide margin and the overdraw pass must not
+// lose what it got. Vertex fetch has to leave vertices in first use order with the same positions
+// behind every index, and the whole pipeline has to give the same bytes every time it runs.
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace render;
+
+namespace {
+
+constexpr uint32_t GRID_SIZE = 48; // quads per side.
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+struct Mesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// bumpy grid so the overdraw pass has normals to sort by, triangles in random order.
+Mesh shuffledGrid(uint32_t seed)
+{
+    Mesh mesh;
+    for(uint32_t y = 0; y <= GRID_SIZE; ++y)
+    {
+        for(uint32_t x = 0; x <= GRID_SIZE; ++x)
+        {
+            Vertex v;
+            v.pos = glm::vec3(float(x), float(y), float((x * 7 + y * 3) % 5) * 0.3f);
+            mesh.vertices.push_back(v);
+        }
+    }
+
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for(uint32_t y = 0; y < GRID_SIZE; ++y)
+    {
+        for(uint32_t x = 0; x < GRID_SIZE; ++x)
+        {
+            const uint32_t i = y * (GRID_SIZE + 1) + x;
+            triangles.push_back({ i, i + 1, i + GRID_SIZE + 2 });
+            triangles.push_back({ i, i + GRID_SIZE + 2, i + GRID_SIZE + 1 });
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+    for(const auto& tri : triangles)
+        mesh.indices.insert(mesh.indices.end(), tri.begin(), tri.end());
+
+    // a vertex no triangle uses, vertex fetch has to drop it.
+    mesh.vertices.push_back(Vertex());
+    return mesh;
+}
+
+// triangles as position triples, each rotated to start at its smallest corner so winding survives
+// but the choice of first vertex does not matter.
+using Corner = std::tuple<float, float, float>;
+using Triangle = std::array<Corner, 3>;
+
+std::vector<Triangle> triangleSet(const Mesh& mesh)
+{
+    std::vector<Triangle> triangles;
+    for(size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        Triangle tri;
+        for(size_t c = 0; c < 3; ++c)
+        {
+            const glm::vec3& p = mesh.vertices[mesh.indices[i + c]].pos;
+            tri[c] = { p.x, p.y, p.z };
+        }
+
+        std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()), tri.end());
+        triangles.push_back(tri);
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+float acmr(const Mesh& mesh)
+{
+    return analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size()).acmr;
+}
+
+void cacheStats()
+{
+    const uint32_t one[] = { 0, 1, 2 };
+    CHECK(analyzeVertexCache(one, 3, 3).acmr == 3.0f);
+    CHECK(analyzeVertexCache(one, 3, 3).atvr == 1.0f);
+
+    const uint32_t twice[] = { 0, 1, 2, 2, 1, 0 };
+    CHECK(analyzeVertexCache(twice, 6, 3).acmr == 1.5f);
+
+    // with room for two vertices the third miss evicts the first one.
+    const uint32_t evicted[] = { 0, 1, 2, 0, 1, 2 };
+    CHECK(analyzeVertexCache(evicted, 6, 3, 2).acmr == 3.0f);
+    CHECK(analyzeVertexCache(evicted, 6, 3, 2).atvr == 2.0f);
+
+    CHECK(analyzeVertexCache(nullptr, 0, 0).acmr == 0.0f);
+}
+
+void vertexCache()
+{
+    Mesh mesh = shuffledGrid(1234);
+    const auto triangles = triangleSet(mesh);
+    const float before = acmr(mesh);
+
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+
+    CHECK(triangleSet(mesh) == triangles);
+    // a regular grid with a 16 entry cache gets well under one miss per triangle.
+    CHECK(acmr(mesh) < 1.0f);
+    CHECK(acmr(mesh) < before * 0.5f);
+}
+
+void overdraw()
+{
+    Mesh mesh = shuffledGrid(5678);
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    const auto triangles = triangleSet(mesh);
+    const float tipsified = acmr(mesh);
+
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+
+    CHECK(triangleSet(mesh) == triangles);
+    CHECK(acmr(mesh) <= tipsified);
+}
+
+void vertexFetch()
+{
+    Mesh mesh = shuffledGrid(91011);
+    const auto triangles = triangleSet(mesh);
+    const size_t referenced = mesh.vertices.size() - 1;
+
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+    CHECK(mesh.vertices.size() == referenced);
+    CHECK(triangleSet(mesh) == triangles);
+
+    // first use order: every index is either one seen before or the next new one.
+    uint32_t next = 0;
+    for(uint32_t idx : mesh.indices)
+    {
+        CHECK(idx <= next);
+        if(idx == next)
+            next++;
+    }
+    CHECK(next == referenced);
+}
+
+void wholeMesh()
+{
+    Mesh a = shuffledGrid(1213);
+    Mesh b = a;
+    const auto triangles = triangleSet(a);
+
+    const MeshOptimizeStats stats = optimizeMesh(a.vertices, a.indices);
+    optimizeMesh(b.vertices, b.indices);
+
+    CHECK(triangleSet(a) == triangles);
+    CHECK(stats.after.acmr < stats.before.acmr);
+    CHECK(stats.after.atvr <= stats.before.atvr);
+
+    // deterministic down to the byte, the mesh cache stores the result.
+    CHECK(a.indices == b.indices);
+    CHECK(a.vertices.size() == b.vertices.size());
+    CHECK(std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0);
+}
+
+void tinyMeshes()
+{
+    Mesh empty;
+    optimizeMesh(empty.vertices, empty.indices);
+    CHECK(empty.vertices.empty() and empty.indices.empty());
+
+    Mesh single;
+    single.vertices.resize(3);
+    single.vertices[1].pos = glm::vec3(1.0f, 0.0f, 0.0f);
+    single.vertices[2].pos = glm::vec3(0.0f, 1.0f, 0.0f);
+    single.indices = { 2, 0, 1 };
+    const auto triangles = triangleSet(single);
+    optimizeMesh(single.vertices, single.indices);
+    CHECK(triangleSet(single) == triangles);
+    CHECK(single.vertices.size() == 3);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    cacheStats();
+    vertexCache();
+    overdraw();
+    vertexFetch();
+    wholeMesh();
+    tinyMeshes();
+    std::puts("MeshOptimizerTest passed");
+    return 0;
+}
@@ -0,0 +1,211 @@
+// simplifyMesh on grids: a flat one has to collapse its inside for free while the open border stays
+// put and no triangle flips, a bumpy one must never go past maxError. Then the LOD chain: ranges
+// back to back, triangle counts going down and errors going up, and no chain for what cannot shrink.
+#include "MeshSimplifier.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace render;
+
+namespace {
+
+constexpr uint32_t GRID_SIZE = 32; // quads per side.
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+// heights of 0 give a flat grid, facing +z.
+MeshImportData grid(const std::vector<float>& heights)
+{
+    MeshImportData mesh;
+    for(uint32_t y = 0; y <= GRID_SIZE; ++y)
+    {
+        for(uint32_t x = 0; x <= GRID_SIZE; ++x)
+        {
+            Vertex v;
+            v.pos = glm::vec3(float(x), float(y), heights.empty() ? 0.0f : heights[y * (GRID_SIZE + 1) + x]);
+            mesh.vertices.push_back(v);
+        }
+    }
+
+    for(uint32_t y = 0; y < GRID_SIZE; ++y)
+    {
+        for(uint32_t x = 0; x < GRID_SIZE; ++x)
+        {
+            const uint32_t i = y * (GRID_SIZE + 1) + x;
+            mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + GRID_SIZE + 2 });
+            mesh.indices.insert(mesh.indices.end(), { i, i + GRID_SIZE + 2, i + GRID_SIZE + 1 });
+        }
+    }
+
+    mesh.bounds.min = glm::vec3(0.0f, 0.0f, -2.0f);
+    mesh.bounds.max = glm::vec3(float(GRID_SIZE), float(GRID_SIZE), 2.0f);
+    return mesh;
+}
+
+MeshImportData bumpyGrid(uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> height(-0.5f, 0.5f);
+    std::vector<float> heights((GRID_SIZE + 1) * (GRID_SIZE + 1));
+    for(auto& h : heights)
+        h = height(rng);
+    return grid(heights);
+}
+
+float signedAreaZ(const std::vector<Vertex>& vertices, const uint32_t* tri)
+{
+    const glm::vec3 a = vertices[tri[0]].pos;
+    return glm::cross(vertices[tri[1]].pos - a, vertices[tri[2]].pos - a).z * 0.5f;
+}
+
+bool onBorder(const glm::vec3& p)
+{
+    return p.x == 0.0f or p.y == 0.0f or p.x == float(GRID_SIZE) or p.y == float(GRID_SIZE);
+}
+
+void flatGrid()
+{
+    const MeshImportData mesh = grid({});
+    float error = -1.0f;
+    const auto result = simplifyMesh(mesh.vertices, mesh.indices, 0, 1e-3f, error);
+
+    CHECK(result.size() % 3 == 0);
+    CHECK(error >= 0.0f and error < 1e-6f);
+    // only the border has to stay, and that takes about one triangle per border vertex.
+    CHECK(result.size() / 3 <= 4 * GRID_SIZE);
+
+    std::vector<bool> used(mesh.vertices.size(), false);
+    float area = 0.0f;
+    for(size_t i = 0; i < result.size(); i += 3)
+    {
+        // nothing flipped, nothing squashed flat.
+        const float triArea = signedAreaZ(mesh.vertices, &result[i]);
+        CHECK(triArea > 0.0f);
+        area += triArea;
+
+        for(size_t c = 0; c < 3; ++c)
+        {
+            CHECK(result[i + c] < mesh.vertices.size());
+            used[result[i + c]] = true;
+        }
+    }
+
+    // same outline, same area, and every border vertex still there.
+    CHECK(std::fabs(area - float(GRID_SIZE * GRID_SIZE)) < 1e-2f);
+    for(size_t v = 0; v < mesh.vertices.size(); ++v)
+    {
+        if(onBorder(mesh.vertices[v].pos))
+            CHECK(used[v]);
+    }
+}
+
+void errorBound()
+{
+    const MeshImportData mesh = bumpyGrid(1234);
+
+    float previous = 0.0f;
+    size_t previousCount = mesh.indices.size() + 1;
+    for(float maxError : { 0.0f, 0.01f, 0.05f, 0.2f, 1.0f })
+    {
+        float error = -1.0f;
+        const auto result = simplifyMesh(mesh.vertices, mesh.indices, 0, maxError, error);
+
+        CHECK(error >= 0.0f and error <= maxError);
+        CHECK(error >= previous);
+        CHECK(result.size() <= previousCount);
+        for(uint32_t idx : result)
+            CHECK(idx < mesh.vertices.size());
+
+        previous = error;
+        previousCount = result.size();
+    }
+
+    // the loosest bound has to have actually collapsed something.
+    CHECK(previousCount < mesh.indices.size() / 2);
+}
+
+void targetCount()
+{
+    const MeshImportData mesh = bumpyGrid(5678);
+    const size_t target = mesh.indices.size() / 4;
+
+    float error = 0.0f;
+    const auto result = simplifyMesh(mesh.vertices, mesh.indices, target, 1e9f, error);
+
+    // stops at the first collapse that gets there, a collapse removes at most two triangles.
+    CHECK(result.size() <= target);
+    CHECK(result.size() + 6 > target);
+}
+
+// gentle waves, what a real surface looks like to the early levels with their tiny error targets.
+MeshImportData wavyGrid()
+{
+    std::vector<float> heights((GRID_SIZE + 1) * (GRID_SIZE + 1));
+    for(uint32_t y = 0; y <= GRID_SIZE; ++y)
+    {
+        for(uint32_t x = 0; x <= GRID_SIZE; ++x)
+            heights[y * (GRID_SIZE + 1) + x] = 2.0f * std::sin(float(x) * 0.2f) * std::cos(float(y) * 0.15f);
+    }
+    return grid(heights);
+}
+
+void lodChain()
+{
+    MeshImportData mesh = wavyGrid();
+    const size_t baseCount = mesh.indices.size();
+    buildLodChain(mesh, LodSettings());
+
+    CHECK(mesh.lods.size() > 1);
+    CHECK(mesh.lods.size() <= MAX_MESH_LODS);
+    CHECK(mesh.lods[0].indexOffset == 0);
+    CHECK(mesh.lods[0].indexCount == baseCount);
+    CHECK(mesh.lods[0].error == 0.0f);
+
+    for(size_t l = 1; l < mesh.lods.size(); ++l)
+    {
+        const MeshLod& lod = mesh.lods[l];
+        const MeshLod& prev = mesh.lods[l - 1];
+        CHECK(lod.indexOffset == prev.indexOffset + prev.indexCount);
+        CHECK(lod.indexCount % 3 == 0);
+        CHECK(lod.indexCount * 10 <= prev.indexCount * 9);
+        CHECK(lod.error >= prev.error);
+    }
+
+    const MeshLod& last = mesh.lods.back();
+    CHECK(last.indexOffset + last.indexCount == mesh.indices.size());
+    for(uint32_t idx : mesh.indices)
+        CHECK(idx < mesh.vertices.size());
+
+    // a single triangle has nothing to give, level 0 is all there is.
+    MeshImportData single;
+    single.vertices.resize(3);
+    single.vertices[1].pos = glm::vec3(1.0f, 0.0f, 0.0f);
+    single.vertices[2].pos = glm::vec3(0.0f, 1.0f, 0.0f);
+    single.indices = { 0, 1, 2 };
+    single.bounds.max = glm::vec3(1.0f, 1.0f, 0.0f);
+    buildLodChain(single, LodSettings());
+    CHECK(single.lods.size() == 1);
+    CHECK(single.indices.size() == 3);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    flatGrid();
+    errorBound();
+    targetCount();
+    lodChain();
+    std::puts("MeshSimplifierTest passed");
+    return 0;
+}
@@ -0,0 +1,185 @@
+// buildMeshlets on a two level grid: meshlets of a level cover exactly its index range, in order,
+// within the vertex and triangle limits, and their spheres hold every vertex. Normal cones have to
+// follow the authored normals rather than the winding, and a closed box gets a cone that never culls.
+#include "MeshletBuilder.hpp"
+#include "Culling.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace render;
+
+namespace {
+
+constexpr uint32_t GRID_SIZE = 40; // quads per side of level 0.
+constexpr uint32_t COARSE_GRID_SIZE = 20;
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+// counter clockwise seen from +z, normals pointing wherever normalZ says.
+void appendGrid(MeshImportData& mesh, uint32_t size, float step, float normalZ)
+{
+    const auto base = static_cast<uint32_t>(mesh.vertices.size());
+    for(uint32_t y = 0; y <= size; ++y)
+    {
+        for(uint32_t x = 0; x <= size; ++x)
+        {
+            Vertex v;
+            v.pos = glm::vec3(float(x) * step, float(y) * step, 0.0f);
+            v.surf_normals = glm::vec3(0.0f, 0.0f, normalZ);
+            mesh.vertices.push_back(v);
+        }
+    }
+
+    const auto indexOffset = static_cast<uint32_t>(mesh.indices.size());
+    for(uint32_t y = 0; y < size; ++y)
+    {
+        for(uint32_t x = 0; x < size; ++x)
+        {
+            const uint32_t i = base + y * (size + 1) + x;
+            mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + size + 2 });
+            mesh.indices.insert(mesh.indices.end(), { i, i + size + 2, i + size + 1 });
+        }
+    }
+
+    mesh.lods.push_back({ indexOffset, static_cast<uint32_t>(mesh.indices.size()) - indexOffset, 0.0f, 0, 0 });
+}
+
+MeshImportData twoLevelGrid(float normalZ)
+{
+    MeshImportData mesh;
+    appendGrid(mesh, GRID_SIZE, 1.0f, normalZ);
+    appendGrid(mesh, COARSE_GRID_SIZE, 2.0f, normalZ);
+    return mesh;
+}
+
+void checkLayout(const MeshImportData& mesh)
+{
+    uint32_t meshletOffset = 0;
+    for(const MeshLod& lod : mesh.lods)
+    {
+        CHECK(lod.meshletOffset == meshletOffset);
+        CHECK(lod.meshletCount > 0);
+
+        // back to back over the whole range of the level.
+        uint32_t next = lod.indexOffset;
+        for(uint32_t m = lod.meshletOffset; m < lod.meshletOffset + lod.meshletCount; ++m)
+        {
+            const Meshlet& meshlet = mesh.meshlets[m];
+            CHECK(meshlet.indexOffset == next);
+            CHECK(meshlet.indexCount > 0);
+            CHECK(meshlet.indexCount % 3 == 0);
+            CHECK(meshlet.indexCount / 3 <= MESHLET_MAX_TRIANGLES);
+
+            std::set<uint32_t> unique;
+            for(uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; ++i)
+            {
+                unique.insert(mesh.indices[i]);
+                const float d = glm::length(mesh.vertices[mesh.indices[i]].pos - meshlet.center);
+                CHECK(d <= meshlet.radius * 1.0001f + 1e-5f);
+            }
+            CHECK(unique.size() <= MESHLET_MAX_VERTICES);
+
+            next += meshlet.indexCount;
+        }
+
+        CHECK(next == lod.indexOffset + lod.indexCount);
+        meshletOffset += lod.meshletCount;
+    }
+
+    CHECK(meshletOffset == mesh.meshlets.size());
+}
+
+void grids()
+{
+    for(float normalZ : { 1.0f, -1.0f })
+    {
+        MeshImportData mesh = twoLevelGrid(normalZ);
+        buildMeshlets(mesh);
+        checkLayout(mesh);
+
+        // enough triangles that the limits had to split it.
+        CHECK(mesh.lods[0].meshletCount > 1);
+
+        for(const Meshlet& meshlet : mesh.meshlets)
+        {
+            // flat, so the cone is just the facing the normals agree with.
+            CHECK(std::fabs(meshlet.coneAxis.z - normalZ) < 1e-5f);
+            CHECK(meshlet.coneCutoff < 1e-3f);
+
+            const glm::vec3 front = meshlet.center + glm::vec3(0.0f, 0.0f, 50.0f * normalZ);
+            const glm::vec3 back = meshlet.center - glm::vec3(0.0f, 0.0f, 50.0f * normalZ);
+            CHECK(not coneBackfacing(meshlet.center, meshlet.radius, meshlet.coneAxis, meshlet.coneCutoff, front));
+            CHECK(coneBackfacing(meshlet.center, meshlet.radius, meshlet.coneAxis, meshlet.coneCutoff, back));
+        }
+    }
+}
+
+void closedBox()
+{
+    MeshImportData mesh;
+    for(int i = 0; i < 8; ++i)
+    {
+        Vertex v;
+        v.pos = glm::vec3(float(i & 1), float((i >> 1) & 1), float((i >> 2) & 1));
+        v.surf_normals = v.pos - glm::vec3(0.5f);
+        mesh.vertices.push_back(v);
+    }
+
+    // outward facing, counter clockwise.
+    mesh.indices = {
+        0, 2, 3, 0, 3, 1, // -z
+        4, 5, 7, 4, 7, 6, // +z
+        0, 1, 5, 0, 5, 4, // -y
+        2, 6, 7, 2, 7, 3, // +y
+        0, 4, 6, 0, 6, 2, // -x
+        1, 3, 7, 1, 7, 5, // +x
+    };
+    mesh.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f, 0, 0 });
+
+    buildMeshlets(mesh);
+    checkLayout(mesh);
+    CHECK(mesh.meshlets.size() == 1);
+
+    // faces all around, seen from any side some face the camera.
+    const Meshlet& meshlet = mesh.meshlets[0];
+    CHECK(meshlet.coneCutoff >= 1.0f);
+    CHECK(std::fabs(meshlet.radius - std::sqrt(0.75f)) < 1e-5f);
+    for(const glm::vec3 camera : { glm::vec3(0.5f, 0.5f, 20.0f), glm::vec3(-20.0f, 0.5f, 0.5f), glm::vec3(9.0f, -9.0f, 9.0f) })
+        CHECK(not coneBackfacing(meshlet.center, meshlet.radius, meshlet.coneAxis, meshlet.coneCutoff, camera));
+}
+
+void nothingToSplit()
+{
+    MeshImportData mesh;
+    buildMeshlets(mesh);
+    CHECK(mesh.meshlets.empty());
+
+    // ranges of an earlier run are thrown away, not appended to.
+    MeshImportData grid = twoLevelGrid(1.0f);
+    buildMeshlets(grid);
+    const size_t count = grid.meshlets.size();
+    buildMeshlets(grid);
+    CHECK(grid.meshlets.size() == count);
+    checkLayout(grid);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    grids();
+    closedBox();
+    nothingToSplit();
+    std::puts("MeshletBuilderTest passed");
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Many threads asking for overlapping keys at once: every key has to load exactly once and every
+// caller of a key has to get what that one load returned, the way TextureManager hands out slot indices.
+#include "utils/SingleFlightCache.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int THREADS = 128;
+constexpr int KEYS = 64;
+constexpr int ROUNDS = 20; // requests per thread, spread over keys so they overlap.
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+void concurrentLoadsOncePerKey()
+{
+    SingleFlightCache<uint32_t> cache;
+    std::atomic<uint32_t> nextIndex {0};
+    std::vector<std::atomic<int>> loads(KEYS);
+    // what every thread got for every key, UINT32_MAX where it never asked.
+    std::vector<std::vector<uint32_t>> seen(THREADS, std::vector<uint32_t>(KEYS, UINT32_MAX));
+
+    std::atomic<bool> go {false};
+    std::vector<std::thread> threads;
+    for(int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            while(not go.load())
+                std::this_thread::yield();
+
+            for(int r = 0; r < ROUNDS; ++r)
+            {
+                const int key = (t * 7 + r * 13) % KEYS;
+                const uint32_t index = cache.getOrLoad("texture_" + std::to_string(key),
+                    [&]() {
+                        loads[key]++;
+                        // long enough for the other threads asking for it to pile up behind.
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                        return nextIndex++;
+                    },
+                    [](uint32_t) { return true; });
+                seen[t][key] = index;
+            }
+        });
+    }
+
+    go = true;
+    for(auto& thread : threads)
+        thread.join();
+
+    for(int key = 0; key < KEYS; ++key)
+    {
+        CHECK(loads[key] == 1);
+
+        uint32_t expected = UINT32_MAX;
+        for(int t = 0; t < THREADS; ++t)
+        {
+            if(seen[t][key] == UINT32_MAX)
+                continue;
+            if(expected == UINT32_MAX)
+                expected = seen[t][key];
+            CHECK(seen[t][key] == expected);
+        }
+        CHECK(expected != UINT32_MAX);
+        CHECK(cache.find("texture_" + std::to_string(key)) == expected);
+    }
+    CHECK(nextIndex == KEYS);
+}
+
+void invalidEntriesReloadOnce()
+{
+    // entries going stale is what expired weak slot references look like.
+    SingleFlightCache<uint32_t> cache;
+    std::atomic<int> loads {0};
+    auto load = [&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        return uint32_t(++loads);
+    };
+
+    CHECK(cache.getOrLoad("a", load, [](uint32_t) { return true; }) == 1);
+
+    std::vector<std::thread> threads;
+    std::vector<uint32_t> seen(THREADS);
+    for(int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            seen[t] = cache.getOrLoad("a", load, [](uint32_t v) { return v != 1; });
+        });
+    }
+    for(auto& thread : threads)
+        thread.join();
+
+    CHECK(loads == 2);
+    for(uint32_t v : seen)
+        CHECK(v == 2);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    concurrentLoadsOncePerKey();
+    invalidEntriesReloadOnce();
+    std::puts("SingleFlightCacheTest passed");
+    return 0;
+}
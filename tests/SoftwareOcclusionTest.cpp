@@ -0,0 +1,268 @@
+// SoftwareOcclusion with an identity view projection, so world x and y are ndc and a pixel is 1/128
+// of a unit. Random triangles have to rasterize like a per pixel reference, on both sides of the
+// parallel threshold. Boxes have to stay visible when they reach even partly into a pixel nothing
+// was drawn to, occluders too coarse for the frame have to be skipped, and anything behind the eye
+// is left alone, as occluder and as box.
+#include "SoftwareOcclusion.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace render;
+
+namespace {
+
+constexpr float PIXEL_X = 2.0f / SoftwareOcclusion::WIDTH; // one pixel in ndc.
+constexpr float PIXEL_Y = 2.0f / SoftwareOcclusion::HEIGHT;
+// pixel centers closer than this to an edge can go either way.
+constexpr double EDGE_TOLERANCE = 1e-3;
+
+#define CHECK(cond) \
+    do { \
+        if(not (cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while(0)
+
+const glm::mat4 IDENTITY(1.0f);
+
+// ndc x of the left edge of pixel column x.
+float columnX(float x)
+{
+    return x * PIXEL_X - 1.0f;
+}
+
+// axis aligned rectangle at depth z, x and y in ndc.
+OccluderMesh rect(float x0, float y0, float x1, float y1, float z)
+{
+    OccluderMesh mesh;
+    mesh.positions = { glm::vec3(x0, y0, z), glm::vec3(x1, y0, z), glm::vec3(x1, y1, z), glm::vec3(x0, y1, z) };
+    mesh.indices = { 0, 1, 2, 0, 2, 3 };
+    return mesh;
+}
+
+bool visible(SoftwareOcclusion& occlusion, float x0, float y0, float x1, float y1, float zNear, float zFar)
+{
+    return occlusion.boxVisible(IDENTITY, glm::vec3(x0, y0, zNear), glm::vec3(x1, y1, zFar));
+}
+
+// what the depth buffer should hold after drawing these, or NaN where it cannot be told.
+std::vector<float> reference(const std::vector<glm::vec3>& vertices)
+{
+    const uint32_t width = SoftwareOcclusion::WIDTH;
+    const uint32_t height = SoftwareOcclusion::HEIGHT;
+    std::vector<float> depth(width * height, 1.0f);
+    std::vector<bool> unsure(width * height, false);
+
+    for(size_t t = 0; t + 2 < vertices.size(); t += 3)
+    {
+        double sx[3], sy[3];
+        for(int c = 0; c < 3; ++c)
+        {
+            sx[c] = (double(vertices[t + c].x) * 0.5 + 0.5) * width;
+            sy[c] = (double(vertices[t + c].y) * 0.5 + 0.5) * height;
+        }
+
+        const double area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+        // same cut off as the rasterizer.
+        if(not (std::fabs(area) > 1e-6))
+            continue;
+
+        for(uint32_t y = 0; y < height; ++y)
+        {
+            for(uint32_t x = 0; x < width; ++x)
+            {
+                const double px = x + 0.5, py = y + 0.5;
+                double bary[3];
+                double nearestEdge = 1e30;
+                bool inside = true;
+                for(int e = 0; e < 3; ++e)
+                {
+                    const int a = (e + 1) % 3, b = (e + 2) % 3;
+                    // distance in pixels from the edge opposite vertex e, positive inside.
+                    const double cross = (sx[b] - sx[a]) * (py - sy[a]) - (sy[b] - sy[a]) * (px - sx[a]);
+                    bary[e] = cross / area;
+                    const double edgeLength = std::hypot(sx[b] - sx[a], sy[b] - sy[a]);
+                    const double dist = (area > 0.0 ? cross : -cross) / edgeLength;
+                    nearestEdge = std::min(nearestEdge, std::fabs(dist));
+                    inside = inside and dist >= 0.0;
+                }
+
+                const size_t i = y * width + x;
+                if(nearestEdge < EDGE_TOLERANCE)
+                {
+                    unsure[i] = true;
+                    continue;
+                }
+
+                if(inside)
+                {
+                    const double z = bary[0] * vertices[t].z + bary[1] * vertices[t + 1].z + bary[2] * vertices[t + 2].z;
+                    depth[i] = std::min(depth[i], float(z));
+                }
+            }
+        }
+    }
+
+    for(size_t i = 0; i < depth.size(); ++i)
+    {
+        if(unsure[i])
+            depth[i] = NAN;
+    }
+    return depth;
+}
+
+void randomTriangles(uint32_t seed, size_t count)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> pos(-1.3f, 1.3f);
+    std::uniform_real_distribution<float> offset(-0.4f, 0.4f);
+    std::uniform_real_distribution<float> z(-0.9f, 0.9f);
+
+    OccluderMesh mesh;
+    for(size_t t = 0; t < count; ++t)
+    {
+        // smallish ones around a random spot, some reaching off screen.
+        const glm::vec3 center(pos(rng), pos(rng), 0.0f);
+        for(int c = 0; c < 3; ++c)
+        {
+            mesh.positions.push_back(center + glm::vec3(offset(rng), offset(rng), z(rng)));
+            mesh.indices.push_back(static_cast<uint32_t>(mesh.indices.size()));
+        }
+    }
+
+    SoftwareOcclusion occlusion;
+    occlusion.beginFrame(IDENTITY);
+    occlusion.addOccluder(mesh, IDENTITY);
+    occlusion.rasterize();
+
+    const auto expected = reference(mesh.positions);
+    const auto& depth = occlusion.getDepth();
+    size_t drawn = 0;
+    for(size_t i = 0; i < depth.size(); ++i)
+    {
+        if(std::isnan(expected[i]))
+            continue;
+        CHECK(std::fabs(depth[i] - expected[i]) < 1e-4f);
+        drawn += expected[i] < 1.0f;
+    }
+
+    CHECK(drawn > 0);
+    CHECK(occlusion.getStats().occluderTriangles > 0);
+    CHECK(occlusion.getStats().occluderTriangles <= count);
+}
+
+void partialEdgePixels()
+{
+    // left half of the screen, columns 0 to 127 exactly, column 128 onwards empty.
+    SoftwareOcclusion occlusion;
+    occlusion.beginFrame(IDENTITY);
+    occlusion.addOccluder(rect(-1.0f, -1.0f, 0.0f, 1.0f, 0.0f), IDENTITY);
+    occlusion.rasterize();
+
+    const auto& depth = occlusion.getDepth();
+    for(uint32_t y = 0; y < SoftwareOcclusion::HEIGHT; ++y)
+    {
+        CHECK(depth[y * SoftwareOcclusion::WIDTH + 127] == 0.0f);
+        CHECK(depth[y * SoftwareOcclusion::WIDTH + 128] == 1.0f);
+    }
+
+    // well inside, behind.
+    CHECK(not visible(occlusion, columnX(10.0f), -0.5f, columnX(100.0f), 0.5f, 0.2f, 0.6f));
+    // in front of the occluder.
+    CHECK(visible(occlusion, columnX(10.0f), -0.5f, columnX(100.0f), 0.5f, -0.2f, 0.6f));
+    // ending exactly on the edge of the last drawn column.
+    CHECK(not visible(occlusion, columnX(100.2f), -0.5f, columnX(128.0f), 0.5f, 0.2f, 0.6f));
+    // reaching a third of a pixel into the empty column, its center is not covered but it is touched.
+    CHECK(visible(occlusion, columnX(100.2f), -0.5f, columnX(128.3f), 0.5f, 0.2f, 0.6f));
+    // a box narrower than a pixel, inside one empty column.
+    CHECK(visible(occlusion, columnX(128.1f), -0.5f, columnX(128.4f), 0.5f, 0.2f, 0.6f));
+    // a box narrower than a pixel with no pixel center in it, inside a drawn one.
+    CHECK(not visible(occlusion, columnX(50.6f), -PIXEL_Y * 0.2f, columnX(50.9f), PIXEL_Y * 0.2f, 0.2f, 0.6f));
+    // partly off the left of the screen, the part on screen is what counts.
+    CHECK(not visible(occlusion, -1.5f, -0.5f, columnX(20.0f), 0.5f, 0.2f, 0.6f));
+    // off screen altogether, left to frustum culling.
+    CHECK(visible(occlusion, -3.0f, -0.5f, -2.0f, 0.5f, 0.2f, 0.6f));
+
+    const auto& stats = occlusion.getStats();
+    CHECK(stats.occluderTriangles == 2);
+    CHECK(stats.boxesTested == 8);
+    CHECK(stats.boxesOccluded == 4);
+}
+
+void tooCoarse()
+{
+    // with this view projection a unit is 128 pixels, so the limit is an error of 1/256.
+    SoftwareOcclusion occlusion;
+    occlusion.beginFrame(IDENTITY);
+
+    OccluderMesh coarse = rect(-1.0f, -1.0f, 1.0f, 1.0f, 0.0f);
+    coarse.error = 0.01f;
+    occlusion.addOccluder(coarse, IDENTITY);
+
+    // scaled down to a quarter, a quarter of the error on screen as well.
+    const glm::mat4 quarter = glm::scale(IDENTITY, glm::vec3(0.25f));
+    OccluderMesh fine = rect(-1.0f, -1.0f, 1.0f, 1.0f, 0.0f);
+    fine.error = 0.01f;
+    occlusion.addOccluder(fine, quarter);
+    occlusion.rasterize();
+
+    CHECK(occlusion.getStats().occludersTooCoarse == 1);
+    CHECK(occlusion.getStats().occluderTriangles == 2);
+
+    CHECK(visible(occlusion, 0.5f, 0.5f, 0.9f, 0.9f, 0.2f, 0.6f));
+    CHECK(not visible(occlusion, -0.2f, -0.2f, 0.2f, 0.2f, 0.2f, 0.6f));
+}
+
+void behindTheEye()
+{
+    const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    SoftwareOcclusion occlusion;
+    occlusion.beginFrame(proj * view);
+
+    // a wall in front covering the whole view, one triangle so no shared edge runs through it.
+    OccluderMesh wall;
+    wall.positions = { glm::vec3(-100.0f, -100.0f, -10.0f), glm::vec3(300.0f, -100.0f, -10.0f), glm::vec3(-100.0f, 300.0f, -10.0f) };
+    wall.indices = { 0, 1, 2 };
+    occlusion.addOccluder(wall, IDENTITY);
+    CHECK(occlusion.getStats().occluderTriangles == 1);
+
+    // and one behind the camera, which must not draw anything.
+    occlusion.addOccluder(rect(-100.0f, -100.0f, 100.0f, 100.0f, 10.0f), IDENTITY);
+    CHECK(occlusion.getStats().occluderTriangles == 1);
+    occlusion.rasterize();
+
+    // behind the wall.
+    CHECK(not occlusion.boxVisible(IDENTITY, glm::vec3(-1.0f, -1.0f, -30.0f), glm::vec3(1.0f, 1.0f, -20.0f)));
+    // reaching behind the camera.
+    CHECK(occlusion.boxVisible(IDENTITY, glm::vec3(-1.0f, -1.0f, -30.0f), glm::vec3(1.0f, 1.0f, 1.0f)));
+    // the box the wall is part of.
+    CHECK(occlusion.boxVisible(IDENTITY, glm::vec3(-1.0f, -1.0f, -10.5f), glm::vec3(1.0f, 1.0f, -10.0f)));
+
+    // a new frame forgets the wall.
+    occlusion.beginFrame(proj * view);
+    occlusion.rasterize();
+    CHECK(occlusion.boxVisible(IDENTITY, glm::vec3(-1.0f, -1.0f, -30.0f), glm::vec3(1.0f, 1.0f, -20.0f)));
+    CHECK(occlusion.getStats().boxesTested == 1);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    randomTriangles(1234, 40);
+    randomTriangles(5678, 600); // past the parallel threshold.
+    partialEdgePixels();
+    tooCoarse();
+    behindTheEye();
+    std::puts("SoftwareOcclusionTest passed");
+    return 0;
+}